@@ -0,0 +1,316 @@
+//
+//  ESaddressSpacePool.c
+//  Eighty-Sixer
+//
+//  Created by agent on 10/19/26.
+//  Copyright (c) 2026 agent. All rights reserved.
+//
+
+#define _GNU_SOURCE                             // MAP_ANONYMOUS and siginfo_t under -std=c99
+#include "ESaddressSpacePool.h"
+#include "main.h"
+#include <string.h>
+#include <sys/mman.h>
+
+AddressSpace *activeAddressSpace = NULL;
+int addressSpacePoolSize = 1;
+
+AddressSpace *pool = NULL;
+int poolCount = 0;
+
+uint8_t *pristineImage = NULL;
+int pristineImageLength = 0;
+
+volatile sig_atomic_t writeTrapTripped = 0;
+uint8_t * volatile writeTrapAddress = NULL;
+
+
+/**
+ *  Pre-allocates every address space in the pool. Each space is mapped straight from the kernel,
+ *  so it comes back page aligned and already zeroed; we never have to calloc or clear it ourselves.
+ *
+ *  @param spaces the number of address spaces to keep around
+ *  @param bytes  the size of each address space
+ *
+ *  @return FALSE if any of the spaces could not be mapped
+ */
+bool setupAddressSpacePool(int spaces, int bytes){
+    if (pool || spaces < 1 || bytes < 1) return false;          // the pool is only set up once
+
+    pool = calloc(spaces, sizeof(AddressSpace));
+    if (!pool) return false;
+
+    int mappedBytes = (bytes + GUEST_PAGE_SIZE - 1) & ~(GUEST_PAGE_SIZE - 1);     // round up to whole pages
+
+    for (int i = 0; i < spaces; i++) {
+        AddressSpace *space = &pool[i];
+
+        space->floor = mmap(NULL, mappedBytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (space->floor == MAP_FAILED) return false;
+
+        space->mappedBytes   = mappedBytes;
+        space->pageCount     = mappedBytes >> GUEST_PAGE_SHIFT;
+        space->dirtyPageMap  = calloc(space->pageCount, 1);
+        space->dirtyPageList = calloc(space->pageCount, sizeof(int));
+        space->trappedPageMap = calloc(space->pageCount, 1);
+
+        if (!space->dirtyPageMap || !space->dirtyPageList || !space->trappedPageMap) return false;
+
+        poolCount++;
+    }
+
+    if (verbose) {
+        printf("\nAddress space pool ready: %d space(s) of %d pages each.\n", poolCount, pool[0].pageCount);
+    }
+
+    return true;
+}
+
+
+/**
+ *  Hands out an address space that nobody is using. If a pristine image has already been captured
+ *  and this space has never held it, the image is copied in before it is returned.
+ *
+ *  @return the address space, or NULL if the pool is exhausted
+ */
+AddressSpace *acquireAddressSpace(){
+    for (int i = 0; i < poolCount; i++) {
+        AddressSpace *space = &pool[i];
+        if (space->inUse) continue;
+
+        if (pristineImage && !space->holdsImage) {
+            memcpy(space->floor, pristineImage, pristineImageLength);
+            space->holdsImage = true;
+        }
+
+        space->inUse = true;
+        return space;
+    }
+
+    return NULL;
+}
+
+
+/**
+ *  Returns the address space to the pool, restoring whatever the last run dirtied so the
+ *  next one to acquire it starts from the loaded image.
+ *
+ *  @param space the address space to release
+ */
+void releaseAddressSpace(AddressSpace *space){
+    if (!space) return;
+
+    resetAddressSpace(space);
+    space->inUse = false;
+
+    if (space == activeAddressSpace) activeAddressSpace = NULL;
+}
+
+
+/**
+ *  Records the loaded program image as the pristine state every reset goes back to. The image always
+ *  starts at the bottom of the sandbox, so the snapshot is just the first imageLength bytes.
+ *
+ *  @param image       the bottom of the sandbox holding the freshly loaded image
+ *  @param imageLength the number of bytes in the image
+ *
+ *  @return FALSE if the snapshot could not be taken
+ */
+bool takePristineSnapshot(uint8_t *image, int imageLength){
+    free(pristineImage);
+
+    pristineImage = malloc(imageLength > 0 ? imageLength : 1);
+    if (!pristineImage) return false;
+
+    memcpy(pristineImage, image, imageLength);
+    pristineImageLength = imageLength;
+
+    for (int i = 0; i < poolCount; i++) {
+        pool[i].holdsImage = (pool[i].floor == image);          // only the space we loaded into has it so far
+        clearDirtyPages(&pool[i]);
+    }
+
+    if (verbose) {
+        printf("Pristine image captured: %d bytes.\n", imageLength);
+    }
+
+    return true;
+}
+
+
+/**
+ *  Puts back every page the last run touched. Pages overlapping the image are copied from the
+ *  pristine snapshot, everything above it goes back to zero. Untouched pages are never visited,
+ *  so the cost follows the run, not the size of the sandbox.
+ *
+ *  @param space the address space to reset
+ *
+ *  @return the number of pages restored
+ */
+int resetAddressSpace(AddressSpace *space){
+    if (!space) return 0;
+
+    int restored = space->dirtyPageCount;
+
+    for (int i = 0; i < space->dirtyPageCount; i++) {
+        int page = space->dirtyPageList[i];
+        int start = page << GUEST_PAGE_SHIFT;
+        int end = start + GUEST_PAGE_SIZE;
+
+        int fromImage = 0;
+        if (start < pristineImageLength) {
+            fromImage = (pristineImageLength < end ? pristineImageLength : end) - start;
+            memcpy(space->floor + start, pristineImage + start, fromImage);
+        }
+
+        memset(space->floor + start + fromImage, 0, GUEST_PAGE_SIZE - fromImage);
+    }
+
+    if (space->codeWrittenStart < space->codeWrittenEnd) {
+        if (space == activeAddressSpace) invalidateCode(space->codeWrittenStart, space->codeWrittenEnd);     // the program is back as loaded
+        space->codeWrittenStart = space->codeWrittenEnd = 0;
+    }
+
+    clearDirtyPages(space);
+
+    if (verbose) {
+        printf("Address space reset: %d of %d pages restored.\n", restored, space->pageCount);
+    }
+
+    return restored;
+}
+
+
+/**
+ *  Notes that the page holding the given physical address has been written. Called from every
+ *  store path in the memory manager; the common case is a single byte test.
+ *
+ *  @param address the physical address that was written
+ */
+void markPageDirty(uint8_t *address){
+    guestEffects++;                             // a store, for the idle loop check
+    markPageDirtyIn(activeAddressSpace, address);
+}
+
+
+/**
+ *  Notes a write to a page of the given address space, which need not be the active one.
+ *
+ *  @param space   the address space written to
+ *  @param address the physical address that was written
+ */
+void markPageDirtyIn(AddressSpace *space, uint8_t *address){
+    if (!space) return;
+
+    long offset = address - space->floor;
+    if (offset < 0 || offset >= space->mappedBytes) return;
+
+    int page = (int)(offset >> GUEST_PAGE_SHIFT);
+    if (space->dirtyPageMap[page]) return;
+
+    space->dirtyPageMap[page] = 1;
+    space->dirtyPageList[space->dirtyPageCount++] = page;
+}
+
+
+/**
+ *  Forgets which pages have been written without touching their contents.
+ *
+ *  @param space the address space to clear
+ */
+void clearDirtyPages(AddressSpace *space){
+    for (int i = 0; i < space->dirtyPageCount; i++) {
+        space->dirtyPageMap[space->dirtyPageList[i]] = 0;
+    }
+
+    space->dirtyPageCount = 0;
+}
+
+
+/**
+ *  Catches the fault raised by a store into a trapped page. The page is opened back up so the store can
+ *  finish when we return, and the address is left in writeTrapAddress for whoever set the trap. Any other
+ *  fault is a real crash, so the default handler is put back and the fault happens again.
+ */
+void writeTrapFaulted(int signal, siginfo_t *info, void *context){
+    (void)context;
+
+    AddressSpace *space = activeAddressSpace;
+    uint8_t *address = info->si_addr;
+
+    if (space && address >= space->floor && address < space->floor + space->mappedBytes) {
+        int page = (int)((address - space->floor) >> GUEST_PAGE_SHIFT);
+
+        if (space->trappedPageMap[page]) {
+            mprotect(space->floor + ((size_t)page << GUEST_PAGE_SHIFT), GUEST_PAGE_SIZE, PROT_READ | PROT_WRITE);
+            space->trappedPageMap[page] = 0;
+
+            writeTrapAddress = address;
+            writeTrapTripped = 1;
+            return;
+        }
+    }
+
+    struct sigaction fallback;
+    memset(&fallback, 0, sizeof(fallback));
+    fallback.sa_handler = SIG_DFL;
+    sigaction(signal, &fallback, NULL);
+}
+
+
+/**
+ *  Installs the fault handler behind write traps. Safe to call more than once.
+ */
+void installWriteTrap(){
+    static bool installed = false;
+    if (installed) return;
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_sigaction = writeTrapFaulted;
+    action.sa_flags = SA_SIGINFO | SA_NODEFER;
+    sigemptyset(&action.sa_mask);
+
+    sigaction(SIGSEGV, &action, NULL);
+    sigaction(SIGBUS, &action, NULL);
+
+    installed = true;
+}
+
+
+/**
+ *  Write protects one page of the address space so the next guest store to it trips writeTrapTripped.
+ *  The trap fires once; set it again after it trips to keep watching. Pages without a trap run at full speed.
+ *
+ *  @param space    the address space holding the page
+ *  @param page     the page number, counted from the sandbox floor
+ *  @param trapped  TRUE to set the trap, FALSE to take it away
+ *
+ *  @return FALSE if the page is out of range or could not be protected
+ */
+bool trapWritesToPage(AddressSpace *space, int page, bool trapped){
+    if (!space || page < 0 || page >= space->pageCount) return false;
+
+    installWriteTrap();
+
+    int protection = trapped ? PROT_READ : PROT_READ | PROT_WRITE;
+    if (mprotect(space->floor + ((size_t)page << GUEST_PAGE_SHIFT), GUEST_PAGE_SIZE, protection) != 0) return false;
+
+    space->trappedPageMap[page] = trapped;
+    return true;
+}
+
+
+/**
+ *  Takes every write trap off the address space. Must be done before the host itself writes to those
+ *  pages, e.g. when resetting or restoring a snapshot.
+ *
+ *  @param space the address space to clear
+ */
+void clearWriteTraps(AddressSpace *space){
+    if (!space) return;
+
+    for (int page = 0; page < space->pageCount; page++) {
+        if (space->trappedPageMap[page]) trapWritesToPage(space, page, false);
+    }
+}
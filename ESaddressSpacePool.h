@@ -0,0 +1,62 @@
+//
+//  ESaddressSpacePool.h
+//  Eighty-Sixer
+//
+//  Created by agent on 10/19/26.
+//  Copyright (c) 2026 agent. All rights reserved.
+//
+
+#ifndef __Eighty_Sixer__ESaddressSpacePool__
+#define __Eighty_Sixer__ESaddressSpacePool__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <signal.h>
+
+#define GUEST_PAGE_SHIFT    12
+#define GUEST_PAGE_SIZE     (1 << GUEST_PAGE_SHIFT)
+
+typedef struct AddressSpace {
+    uint8_t *floor;                 // the bottom of the sandbox, always page aligned
+    int      mappedBytes;           // the requested size rounded up to whole pages
+    int      pageCount;
+
+    uint8_t *dirtyPageMap;          // one byte per page, set the first time the page is written
+    int     *dirtyPageList;         // the dirtied pages in the order they were touched
+    int      dirtyPageCount;
+
+    uint8_t *trappedPageMap;        // one byte per page, set while the page is write protected by a trap
+    int      codeWrittenStart;      // the bytes of the program image stored to since the last reset, none if start >= end
+    int      codeWrittenEnd;
+
+    bool     holdsImage;            // TRUE once the pristine program image has been copied in
+    bool     inUse;
+} AddressSpace;
+
+extern AddressSpace *activeAddressSpace;
+extern int addressSpacePoolSize;
+
+extern uint8_t *pristineImage;
+extern int pristineImageLength;
+
+bool setupAddressSpacePool(int, int);
+AddressSpace *acquireAddressSpace();
+void releaseAddressSpace(AddressSpace*);
+
+bool takePristineSnapshot(uint8_t*, int);
+int  resetAddressSpace(AddressSpace*);
+
+void markPageDirty(uint8_t*);
+void markPageDirtyIn(AddressSpace*, uint8_t*);
+void clearDirtyPages(AddressSpace*);
+
+extern volatile sig_atomic_t writeTrapTripped;
+extern uint8_t * volatile writeTrapAddress;
+
+void installWriteTrap();
+bool trapWritesToPage(AddressSpace*, int, bool);
+void clearWriteTraps(AddressSpace*);
+
+#endif /* defined(__Eighty_Sixer__ESaddressSpacePool__) */
@@ -8,454 +8,192 @@
 
 #include "ESalu.h"
 
-/* REGISTER ENCODINGS
-    %eax		0
-	%ecx		1
-	%edx		2
-	%ebx		3
-	%esp		4
-	%ebp		5
-	%esi		6
-	%edi		7
- */
-
-int  registerA = 0;
-int  registerB = 0;
-int  registerC = 0;
-int  registerD = 0;
-
 int stepCount = 0;
 
-int  sourceIndexPointer = 0;
-int  destinationIndexPointer = 0;
-
 bool zeroFlag       = false;
 bool signFlag       = false;
 bool overflowFlag   = false;
 
+unsigned int isaExtensions = 0;         // EXTENSION_* bits, all off so plain Y86 programs run as they always have
+int wordBits = 32;                      // 64 for Y86-64, from --y86-64 or the image header
+bool tracing = false;                   // print every instruction as it runs, see --trace
 
-/** ALU OPERATIONS **/
-
-void halt(){
-    if (verbose) {
-        printf("HALTING\n");
-    }
-
-    quit(HALT);
-}
-
-void noop(){                // no operation. waiting
-    if (verbose) {
-        printf("NO OPERATION\n");
-    }
-
-}
-
-void rrmovl(){              // register to register move long
-    if (verbose) {
-        printf("Register-Register Move Long\n");
-    }
-
-    uint8_t registers = readNextInstructionByte();
-    int *regA = registerAtIndex((registers & 0xF0) >> 4);
-    int *regB = registerAtIndex(registers & 0xF);
-
-    *regB = *regA;          // move contents of register A into register B
-}
-
-void irmovl(){              // immediate to register move long
-    if (verbose) {
-        printf("Immediate-Register Move Long: ");
-    }
-
-    uint8_t registers = readNextInstructionByte();
-    int *regB = registerAtIndex(registers & 0xF);
-
-    int value = 0;
-    for (int i = 0; i < 32; i += 8) {                       // reading value bytes little endian
-        value |= ((int)readNextInstructionByte() << i);
-    }
-
-    if (verbose) printf("%#x\n", value);
-
-    *regB = value;
-}
-
-void rmmovl(){
-    if (verbose) {
-        printf("Register-Memory Move Long: ");
-    }
-
-    uint8_t registers = readNextInstructionByte();
-
-    int *regA = registerAtIndex((registers & 0xF0) >> 4);
-    int *regB = registerAtIndex(registers & 0xF);
-
-    int value = 0;
-    for (int i = 0; i < 24; i += 8) {
-        value |= ((int)readNextInstructionByte() << i);
-    }
-
-    if (verbose) printf("Offset %#X\n", value);
-
-    *regB += value;      // apply the offset to register B
-    regB = relativeToPhysicalAddress(*regB);
-
-    if (!setMemoryAtPhysicalAddress(regB, *regA)) quit(ADDRESS_FAULT);          // sets the memory
-}
-
-void mrmovl(){
-    if (verbose) {
-        printf("Memory-Register Move Long\n");
-    }
-
-    uint8_t registers = readNextInstructionByte();
-
-    int *regA = registerAtIndex((registers & 0xF0) >> 4);
-    int *regB = registerAtIndex(registers & 0xF);
-
-    int value = 0;
-    for (int i = 0; i < 24; i += 8) {
-        value |= ((int)readNextInstructionByte() << i);
-    }
-
-    if (verbose) printf("Offset %#x\n", value);
-
-    *regB += value;      // apply the offset to register B
-    regB = relativeToPhysicalAddress(*regB);
-
-    *regA = fetchMemoryAtPhysicalAddress(regB);
-}
-
-void arithmetic(uint8_t instruction){
-    if (verbose) {
-        printf("Arithmetic Operation: ");
-    }
-
-    uint8_t registers = readNextInstructionByte();
-
-    int *regA = registerAtIndex((registers & 0xF0) >> 4);
-    int *regB = registerAtIndex(registers & 0xF);
-
-    uint8_t functionCode = instruction & 0xF;
-    int result;
-
-    switch (functionCode) {
-        case 0:
-            if (verbose) printf("add\n");
-
-            if (*regA > 0 && *regB > INT_MAX - *regA) {             // check for overflow
-                overflowFlag = true;
-            } else if (*regA < 0 && *regB < INT_MIN - *regA) {
-                overflowFlag = true;
-            } else overflowFlag = false;
-
-            result = *regB + *regA;
-            break;
-        case 1:
-            if (verbose) printf("subtract\n");
-
-            if (*regA > 0 && *regB > INT_MAX - *regA) {             // check for overflow
-                overflowFlag = true;
-            } else if (*regA < 0 && *regB < INT_MIN - *regA) {
-                overflowFlag = true;
-            } else overflowFlag = false;
-
-            result = *regB - *regA;
-            break;
-        case 2:
-            if (verbose) printf("and\n");
-            result = *regB & *regA;
-            overflowFlag = false;               // overflow flag always unset for bitwise operations
-            break;
-        case 3:
-            if (verbose) printf("xor\n");
-            result = *regB ^ *regA;
-            overflowFlag = false;               // overflow flag always unset for bitwise operations
-            break;
-
-        default:
-            quit(INSTRUCTION_FAULT);
-            break;
-    }
-
-    if (result == 0) zeroFlag = true;           // zero flag is set when the resultant operation is a zero
-    else zeroFlag = false;
-
-    signFlag = (result >> 31);                  // sign flag is set to the leftmost bit. No need to mask, since 0 will pad 0 and 1 is true anyway
-
-
-    *regB = result;                             // store the result in register B
-}
-
-void jump(uint8_t instruction){
 
-    int value = 0;
-    for (int i = 0; i < 32; i += 8) {
-        value |= ((int)readNextInstructionByte() << i);
-    }
-
-    if (verbose) {
-        printf("Jump Operation: %#X\n", value);
-    }
-
-    uint8_t functionCode = instruction & 0xF;
+/**
+ *  Evaluates a jump or conditional move condition against the flags.
+ *
+ *  @param functionCode the ifun, 0 through 6
+ *
+ *  @return TRUE if the condition holds, FALSE if it doesn't or the ifun is not a condition
+ */
+bool conditionHolds(uint8_t functionCode){
     switch (functionCode) {
         case 0:     // always
-                                                        jumpToReadAtInternalAddress(value);
-            break;
+            return true;
         case 1:     // less than equal
-            if ((signFlag ^ overflowFlag) | zeroFlag)   jumpToReadAtInternalAddress(value);
-            break;
+            return (signFlag ^ overflowFlag) | zeroFlag;
         case 2:     // less than
-            if (signFlag ^ overflowFlag)                jumpToReadAtInternalAddress(value);
-            break;
+            return signFlag ^ overflowFlag;
         case 3:     // equal
-            if (zeroFlag)                               jumpToReadAtInternalAddress(value);
-            break;
+            return zeroFlag;
         case 4:     // not equal
-            if (!zeroFlag)                              jumpToReadAtInternalAddress(value);
-            break;
+            return !zeroFlag;
         case 5:     // greater than equal
-            if ( ~(signFlag ^ overflowFlag))            jumpToReadAtInternalAddress(value);
-            break;
+            return !(signFlag ^ overflowFlag);
         case 6:     // greater than
-            if (~(signFlag ^ overflowFlag) & ~zeroFlag) jumpToReadAtInternalAddress(value);
-            break;
+            return !(signFlag ^ overflowFlag) && !zeroFlag;
 
         default:
-            quit(INSTRUCTION_FAULT);
-            break;
+            return false;
     }
-
 }
 
-void cmov(uint8_t instruction){
-    if (verbose) {
-        printf("Conditional Move:\n");
-    }
-
-    uint8_t registers = readNextInstructionByte();
-
-    int *regA = registerAtIndex((registers & 0xF0) >> 4);
-    int *regB = registerAtIndex(registers & 0xF);
 
-    uint8_t functionCode = instruction & 0xF;
-    switch (functionCode) {
-        case 1:     // less than equal
-            if ((signFlag ^ overflowFlag) | zeroFlag)   *regB = *regA;
-            break;
-        case 2:     // less than
-            if (signFlag ^ overflowFlag)                *regB = *regA;
-            break;
-        case 3:     // equal
-            if (zeroFlag)                               *regB = *regA;
-            break;
-        case 4:     // not equal
-            if (!zeroFlag)                              *regB = *regA;
-            break;
-        case 5:     // greater than equal
-            if ( ~(signFlag ^ overflowFlag))            *regB = *regA;
-            break;
-        case 6:     // greater than
-            if (~(signFlag ^ overflowFlag) & ~zeroFlag) *regB = *regA;
-            break;
+#define WORD_BITS 32                    // everything word sized, once per width. See ESwordWidth.h
+#include "ESwordWidth.h"
+#include "ESaluCore.inc"
+#include "ESaluVariants.inc"            // and the handlers once per variant of each width
+#undef WORD_BITS
 
-        default:
-            quit(INSTRUCTION_FAULT);
-            break;
-    }
+#define WORD_BITS 64
+#include "ESwordWidth.h"
+#include "ESaluCore.inc"
+#include "ESaluVariants.inc"
+#undef WORD_BITS
 
-}
 
-void call(){
-    int value = 0;
-    for (int i = 0; i < 32; i += 8) {
-        value |= ((int)readNextInstructionByte() << i);
-    }
+bool (*startCycle)()                = startCyclePlain;
+void (*executeInstruction)(uint8_t) = executeInstructionPlain;
+void (*runProgram)()                = runProgramPlain;
 
-    if (verbose) {
-        printf("Call: %#X", value);
-    }
+bool (*startCycle64)()                = startCycle64Plain;
+void (*executeInstruction64)(uint8_t) = executeInstruction64Plain;
+void (*runProgram64)()                = runProgram64Plain;
 
-    pushToStack(physicalToRelativeAddress((int *)currentInstructionByte));
-    jumpToReadAtInternalAddress(value);
 
-}
+/**
+ *  Picks the interpreter to run for the modes that are on, once, before the first step: the cheapest variant
+ *  whose instrumentation covers all of them. With none on that's the plain one, which has none at all. With none
+ *  but --stats, the program loop runs whatever the verifier could prove without the fetch checks. With none at all
+ *  and --optimize, it runs the optimized blocks of ESir.c instead.
+ */
+void selectInterpreter(){
+    unsigned int wanted = (profiling ? INSTRUMENT_PROFILE : 0) | (tracing ? INSTRUMENT_TRACE : 0) | (verbose ? INSTRUMENT_VERBOSE : 0) |
+                          (collectingStats ? INSTRUMENT_STATS : 0) | (pluginEvents ? INSTRUMENT_PLUGIN : 0) |
+                          (memoizing ? INSTRUMENT_MEMO : 0) | (hostCounting ? INSTRUMENT_COUNTERS : 0);
 
-void ret(){
-    if (verbose) {
-        printf("RETURN\n");
-    }
+    int i = 0;
+    while (i < INTERPRETER_VARIANTS - 1 && (interpreterVariants[i].features & wanted) != wanted) i++;
 
-    jumpToReadAtInternalAddress(popFromStack());
-    
-}
+    startCycle         = interpreterVariants[i].startCycle;
+    executeInstruction = interpreterVariants[i].executeInstruction;
+    runProgram         = interpreterVariants[i].runProgram;
 
-void pushl(){
-    uint8_t registers = readNextInstructionByte();
-    int *regA = registerAtIndex((registers & 0xF0) >> 4);
-    if ((registers & 0xF) != 0xF) quit(INSTRUCTION_FAULT);        // make sure the second register is the null register 0xF
+    startCycle64         = interpreterVariants64[i].startCycle;       // the tables list the variants in the same order
+    executeInstruction64 = interpreterVariants64[i].executeInstruction;
+    runProgram64         = interpreterVariants64[i].runProgram;
 
-    if (verbose) {
-        printf("Push Long: %d\n", *regA);
+    if (!(wanted & ~(INSTRUMENT_STATS | INSTRUMENT_COUNTERS)) && !debugging && wordBits == 32 && verifyProgram()) {      // the verified variant counts too
+        runProgram = runProgramVerified;                                    // only the main loop, the others step one at a time
     }
 
-    pushToStack(*regA);
-    
-}
-
-void popl(){
-    if (verbose) {
-        printf("Pop Long\n");
+    if (optimizing && !wanted && !debugging && wordBits == 32 && programControlFlow()) {      // no instrumentation to keep up per step
+        runProgram = runOptimizedProgram;
     }
 
-    uint8_t registers = readNextInstructionByte();
-    int *regA = registerAtIndex((registers & 0xF0) >> 4);
-    if ((registers & 0xF) != 0xF) quit(INSTRUCTION_FAULT);        // make sure the second register is the null register 0xF
-
-    *regA = popFromStack();
+    if (verbose) printf("\nInterpreter variant: %s\n", interpreterVariants[i].name);
 }
 
 
 /**
- *  Begins execution of the stored program code at whatever the current program counter is
+ *  Prints one line of the --trace: the step, where the instruction is and what it is. Y86 instructions are
+ *  disassembled from memory as it is now; Y86-64 ones only show their first byte.
  *
- *  @return FALSE if an error occurred
+ *  @param address     the address of the instruction
+ *  @param instruction its icode/ifun byte
  */
-bool startCycle(){
-    uint8_t instruction = readNextInstructionByte();
-    if (verbose) printf("Running Instruction Code: %#02X at address 0x%04X\n", instruction, physicalToRelativeAddress((int *)currentInstructionByte));
-
-    stepCount++;                                           // (gate * stepcount) / time = speed
-
-    switch ((instruction & 0xF0) >> 4) {                   // mask to the leftmost nibble (icode) (tasty)
-        case 0:
-            halt();
-            break;
-        case 1:
-            noop();
-            break;
-        case 2:
-            if ((instruction & 0xF) == 0) {                // the code 2 performs cmove if the ifun (rightmost byte) is set
-                rrmovl();
-            }else{
-                cmov(instruction);
-            }
-            break;
-        case 3:
-            irmovl();
-            break;
-        case 4:
-            rmmovl();
-            break;
-        case 5:
-            mrmovl();
-            break;
-        case 6:
-            arithmetic(instruction);
-            break;
-        case 7:
-            jump(instruction);
-            break;
-        case 8:
-            call();
-            break;
-        case 9:
-            ret();
-            break;
-        case 0xA:
-            pushl();
-            break;
-        case 0xB:
-            popl();
-            break;
+void traceStep(int address, uint8_t instruction){
+    if (wordBits == 32) {
+        DecodedInstruction decoded;
+        char text[64];
 
-        default:
-            quit(INSTRUCTION_FAULT);            // if the icode is not one of the listed ones, we're screwed
-            break;
+        decodeInstruction(sandboxFloor, (int)(lastInstructionByte - sandboxFloor) + 1, address, &decoded);
+        printf("%8d  0x%04X  %s\n", stepCount, address, describeInstruction(&decoded, text, sizeof(text)));
+    } else {
+        printf("%8d  0x%04X  %02X\n", stepCount, address, instruction);
     }
-
-    printf("\n");
-
-    return true;
 }
 
 
-int *registerAtIndex(int index){
-    switch (index) {
-        case 0:
-            return &registerA;
-        case 1:
-            return &registerC;
-        case 2:
-            return &registerD;
-        case 3:
-            return &registerB;
-        case 4:
-            return (int *)&stackPointer;
-        case 5:
-            return (int *)&framePointer;
-        case 6:
-            return &sourceIndexPointer;
-        case 7:
-            return &destinationIndexPointer;
+/**
+ *  Clears every register and flag and zeroes the step counter, ready for a fresh run of the same program.
+ *  The stack and frame pointers belong to the memory manager and are rewound there.
+ */
+void resetProcessorState(){
+    memset(registerFile, 0, sizeof(registerFile));
+    memset(registerFile64, 0, sizeof(registerFile64));
 
+    zeroFlag     = false;
+    signFlag     = false;
+    overflowFlag = false;
 
-        default:
-            return NULL;
-            break;
-    }
+    stepCount = 0;
 }
 
 
-void printHarmonFormattedTrace(char *status){
-
-    /* FORMATS PER:
-
-     Steps: 43
-     PC: 0x00000108
-     Status: HLT
-     CZ: 0
-     CS: 0
-     CO: 0
-     %eax: 0x0000001C
-     %ecx: 0x00000000
-     %edx: 0x00000000
-     %ebx: 0xFFFFFFFD
-     %esp: 0xFFFFFFDC
-     %ebp: 0x00000100
-     %esi: 0x00000000
-     %edi: 0x0000A001
-
-     */
-    printf("\n\n");
-    printf("Steps: %d\n", stepCount);
-    printf("PC: 0x%08X\n", physicalToRelativeAddress((int *)currentInstructionByte));
-    printf("Status: %s\n", status);
-    printf("CZ: %1d\n", zeroFlag);
-    printf("CS: %1d\n", signFlag);
-    printf("CO: %1d\n", overflowFlag);
-    printf("%%eax: 0x%08X\n", registerA);
-    printf("%%ecx: 0x%08X\n", registerC);
-    printf("%%edx: 0x%08X\n", registerD);
-    printf("%%ebx: 0x%08X\n", registerB);
-    printf("%%esp: 0x%08X\n", (int)stackPointer);
-    printf("%%ebp: 0x%08X\n", (int)framePointer);
-    printf("%%esi: 0x%08X\n", sourceIndexPointer);
-    printf("%%edi: 0x%08X\n", destinationIndexPointer);
+/**
+ *  Copies every register, flag and the step counter out of the ALU.
+ *
+ *  @param state where to put the copy
+ */
+void saveProcessorState(ProcessorState *state){
+    for (int i = 0; i < 8; i++) {
+        state->registers[i] = (i == 4 || i == 5) ? 0 : *registerAtIndex(i);
+    }
 
+    state->zeroFlag     = zeroFlag;
+    state->signFlag     = signFlag;
+    state->overflowFlag = overflowFlag;
+    state->stepCount    = stepCount;
 }
 
 
+/**
+ *  Loads every register, flag and the step counter back into the ALU.
+ *
+ *  @param state the state to load, as written by saveProcessorState()
+ */
+void restoreProcessorState(const ProcessorState *state){
+    for (int i = 0; i < 8; i++) {
+        if (i == 4 || i == 5) continue;         // the memory manager restores the stack and frame pointers
+        *registerAtIndex(i) = state->registers[i];
+    }
 
+    zeroFlag     = state->zeroFlag;
+    signFlag     = state->signFlag;
+    overflowFlag = state->overflowFlag;
+    stepCount    = state->stepCount;
+}
 
 
+/**
+ *  Looks up a register by its assembly name, with or without the leading %. Y86-64 names work too, e.g. "%r8",
+ *  whatever the width turns out to be; the caller checks the register exists once the program is loaded.
+ *
+ *  @param name the register name, e.g. "%eax"
+ *
+ *  @return the register encoding, or -1 if there is no such register
+ */
+int registerIndexForName(const char *name){
+    if (name[0] == '%') name++;
 
+    for (int i = 0; i < 8; i++) {
+        if (!strcmp(name, registerNames[i])) return i;
+    }
 
+    for (int i = 0; i < 15; i++) {
+        if (!strcmp(name, registerNames64[i])) return i;
+    }
 
-
-
-
-
-
+    return -1;
+}
@@ -16,7 +16,67 @@
 #include <stdint.h>
 #include "ESmemoryManager.h"
 
-bool startCycle();
+#define EXTENSION_IADDL     0x1         // iaddl V, rB           C0 FrB V
+#define EXTENSION_LEAVE     0x2         // leave                 D0
+#define EXTENSION_MULDIV    0x4         // mull, divl, modl      64, 65, 66 rArB
+#define EXTENSION_BLOCK     0x8         // memcpy, memset        E0, E1
+#define EXTENSION_TRAP      0x10        // trap                  F1, host files, see --files
+
+#define INSTRUMENT_PROFILE  0x1         // call and return hooks for the profiler, see ESinstrumentation.h
+#define INSTRUMENT_TRACE    0x2         // a line per instruction, see --trace
+#define INSTRUMENT_VERBOSE  0x4         // the running commentary of -v
+#define VERIFIED_FETCH      0x8         // fetches and direct jumps skip their bounds checks, see ESverifier.c
+#define INSTRUMENT_STATS    0x10        // the counters behind --stats
+#define INSTRUMENT_PLUGIN   0x20        // the events plugins subscribe to, see ESplugins.c
+#define INSTRUMENT_MEMO     0x40        // following calls to skip the pure ones, see ESmemo.c
+#define INSTRUMENT_COUNTERS 0x80        // sampling the host's counters around dispatches, see EShostCounters.c
+
+#define INTERPRETER_VARIANTS 8          // see ESaluVariants.inc
+
+typedef struct ProcessorState {
+    int  registers[8];              // by register encoding. %esp and %ebp live in the memory manager and are left zero
+    bool zeroFlag;
+    bool signFlag;
+    bool overflowFlag;
+    int  stepCount;
+} ProcessorState;
+
+typedef struct InterpreterVariant {
+    const char   *name;
+    unsigned int  features;             // the INSTRUMENT_ bits compiled into it
+    bool (*startCycle)();
+    void (*executeInstruction)(uint8_t);
+    void (*runProgram)();
+} InterpreterVariant;
+
+extern const InterpreterVariant interpreterVariants[INTERPRETER_VARIANTS];
+
+extern bool (*startCycle)();                // the selected variant's, see selectInterpreter()
+extern void (*executeInstruction)(uint8_t);
+extern void (*runProgram)();
+void selectInterpreter();
+void stepProgramVerified();
+int  readNextInstructionWord();
+bool conditionHolds(uint8_t);
+bool extendedArithmetic(uint8_t, int, int, int*, bool*);
+
+extern unsigned int isaExtensions;
+extern int wordBits;
+extern bool tracing;
+
+void traceStep(int, uint8_t);
+
+extern bool (*startCycle64)();              // the same again for Y86-64, see ESaluCore.inc
+extern void (*executeInstruction64)(uint8_t);
+extern void (*runProgram64)();
+int64_t  readNextInstructionWord64();
+bool     extendedArithmetic64(uint8_t, int64_t, int64_t, int64_t*, bool*);
+int64_t *registerAtIndex64(int);
+void     printHarmonFormattedTrace64(const char*);
+
+extern int registerFile[8];
+extern const char *registerNames[8];
+extern const char *registerNames64[15];
 
 extern bool zeroFlag;
 extern bool signFlag;
@@ -24,8 +84,12 @@ extern bool overflowFlag;
 
 extern int stepCount;
 
-void printHarmonFormattedTrace(char*);
+void printHarmonFormattedTrace(const char*);
 
 int *registerAtIndex(int);
+int  registerIndexForName(const char*);
+void resetProcessorState();
+void saveProcessorState(ProcessorState*);
+void restoreProcessorState(const ProcessorState*);
 
 #endif /* defined(__Eighty_Sixer__ESalu__) */
@@ -0,0 +1,607 @@
+//
+//  ESassembler.c
+//  Eighty-Sixer
+//
+//  Created by agent on 10/19/26.
+//  Copyright (c) 2026 agent. All rights reserved.
+//
+
+#include "ESassembler.h"
+#include "main.h"
+#include <ctype.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <stdarg.h>
+
+/*  A two pass assembler for .ys source, in the syntax of the CS:APP yas tool. The first pass lays the program out
+    and collects labels, the second resolves them and writes every byte straight into the sandbox, so the program
+    is loaded exactly as if its hex had come in on standard input. Mnemonics take the suffix of the word size the
+    program runs at: irmovl and .long for Y86, irmovq and .quad for Y86-64.
+
+    Comments are # to the end of the line or C style block comments. Commas between operands are optional.
+ */
+
+typedef enum OperandForm {
+    OPERANDS_NONE,              // halt
+    OPERANDS_RR,                // addl %eax, %ebx
+    OPERANDS_IR,                // irmovl $5, %eax
+    OPERANDS_RM,                // rmmovl %eax, 8(%ebx)
+    OPERANDS_MR,                // mrmovl 8(%ebx), %eax
+    OPERANDS_DEST,              // jmp loop
+    OPERANDS_R                  // pushl %eax
+} OperandForm;
+
+typedef struct AssemblerMnemonic {
+    const char *name;
+    bool        sized;          // takes the l or q suffix
+    uint8_t     code;           // the icode/ifun byte
+    OperandForm form;
+} AssemblerMnemonic;
+
+typedef struct AssemblerLabel {
+    const char *name;           // points into the source, not terminated. NULL for an empty slot
+    int         length;
+    int         address;
+    int         line;
+} AssemblerLabel;
+
+const char *sourcePath = NULL;
+
+AssemblerMnemonic assemblerMnemonics[] = {
+    { "halt",   false, 0x00, OPERANDS_NONE },
+    { "nop",    false, 0x10, OPERANDS_NONE },
+    { "rrmov",  true,  0x20, OPERANDS_RR },
+    { "cmovle", false, 0x21, OPERANDS_RR },
+    { "cmovl",  false, 0x22, OPERANDS_RR },
+    { "cmove",  false, 0x23, OPERANDS_RR },
+    { "cmovne", false, 0x24, OPERANDS_RR },
+    { "cmovge", false, 0x25, OPERANDS_RR },
+    { "cmovg",  false, 0x26, OPERANDS_RR },
+    { "irmov",  true,  0x30, OPERANDS_IR },
+    { "rmmov",  true,  0x40, OPERANDS_RM },
+    { "mrmov",  true,  0x50, OPERANDS_MR },
+    { "add",    true,  0x60, OPERANDS_RR },
+    { "sub",    true,  0x61, OPERANDS_RR },
+    { "and",    true,  0x62, OPERANDS_RR },
+    { "xor",    true,  0x63, OPERANDS_RR },
+    { "mul",    true,  0x64, OPERANDS_RR },         // the ISA extensions assemble whether or not they're on,
+    { "div",    true,  0x65, OPERANDS_RR },         // the same as any other bytes the CPU would fault on
+    { "mod",    true,  0x66, OPERANDS_RR },
+    { "jmp",    false, 0x70, OPERANDS_DEST },
+    { "jle",    false, 0x71, OPERANDS_DEST },
+    { "jl",     false, 0x72, OPERANDS_DEST },
+    { "je",     false, 0x73, OPERANDS_DEST },
+    { "jne",    false, 0x74, OPERANDS_DEST },
+    { "jge",    false, 0x75, OPERANDS_DEST },
+    { "jg",     false, 0x76, OPERANDS_DEST },
+    { "call",   false, 0x80, OPERANDS_DEST },
+    { "ret",    false, 0x90, OPERANDS_NONE },
+    { "push",   true,  0xA0, OPERANDS_R },
+    { "pop",    true,  0xB0, OPERANDS_R },
+    { "iadd",   true,  0xC0, OPERANDS_IR },
+    { "leave",  false, 0xD0, OPERANDS_NONE },
+    { "memcpy", false, 0xE0, OPERANDS_NONE },
+    { "memset", false, 0xE1, OPERANDS_NONE },
+    { "trap",   false, 0xF1, OPERANDS_NONE },
+};
+
+AssemblerLabel *assemblerLabels = NULL;         // open addressing, capacity a power of two
+int assemblerLabelCapacity = 0;
+int assemblerLabelCount = 0;
+
+int  assemblerPass;                 // 1 lays the program out, 2 emits it
+int  assemblerAddress;
+int  assemblerImageEnd;
+int  assemblerLine;
+int  assemblerErrors;
+bool assemblerInComment;            // inside a block comment that started on an earlier line
+bool assemblerLineFailed;           // one error per line, the rest tend to be knock-on
+
+const char *assemblerLineStart;
+const char *assemblerLineEnd;
+
+
+/**
+ *  Reports an error on the current line, with the line itself.
+ */
+void assemblerError(const char *format, ...){
+    if (assemblerLineFailed) return;
+
+    assemblerLineFailed = true;
+    if (++assemblerErrors > ASSEMBLER_MAX_ERRORS) return;
+
+    va_list arguments;
+    va_start(arguments, format);
+
+    printf("%s:%d: ", sourcePath, assemblerLine);
+    vprintf(format, arguments);
+    printf("\n    %.*s\n", (int)(assemblerLineEnd - assemblerLineStart), assemblerLineStart);
+
+    va_end(arguments);
+}
+
+
+/** LABELS **/
+
+unsigned int hashLabel(const char *name, int length){
+    unsigned int hash = 2166136261u;                // FNV-1a
+
+    for (int i = 0; i < length; i++) {
+        hash = (hash ^ (uint8_t)name[i]) * 16777619u;
+    }
+
+    return hash;
+}
+
+/**
+ *  Finds the slot for a label: the one holding it, or the empty one it would go in.
+ */
+AssemblerLabel *labelSlot(const char *name, int length){
+    unsigned int mask = assemblerLabelCapacity - 1;
+
+    for (unsigned int i = hashLabel(name, length) & mask; ; i = (i + 1) & mask) {
+        AssemblerLabel *slot = &assemblerLabels[i];
+        if (!slot->name || (slot->length == length && !memcmp(slot->name, name, length))) return slot;
+    }
+}
+
+bool growLabels(){
+    int capacity = assemblerLabelCapacity ? assemblerLabelCapacity * 2 : 256;
+    AssemblerLabel *old = assemblerLabels;
+    int oldCapacity = assemblerLabelCapacity;
+
+    assemblerLabels = calloc(capacity, sizeof(AssemblerLabel));
+    if (!assemblerLabels) {
+        assemblerLabels = old;
+        return false;
+    }
+
+    assemblerLabelCapacity = capacity;
+
+    for (int i = 0; i < oldCapacity; i++) {
+        if (old[i].name) *labelSlot(old[i].name, old[i].length) = old[i];
+    }
+
+    free(old);
+    return true;
+}
+
+/**
+ *  Gives a label the current address. Labels are only collected on the first pass.
+ */
+void defineLabel(const char *name, int length){
+    if (assemblerPass != 1) return;
+
+    if (isdigit((unsigned char)name[0]) || name[0] == '.') {
+        assemblerError("'%.*s' can't be a label, labels start with a letter or _", length, name);
+        return;
+    }
+
+    if ((assemblerLabelCount + 1) * 2 > assemblerLabelCapacity && !growLabels()) {
+        assemblerError("out of memory for labels");
+        return;
+    }
+
+    AssemblerLabel *slot = labelSlot(name, length);
+
+    if (slot->name) {
+        assemblerError("'%.*s' is already defined on line %d", length, name, slot->line);
+        return;
+    }
+
+    slot->name    = name;
+    slot->length  = length;
+    slot->address = assemblerAddress;
+    slot->line    = assemblerLine;
+    assemblerLabelCount++;
+}
+
+
+/** LEXING **/
+
+/**
+ *  Moves past spaces, commas and comments, stopping at the end of the line.
+ */
+void skipBlank(const char **cursor){
+    const char *p = *cursor;
+
+    while (p < assemblerLineEnd) {
+        if (assemblerInComment) {
+            if (p + 1 < assemblerLineEnd && p[0] == '*' && p[1] == '/') {
+                assemblerInComment = false;
+                p += 2;
+            } else p++;
+        } else if (*p == ' ' || *p == '\t' || *p == ',' || *p == '\r') {
+            p++;
+        } else if (*p == '#') {
+            p = assemblerLineEnd;
+        } else if (p + 1 < assemblerLineEnd && p[0] == '/' && p[1] == '*') {
+            assemblerInComment = true;
+            p += 2;
+        } else break;
+    }
+
+    *cursor = p;
+}
+
+int identifierLength(const char *p){
+    int length = 0;
+
+    while (p + length < assemblerLineEnd && (isalnum((unsigned char)p[length]) || p[length] == '_' || p[length] == '.')) length++;
+
+    return length;
+}
+
+bool parseRegister(const char **cursor, int *index){
+    skipBlank(cursor);
+
+    const char *p = *cursor;
+    if (p >= assemblerLineEnd || *p != '%') {
+        assemblerError("expected a register");
+        return false;
+    }
+
+    int length = identifierLength(++p);
+    const char **names = wordBits == 64 ? registerNames64 : registerNames;
+    int count = wordBits == 64 ? 15 : 8;
+
+    for (int i = 0; i < count; i++) {
+        if ((int)strlen(names[i]) != length || strncmp(names[i], p, length)) continue;
+
+        *index = i;
+        *cursor = p + length;
+        return true;
+    }
+
+    assemblerError("unknown register '%%%.*s'", length, p);
+    return false;
+}
+
+/**
+ *  Reads an immediate, a displacement or a destination: a number, decimal or 0x hex, or a label, with or without $.
+ */
+bool parseValue(const char **cursor, int64_t *value){
+    skipBlank(cursor);
+
+    const char *p = *cursor;
+    if (p < assemblerLineEnd && *p == '$') p++;
+
+    if (p < assemblerLineEnd && (isdigit((unsigned char)*p) || *p == '-' || *p == '+')) {
+        bool negative = *p == '-';
+        if (*p == '-' || *p == '+') p++;
+
+        if (p >= assemblerLineEnd || !isdigit((unsigned char)*p)) {
+            assemblerError("expected a number");
+            return false;
+        }
+
+        char *stop;
+        errno = 0;
+        unsigned long long magnitude = strtoull(p, &stop, 0);
+
+        if (errno == ERANGE || (negative && magnitude > (1ULL << 63))) {
+            assemblerError("%.*s is too big", (int)(stop - *cursor), *cursor);
+            return false;
+        }
+
+        *value  = negative ? (int64_t)(0 - magnitude) : (int64_t)magnitude;
+        *cursor = stop;
+        return true;
+    }
+
+    int length = identifierLength(p);
+    if (!length || *p == '.') {
+        assemblerError("expected a number or a label");
+        return false;
+    }
+
+    *cursor = p + length;
+
+    if (assemblerPass == 1) {                       // not every label is known yet, and the layout doesn't need them
+        *value = 0;
+        return true;
+    }
+
+    AssemblerLabel *label = assemblerLabelCapacity ? labelSlot(p, length) : NULL;
+    if (!label || !label->name) {
+        assemblerError("undefined label '%.*s'", length, p);
+        return false;
+    }
+
+    *value = label->address;
+    return true;
+}
+
+/**
+ *  Reads a memory operand, D(%reg) or (%reg).
+ */
+bool parseMemory(const char **cursor, int64_t *displacement, int *index){
+    skipBlank(cursor);
+
+    *displacement = 0;
+    if (*cursor < assemblerLineEnd && **cursor != '(' && !parseValue(cursor, displacement)) return false;
+
+    skipBlank(cursor);
+    if (*cursor >= assemblerLineEnd || **cursor != '(') {
+        assemblerError("expected (%%reg)");
+        return false;
+    }
+
+    (*cursor)++;
+    if (!parseRegister(cursor, index)) return false;
+
+    skipBlank(cursor);
+    if (*cursor >= assemblerLineEnd || **cursor != ')') {
+        assemblerError("expected )");
+        return false;
+    }
+
+    (*cursor)++;
+    return true;
+}
+
+
+/** EMITTING **/
+
+void emitByte(uint8_t byte){
+    if (assemblerAddress < 0 || assemblerAddress >= requestedSize) {
+        assemblerError("the program runs past the top of memory, 0x%X", requestedSize);
+        return;
+    }
+
+    if (assemblerPass == 2) storeInstructionByteAt(assemblerAddress, byte);
+
+    assemblerAddress++;
+    if (assemblerAddress > assemblerImageEnd) assemblerImageEnd = assemblerAddress;
+}
+
+/**
+ *  Emits a little endian constant, as long as it fits in the given number of bytes, signed or unsigned.
+ */
+void emitConstant(int64_t value, int bytes){
+    if (bytes < 8) {
+        int64_t limit = 1LL << (bytes * 8);
+
+        if (value < -(limit / 2) || value >= limit) {
+            assemblerError("%" PRId64 " doesn't fit in %d bytes", value, bytes);
+            assemblerAddress += bytes;                  // keep the layout of the lines after it
+            return;
+        }
+    }
+
+    for (int i = 0; i < bytes; i++) {
+        emitByte((uint8_t)((uint64_t)value >> (i * 8)));
+    }
+}
+
+
+/** ASSEMBLING **/
+
+bool wordIs(const char *word, int length, const char *name){
+    return (int)strlen(name) == length && !strncmp(word, name, length);
+}
+
+AssemblerMnemonic *findMnemonic(const char *word, int length){
+    char suffix = wordBits == 64 ? 'q' : 'l';
+
+    for (int i = 0; i < (int)(sizeof(assemblerMnemonics) / sizeof(AssemblerMnemonic)); i++) {
+        AssemblerMnemonic *mnemonic = &assemblerMnemonics[i];
+        int nameLength = (int)strlen(mnemonic->name);
+
+        if (mnemonic->sized) {
+            if (length == nameLength + 1 && word[nameLength] == suffix && !strncmp(word, mnemonic->name, nameLength)) return mnemonic;
+        } else if (length == nameLength && !strncmp(word, mnemonic->name, nameLength)) return mnemonic;
+    }
+
+    return NULL;
+}
+
+void assembleDirective(const char *word, int length, const char **cursor){
+    static const char *directives[] = { ".pos", ".align", ".byte", ".word", ".long", ".quad" };
+    bool known = false;
+    int64_t value;
+
+    for (int i = 0; i < 6; i++) known |= wordIs(word, length, directives[i]);
+
+    if (!known) {
+        assemblerError("unknown directive '%.*s'", length, word);
+        return;
+    }
+
+    bool movesAddress = wordIs(word, length, ".pos") || wordIs(word, length, ".align");
+
+    skipBlank(cursor);
+    if (movesAddress && (*cursor >= assemblerLineEnd || !isdigit((unsigned char)**cursor))) {
+        assemblerError("%.*s takes a number, labels aren't placed until it is", length, word);     // the layout can't depend on them
+        return;
+    }
+
+    if (!parseValue(cursor, &value)) return;
+
+    if (wordIs(word, length, ".pos")) {
+        if (value < 0 || value > requestedSize) assemblerError(".pos 0x%" PRIX64 " is outside memory", value);
+        else assemblerAddress = (int)value;
+
+    } else if (wordIs(word, length, ".align")) {
+        if (value <= 0 || value > requestedSize) assemblerError(".align needs a positive alignment");
+        else assemblerAddress = (int)((assemblerAddress + value - 1) / value * value);
+
+    } else {
+        int bytes = wordIs(word, length, ".byte") ? 1 : wordIs(word, length, ".word") ? 2 : wordIs(word, length, ".long") ? 4 : 8;
+
+        for (;;) {                                  // data directives take a list, e.g. .byte 0x30 0xF0
+            emitConstant(value, bytes);
+
+            skipBlank(cursor);
+            if (*cursor >= assemblerLineEnd || assemblerLineFailed || !parseValue(cursor, &value)) break;
+        }
+    }
+}
+
+void assembleInstruction(const char *word, int length, const char **cursor){
+    AssemblerMnemonic *mnemonic = findMnemonic(word, length);
+
+    if (!mnemonic) {
+        assemblerError("unknown instruction '%.*s'", length, word);
+        return;
+    }
+
+    int wordBytes = wordBits == 64 ? 8 : 4;
+    int registerA = NO_REGISTER, registerB = NO_REGISTER;
+    int64_t value = 0;
+    bool parsed = true;
+
+    switch (mnemonic->form) {
+        case OPERANDS_NONE:
+            break;
+        case OPERANDS_RR:
+            parsed = parseRegister(cursor, &registerA) && parseRegister(cursor, &registerB);
+            break;
+        case OPERANDS_IR:
+            parsed = parseValue(cursor, &value) && parseRegister(cursor, &registerB);
+            break;
+        case OPERANDS_RM:
+            parsed = parseRegister(cursor, &registerA) && parseMemory(cursor, &value, &registerB);
+            break;
+        case OPERANDS_MR:
+            parsed = parseMemory(cursor, &value, &registerB) && parseRegister(cursor, &registerA);
+            break;
+        case OPERANDS_DEST:
+            parsed = parseValue(cursor, &value);
+            break;
+        case OPERANDS_R:
+            parsed = parseRegister(cursor, &registerA);
+            break;
+    }
+
+    bool hasRegisters = mnemonic->form != OPERANDS_NONE && mnemonic->form != OPERANDS_DEST;
+    bool hasConstant  = mnemonic->form == OPERANDS_IR || mnemonic->form == OPERANDS_RM ||
+                        mnemonic->form == OPERANDS_MR || mnemonic->form == OPERANDS_DEST;
+
+    if (!parsed) {                                      // still take up the room, so later labels stay put
+        assemblerAddress += 1 + hasRegisters + (hasConstant ? wordBytes : 0);
+        return;
+    }
+
+    emitByte(mnemonic->code);
+    if (hasRegisters) emitByte((uint8_t)(registerA << 4 | registerB));
+    if (hasConstant) emitConstant(value, wordBytes);
+}
+
+/**
+ *  Assembles the line between assemblerLineStart and assemblerLineEnd: any number of labels, then at most one
+ *  instruction or directive.
+ */
+void assembleLine(){
+    const char *cursor = assemblerLineStart;
+    assemblerLineFailed = false;
+
+    for (;;) {
+        skipBlank(&cursor);
+        if (cursor >= assemblerLineEnd) return;
+
+        const char *word = cursor;
+        int length = identifierLength(cursor);
+
+        if (!length) {
+            assemblerError("unexpected '%c'", *cursor);
+            return;
+        }
+
+        cursor += length;
+
+        if (cursor < assemblerLineEnd && *cursor == ':') {
+            defineLabel(word, length);
+            cursor++;
+            continue;
+        }
+
+        if (word[0] == '.') assembleDirective(word, length, &cursor);
+        else assembleInstruction(word, length, &cursor);
+        break;
+    }
+
+    if (assemblerLineFailed) return;
+
+    skipBlank(&cursor);
+    if (cursor < assemblerLineEnd) assemblerError("unexpected '%.*s'", (int)(assemblerLineEnd - cursor), cursor);
+}
+
+
+/**
+ *  Assembles a .ys file into the sandbox, in place of reading hex from standard input, and adds its labels to the
+ *  symbol map so profiles and the debugger can name addresses.
+ *
+ *  @param path the source file
+ *
+ *  @return FALSE if the file couldn't be read or had errors, which have been printed with their line numbers
+ */
+bool assembleProgram(const char *path){
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        printf("\nCould not read %s\n", path);
+        return false;
+    }
+
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    rewind(file);
+
+    char *source = malloc(size + 1);
+    if (!source || fread(source, 1, size, file) != (size_t)size) {
+        printf("\nCould not read %s\n", path);
+        fclose(file);
+        free(source);
+        return false;
+    }
+
+    fclose(file);
+    source[size] = '\0';                            // so strtoull always stops
+
+    sourcePath = path;
+    assemblerErrors = 0;
+
+    for (assemblerPass = 1; assemblerPass <= 2 && !assemblerErrors; assemblerPass++) {
+        assemblerAddress   = 0;
+        assemblerImageEnd  = 0;
+        assemblerLine      = 0;
+        assemblerInComment = false;
+
+        for (const char *start = source; start < source + size; start = assemblerLineEnd + 1) {
+            const char *newline = memchr(start, '\n', source + size - start);
+
+            assemblerLine++;
+            assemblerLineStart = start;
+            assemblerLineEnd   = newline ? newline : source + size;
+
+            assembleLine();
+        }
+    }
+
+    if (assemblerErrors) {
+        printf("\n%d error%s in %s\n", assemblerErrors, assemblerErrors == 1 ? "" : "s", path);
+    } else {
+        char name[64];
+
+        for (int i = 0; i < assemblerLabelCapacity; i++) {
+            if (!assemblerLabels[i].name) continue;
+
+            snprintf(name, sizeof(name), "%.*s", assemblerLabels[i].length, assemblerLabels[i].name);
+            addSymbol(assemblerLabels[i].address, name);
+        }
+
+        if (verbose) printf("\nAssembled %s: %d bytes, %d labels\n", path, assemblerImageEnd, assemblerLabelCount);
+    }
+
+    free(assemblerLabels);
+    free(source);
+    assemblerLabels = NULL;
+    assemblerLabelCapacity = 0;
+    assemblerLabelCount = 0;
+
+    if (assemblerErrors) return false;
+
+    instructionBytes = assemblerImageEnd;
+
+    return instructionLoadComplete();
+}
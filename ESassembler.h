@@ -0,0 +1,22 @@
+//
+//  ESassembler.h
+//  Eighty-Sixer
+//
+//  Created by agent on 10/19/26.
+//  Copyright (c) 2026 agent. All rights reserved.
+//
+
+#ifndef __Eighty_Sixer__ESassembler__
+#define __Eighty_Sixer__ESassembler__
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#define ASSEMBLER_MAX_ERRORS    20          // stop reporting after this many, the rest are usually knock-on errors
+
+extern const char *sourcePath;
+
+bool assembleProgram(const char*);
+
+#endif /* defined(__Eighty_Sixer__ESassembler__) */
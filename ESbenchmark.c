@@ -0,0 +1,371 @@
+//
+//  ESbenchmark.c
+//  Eighty-Sixer
+//
+//  Created by agent on 10/19/26.
+//  Copyright (c) 2026 agent. All rights reserved.
+//
+
+#define _GNU_SOURCE                             // sched_setaffinity()
+#include "ESbenchmark.h"
+#include "main.h"
+#include <time.h>
+#include <sched.h>
+
+/*  Microbenchmarks for the hot paths, one primitive at a time: hex parsing, instruction fetch, dispatch of each
+    instruction class, the ALU, guest loads and stores, and the stack. `make benchmark` builds them into
+    Eighty-Sixer-bench, which runs them all against a small image and compares the medians with a stored baseline.
+
+    Every sample times a whole batch of operations, so the clock's own cost is spread over thousands of them.
+    The first few samples only warm up the caches and the branch predictors and are thrown away.
+ */
+
+int benchmarkSamples = 51;
+int benchmarkWarmup  = 5;
+int benchmarkBatch   = 10000;
+int benchmarkCPU     = -1;                      // -1 pins to whichever CPU we start on
+double benchmarkThreshold = 10.0;               // percent slower than the baseline that counts as a regression
+
+const char *baselinePath = BENCHMARK_BASELINE;
+bool savingBaseline = false;
+
+volatile int64_t benchmarkSink;                 // results go here, so nothing gets optimized away
+
+char benchmarkHex[4096];                        // the parseInput() input, hex digits and spaces only
+
+/*  The benchmark image. Every instruction class has one instruction at a fixed address, and the dispatch benchmarks
+    point the program counter straight at theirs. %esi holds BENCHMARK_DATA, so the loads and stores land there.
+ */
+const uint8_t benchmarkImage[] = {
+    0x10,                                       // 0x00 nop
+    0x20, 0x01,                                 // 0x01 rrmovl %eax, %ecx
+    0x30, 0xF3, 0x01, 0x00, 0x00, 0x00,         // 0x03 irmovl $1, %ebx
+    0x40, 0x06, 0x00, 0x00, 0x00, 0x00,         // 0x09 rmmovl %eax, 0(%esi)
+    0x50, 0x06, 0x00, 0x00, 0x00, 0x00,         // 0x0F mrmovl 0(%esi), %eax
+    0x60, 0x01,                                 // 0x15 addl %eax, %ecx     the register byte alone is at 0x16
+    0x70, 0x1C, 0x00, 0x00, 0x00,               // 0x17 jmp 0x1C
+    0x74, 0x21, 0x00, 0x00, 0x00,               // 0x1C jne 0x21
+    0x80, 0x26, 0x00, 0x00, 0x00,               // 0x21 call 0x26
+    0x90,                                       // 0x26 ret
+    0xA0, 0x0F,                                 // 0x27 pushl %eax
+    0xB0, 0x0F,                                 // 0x29 popl %eax
+    0x00                                        // 0x2B halt, never reached
+};
+
+#define AT(address)     (currentInstructionByte = sandboxFloor + (address))
+
+
+/**
+ *  Nanoseconds on the monotonic clock.
+ */
+int64_t benchmarkNow(){
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (int64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+
+/** THE BENCHMARKS **/
+
+void benchParse(int count){
+    int64_t sum = 0;
+    for (int i = 0; i < count; i++) sum += parseInput(benchmarkHex[i & (sizeof(benchmarkHex) - 1)]);
+    benchmarkSink = sum;
+}
+
+void benchFetch(int count){
+    int64_t sum = 0;
+    for (int i = 0; i < count; i++) {
+        if (currentInstructionByte > lastInstructionByte) AT(0);
+        sum += readNextInstructionByte();
+    }
+    benchmarkSink = sum;
+}
+
+void benchNop(int count)    { for (int i = 0; i < count; i++) { AT(0x00); startCycle(); } }
+void benchRrmov(int count)  { for (int i = 0; i < count; i++) { AT(0x01); startCycle(); } }
+void benchIrmov(int count)  { for (int i = 0; i < count; i++) { AT(0x03); startCycle(); } }
+void benchRmmov(int count)  { for (int i = 0; i < count; i++) { AT(0x09); startCycle(); } }
+void benchMrmov(int count)  { for (int i = 0; i < count; i++) { AT(0x0F); startCycle(); } }
+void benchOp(int count)     { for (int i = 0; i < count; i++) { AT(0x15); startCycle(); } }
+void benchJmp(int count)    { for (int i = 0; i < count; i++) { AT(0x17); startCycle(); } }
+void benchJne(int count)    { for (int i = 0; i < count; i++) { AT(0x1C); startCycle(); } }
+
+void benchCallReturn(int count){
+    for (int i = 0; i < count; i++) {
+        AT(0x21);
+        startCycle();                           // the call
+        startCycle();                           // and the ret it lands on
+    }
+}
+
+void benchPushPop(int count){
+    for (int i = 0; i < count; i++) {
+        AT(0x27);
+        startCycle();
+        startCycle();
+    }
+}
+
+/**
+ *  The ALU on its own: the OPl handler with the program counter on its register byte, without the fetch of the
+ *  icode/ifun byte or the step bookkeeping around it.
+ */
+void benchArithmetic(uint8_t instruction, int count){
+    for (int i = 0; i < count; i++) {
+        AT(0x16);
+        executeInstruction(instruction);
+    }
+}
+
+void benchAdd(int count) { benchArithmetic(0x60, count); }
+void benchSub(int count) { benchArithmetic(0x61, count); }
+void benchAnd(int count) { benchArithmetic(0x62, count); }
+void benchXor(int count) { benchArithmetic(0x63, count); }
+
+void benchLoad(int count){
+    int64_t sum = 0;
+    for (int i = 0; i < count; i++) {
+        int *address = relativeToPhysicalAddress(BENCHMARK_DATA + (i & 0xFF) * 4);
+        sum += fetchMemoryAtPhysicalAddress(address);
+    }
+    benchmarkSink = sum;
+}
+
+void benchStore(int count){
+    for (int i = 0; i < count; i++) {
+        int *address = relativeToPhysicalAddress(BENCHMARK_DATA + (i & 0xFF) * 4);
+        setMemoryAtPhysicalAddress(address, i);
+    }
+}
+
+void benchStack(int count){
+    int64_t sum = 0;
+    for (int i = 0; i < count; i++) {
+        pushToStack(i);
+        sum += popFromStack();
+    }
+    benchmarkSink = sum;
+}
+
+const Benchmark benchmarks[] = {
+    { "parse hex character",    1, benchParse },
+    { "fetch byte",             1, benchFetch },
+    { "dispatch nop",           1, benchNop },
+    { "dispatch rrmovl",        1, benchRrmov },
+    { "dispatch irmovl",        1, benchIrmov },
+    { "dispatch rmmovl",        1, benchRmmov },
+    { "dispatch mrmovl",        1, benchMrmov },
+    { "dispatch addl",          1, benchOp },
+    { "dispatch jmp",           1, benchJmp },
+    { "dispatch jne",           1, benchJne },
+    { "dispatch call+ret",      2, benchCallReturn },
+    { "dispatch pushl+popl",    2, benchPushPop },
+    { "alu addl",               1, benchAdd },
+    { "alu subl",               1, benchSub },
+    { "alu andl",               1, benchAnd },
+    { "alu xorl",               1, benchXor },
+    { "translate+load",         1, benchLoad },
+    { "translate+store",        1, benchStore },
+    { "push+pop",               2, benchStack },
+};
+
+#define BENCHMARK_COUNT     (int)(sizeof(benchmarks) / sizeof(benchmarks[0]))
+
+
+/**
+ *  Loads the benchmark image the same way a program from standard input is loaded, and gives the registers the
+ *  values the image expects.
+ *
+ *  @return FALSE if the sandbox could not be set up
+ */
+bool loadBenchmarkImage(){
+    if (!setupVirtualMemory(BENCHMARK_ADDRESS_SPACE)) return false;
+
+    for (int i = 0; i < (int)sizeof(benchmarkImage); i++) {
+        if (!storeInstructionByte(benchmarkImage[i])) return false;
+        instructionBytes++;
+    }
+
+    if (!instructionLoadComplete()) return false;
+
+    *registerAtIndex(0) = 7;
+    *registerAtIndex(1) = 3;
+    *registerAtIndex(6) = BENCHMARK_DATA;
+
+    for (int i = 0; i < (int)sizeof(benchmarkHex); i++) benchmarkHex[i] = "0123456789abcdefABCDEF "[i % 23];
+
+    return true;
+}
+
+
+/**
+ *  Keeps us on one CPU, so a migration halfway through a sample doesn't show up as a slow operation.
+ */
+void pinBenchmark(){
+    if (benchmarkCPU < 0) benchmarkCPU = sched_getcpu();
+    if (benchmarkCPU < 0) return;
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(benchmarkCPU, &set);
+
+    if (sched_setaffinity(0, sizeof(set), &set) != 0) {
+        printf("Could not pin to CPU %d, the numbers will be noisier.\n", benchmarkCPU);
+        benchmarkCPU = -1;
+    }
+}
+
+
+int compareSamples(const void *a, const void *b){
+    double x = *(const double *)a, y = *(const double *)b;
+
+    return (x > y) - (x < y);
+}
+
+
+/**
+ *  The nearest rank percentile of some sorted samples.
+ */
+double percentile(const double *sorted, int count, double fraction){
+    int rank = (int)(fraction * count + 0.999999);
+    if (rank < 1) rank = 1;
+    if (rank > count) rank = count;
+
+    return sorted[rank - 1];
+}
+
+
+/**
+ *  The baseline median for a benchmark, from a file of "median name" lines as savingBaseline writes them.
+ *
+ *  @return the median in ns/op, or 0 if the benchmark isn't in the baseline
+ */
+double baselineFor(FILE *baseline, const char *name){
+    char line[256];
+    double median;
+    int offset;
+
+    if (!baseline) return 0;
+
+    rewind(baseline);
+    while (fgets(line, sizeof(line), baseline)) {
+        line[strcspn(line, "\n")] = '\0';
+
+        if (sscanf(line, "%lf %n", &median, &offset) == 1 && !strcmp(line + offset, name)) return median;
+    }
+
+    return 0;
+}
+
+
+/**
+ *  The benchmark executable's main(). Runs every benchmark, prints the median and tail of each in ns/op, and flags
+ *  any whose median is more than the threshold slower than the baseline.
+ *
+ *      --samples N      timed samples per benchmark, 51 by default
+ *      --warmup N       untimed samples first, 5 by default
+ *      --batch N        operations per sample, 10000 by default
+ *      --cpu N          the CPU to pin to, the current one by default
+ *      --variant NAME   the interpreter variant to dispatch through, Plain by default
+ *      --baseline FILE  the baseline to compare with, Eighty-Sixer.baseline by default
+ *      --threshold PCT  how much slower is a regression, 10 by default
+ *      --save-baseline  write this run's medians as the new baseline
+ *
+ *  @return 1 if anything regressed, so scripts can fail on it
+ */
+int runBenchmarks(int argc, const char *argv[]){
+    const char *variant = "Plain";
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--samples") && i + 1 < argc)   benchmarkSamples = atoi(argv[++i]);
+        if (!strcmp(argv[i], "--warmup") && i + 1 < argc)    benchmarkWarmup = atoi(argv[++i]);
+        if (!strcmp(argv[i], "--batch") && i + 1 < argc)     benchmarkBatch = atoi(argv[++i]);
+        if (!strcmp(argv[i], "--cpu") && i + 1 < argc)       benchmarkCPU = atoi(argv[++i]);
+        if (!strcmp(argv[i], "--variant") && i + 1 < argc)   variant = argv[++i];
+        if (!strcmp(argv[i], "--baseline") && i + 1 < argc)  baselinePath = argv[++i];
+        if (!strcmp(argv[i], "--threshold") && i + 1 < argc) benchmarkThreshold = atof(argv[++i]);
+        if (!strcmp(argv[i], "--save-baseline"))             savingBaseline = true;
+    }
+
+    if (benchmarkSamples < 1) benchmarkSamples = 1;
+    if (benchmarkWarmup < 0) benchmarkWarmup = 0;
+    if (benchmarkBatch < 1) benchmarkBatch = 1;
+
+    int selected = 0;
+    while (selected < INTERPRETER_VARIANTS && strcmp(interpreterVariants[selected].name, variant)) selected++;
+    if (selected == INTERPRETER_VARIANTS) {
+        printf("No interpreter variant called %s.\n", variant);
+        return 1;
+    }
+
+    startCycle         = interpreterVariants[selected].startCycle;
+    executeInstruction = interpreterVariants[selected].executeInstruction;
+
+    if (!loadBenchmarkImage()) {
+        printf("Could not set up the benchmark image.\n");
+        return 1;
+    }
+
+    pinBenchmark();
+
+    FILE *baseline = savingBaseline ? NULL : fopen(baselinePath, "r");
+    double *samples = malloc(benchmarkSamples * sizeof(double));
+    double medians[BENCHMARK_COUNT];
+    int regressions = 0;
+
+    if (!samples) return 1;
+
+    printf("Eighty-Sixer %s microbenchmarks, %s interpreter, CPU %d, %d x %d operations\n\n",
+           version, variant, benchmarkCPU, benchmarkSamples, benchmarkBatch);
+    printf("%-22s %10s %10s %10s %10s %10s %8s\n", "ns/op", "min", "median", "p90", "p99", "baseline", "change");
+
+    for (int b = 0; b < BENCHMARK_COUNT; b++) {
+        for (int i = 0; i < benchmarkWarmup; i++) benchmarks[b].run(benchmarkBatch);
+
+        for (int i = 0; i < benchmarkSamples; i++) {
+            int64_t started = benchmarkNow();
+            benchmarks[b].run(benchmarkBatch);
+            samples[i] = (double)(benchmarkNow() - started) / ((double)benchmarkBatch * benchmarks[b].opsPerCall);
+        }
+
+        qsort(samples, benchmarkSamples, sizeof(double), compareSamples);
+        medians[b] = percentile(samples, benchmarkSamples, 0.5);
+
+        printf("%-22s %10.2f %10.2f %10.2f %10.2f", benchmarks[b].name, samples[0], medians[b],
+               percentile(samples, benchmarkSamples, 0.9), percentile(samples, benchmarkSamples, 0.99));
+
+        double previous = baselineFor(baseline, benchmarks[b].name);
+        if (previous > 0) {
+            double change = (medians[b] / previous - 1) * 100;
+            bool regressed = change > benchmarkThreshold;
+
+            printf(" %10.2f %+7.1f%%%s", previous, change, regressed ? "  REGRESSION" : "");
+            if (regressed) regressions++;
+        }
+
+        printf("\n");
+    }
+
+    free(samples);
+    if (baseline) fclose(baseline);
+
+    if (savingBaseline) {
+        FILE *file = fopen(baselinePath, "w");
+        if (!file) {
+            printf("\nCould not write the baseline to %s\n", baselinePath);
+            return 1;
+        }
+
+        for (int b = 0; b < BENCHMARK_COUNT; b++) fprintf(file, "%.3f %s\n", medians[b], benchmarks[b].name);
+        fclose(file);
+
+        printf("\nBaseline written to %s\n", baselinePath);
+    } else if (regressions) {
+        printf("\n%d benchmark%s more than %.0f%% slower than %s\n", regressions, regressions == 1 ? "" : "s",
+               benchmarkThreshold, baselinePath);
+    }
+
+    return regressions ? 1 : 0;
+}
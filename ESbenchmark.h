@@ -0,0 +1,28 @@
+//
+//  ESbenchmark.h
+//  Eighty-Sixer
+//
+//  Created by agent on 10/19/26.
+//  Copyright (c) 2026 agent. All rights reserved.
+//
+
+#ifndef __Eighty_Sixer__ESbenchmark__
+#define __Eighty_Sixer__ESbenchmark__
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#define BENCHMARK_ADDRESS_SPACE     65536       // plenty for the benchmark image, its data and the stack
+#define BENCHMARK_DATA              0x1000      // where the loads and stores go, well above the image
+#define BENCHMARK_BASELINE          "Eighty-Sixer.baseline"
+
+typedef struct Benchmark {
+    const char *name;
+    int         opsPerCall;             // how many operations one call to run does, for ns/op
+    void      (*run)(int);              // does the operation that many times over
+} Benchmark;
+
+int runBenchmarks(int, const char*[]);
+
+#endif /* defined(__Eighty_Sixer__ESbenchmark__) */
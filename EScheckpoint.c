@@ -0,0 +1,451 @@
+//
+//  EScheckpoint.c
+//  Eighty-Sixer
+//
+//  Created by agent on 10/19/26.
+//  Copyright (c) 2026 agent. All rights reserved.
+//
+
+#define _POSIX_C_SOURCE 200809L                 // fsync() and fileno() under -std=c99
+#include "EScheckpoint.h"
+#include "main.h"
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define CHECKPOINT_MAGIC        "ES86CKPT"
+#define CHECKPOINT_VERSION      4
+#define CHECKPOINT_COMPRESSED   0x1
+
+/* FILE LAYOUT
+    CheckpointHeader
+    the pristine program image             imageLength bytes
+    console input read so far              inputLength bytes
+    one PageRecord per dirtied page        each followed by storedLength bytes of page data
+
+   A page stored at full length is raw. Anything shorter is zero-run encoded: repeated
+   (uint16 zeros, uint16 literals, literal bytes...) until the page is full.
+ */
+
+typedef struct CheckpointHeader {
+    char     magic[8];
+    uint32_t version;
+    uint32_t flags;
+    uint32_t isaExtensions;         // how the machine was set up, which a restore has to match
+    int32_t  writableCode;
+    int32_t  sandboxSize;
+    int32_t  imageLength;
+    int32_t  pageRecords;
+    int32_t  registers[8];
+    int32_t  zeroFlag;
+    int32_t  signFlag;
+    int32_t  overflowFlag;
+    int32_t  stepCount;
+    int32_t  programCounter;
+    int32_t  stackPointer;
+    int32_t  framePointer;
+    int32_t  heapPointer;
+    int64_t  consoleWritten;        // the devices, see DeviceState
+    int32_t  inputPosition;
+    int32_t  inputLength;
+    int32_t  inputEnded;
+    uint64_t checksum;              // FNV-1a over the whole file, this header included with the checksum zeroed
+} CheckpointHeader;
+
+typedef struct PageRecord {
+    int32_t page;
+    int32_t storedLength;
+} PageRecord;
+
+const char *checkpointPath = NULL;
+const char *restorePath = NULL;
+int  checkpointInterval = 0;
+bool checkpointCompression = false;
+
+volatile sig_atomic_t nextCheckpointStep = INT_MAX;
+volatile sig_atomic_t stopAfterCheckpoint = 0;
+
+
+/**
+ *  Folds a block of bytes into a running FNV-1a hash.
+ */
+uint64_t checksumBytes(uint64_t hash, const uint8_t *bytes, size_t length){
+    for (size_t i = 0; i < length; i++) {
+        hash ^= bytes[i];
+        hash *= 0x100000001B3ULL;
+    }
+
+    return hash;
+}
+
+
+/**
+ *  Flushes a finished file to the disk, then the directory it is in, so a rename into place survives a crash.
+ *
+ *  @return FALSE if the file could not be synced
+ */
+bool syncFile(FILE *file){
+    return fflush(file) == 0 && fsync(fileno(file)) == 0;
+}
+
+
+/**
+ *  Syncs the directory holding a path, so a rename into it is on disk too.
+ */
+void syncDirectoryOf(const char *path){
+    char directory[4096];
+    const char *slash = strrchr(path, '/');
+
+    if (!slash) snprintf(directory, sizeof(directory), ".");
+    else snprintf(directory, sizeof(directory), "%.*s", slash == path ? 1 : (int)(slash - path), path);
+
+    int descriptor = open(directory, O_RDONLY);
+    if (descriptor < 0) return;
+
+    fsync(descriptor);
+    close(descriptor);
+}
+
+
+/**
+ *  Zero-run encodes one page. Pages in a sandbox are mostly zeros, so this usually shrinks them to a few bytes.
+ *
+ *  @param page   the page to encode
+ *  @param output room for at least GUEST_PAGE_SIZE bytes
+ *
+ *  @return the encoded length, or GUEST_PAGE_SIZE if encoding would not save anything
+ */
+int compressPage(const uint8_t *page, uint8_t *output){
+    int in = 0, out = 0;
+
+    while (in < GUEST_PAGE_SIZE) {
+        int zeros = 0;
+        while (in + zeros < GUEST_PAGE_SIZE && page[in + zeros] == 0) zeros++;
+
+        int literals = 0;
+        while (in + zeros + literals < GUEST_PAGE_SIZE) {               // literals run until the next stretch of four zeros
+            const uint8_t *next = page + in + zeros + literals;
+            int left = GUEST_PAGE_SIZE - (in + zeros + literals);
+            if (left >= 4 && !next[0] && !next[1] && !next[2] && !next[3]) break;
+            literals++;
+        }
+
+        if (out + 4 + literals >= GUEST_PAGE_SIZE) return GUEST_PAGE_SIZE;
+
+        output[out++] = zeros & 0xFF;
+        output[out++] = zeros >> 8;
+        output[out++] = literals & 0xFF;
+        output[out++] = literals >> 8;
+        memcpy(output + out, page + in + zeros, literals);
+
+        out += literals;
+        in  += zeros + literals;
+    }
+
+    return out;
+}
+
+
+/**
+ *  Undoes compressPage().
+ *
+ *  @return FALSE if the encoded data does not add up to exactly one page
+ */
+bool decompressPage(const uint8_t *input, int length, uint8_t *page){
+    int in = 0, out = 0;
+
+    while (in + 4 <= length) {
+        int zeros    = input[in] | (input[in + 1] << 8);
+        int literals = input[in + 2] | (input[in + 3] << 8);
+        in += 4;
+
+        if (out + zeros + literals > GUEST_PAGE_SIZE || in + literals > length) return false;
+
+        memset(page + out, 0, zeros);
+        memcpy(page + out + zeros, input + in, literals);
+
+        out += zeros + literals;
+        in  += literals;
+    }
+
+    return in == length && out == GUEST_PAGE_SIZE;
+}
+
+
+/**
+ *  Writes the complete machine state to disk: registers, flags, program counter, step count, the memory
+ *  boundary pointers, the program image, the devices with the console input read so far, and every page the
+ *  program has written since it was loaded.
+ *  Pages nobody touched are not stored at all. The file is written next to the target, synced and renamed into
+ *  place, so a crash part way through never leaves a broken checkpoint behind.
+ *
+ *  @param path where to write the checkpoint
+ *
+ *  @return FALSE if the checkpoint could not be written
+ */
+bool writeCheckpoint(const char *path){
+    AddressSpace *space = activeAddressSpace;
+    if (!space || !programWriteIsLocked()) return false;
+
+    char temporaryPath[4096];
+    snprintf(temporaryPath, sizeof(temporaryPath), "%s.tmp", path);
+
+    FILE *file = fopen(temporaryPath, "wb");
+    if (!file) return false;
+
+    ProcessorState processor;
+    MemoryLayout memory;
+    saveProcessorState(&processor);
+    saveMemoryLayout(&memory);
+
+    CheckpointHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, CHECKPOINT_MAGIC, 8);
+    header.version       = CHECKPOINT_VERSION;
+    header.flags         = checkpointCompression ? CHECKPOINT_COMPRESSED : 0;
+    header.isaExtensions = isaExtensions;
+    header.writableCode  = writableCode;
+    header.sandboxSize   = requestedSize;
+    header.imageLength   = pristineImageLength;
+    header.pageRecords   = space->dirtyPageCount;
+
+    for (int i = 0; i < 8; i++) header.registers[i] = processor.registers[i];
+    header.zeroFlag       = processor.zeroFlag;
+    header.signFlag       = processor.signFlag;
+    header.overflowFlag   = processor.overflowFlag;
+    header.stepCount      = processor.stepCount;
+    header.programCounter = memory.programCounter;
+    header.stackPointer   = memory.stackPointer;
+    header.framePointer   = memory.framePointer;
+    header.heapPointer    = memory.heapPointer;
+
+    const uint8_t *input;
+    bool inputEnded;
+    DeviceState deviceState;
+    saveDeviceState(&deviceState);
+
+    header.inputLength    = consoleInputRead(&input, &inputEnded);
+    header.inputEnded     = inputEnded;
+    header.inputPosition  = deviceState.inputPosition;
+    header.consoleWritten = deviceState.consoleWritten;
+
+    fwrite(&header, sizeof(header), 1, file);               // written again once the checksum is known
+
+    uint64_t checksum = checksumBytes(0xCBF29CE484222325ULL, (const uint8_t *)&header, sizeof(header));
+    fwrite(pristineImage, 1, pristineImageLength, file);
+    checksum = checksumBytes(checksum, pristineImage, pristineImageLength);
+
+    fwrite(input, 1, header.inputLength, file);
+    checksum = checksumBytes(checksum, input, header.inputLength);
+
+    uint8_t encoded[GUEST_PAGE_SIZE];
+
+    for (int i = 0; i < space->dirtyPageCount; i++) {
+        PageRecord record;
+        record.page = space->dirtyPageList[i];
+
+        const uint8_t *page = space->floor + ((size_t)record.page << GUEST_PAGE_SHIFT);
+        const uint8_t *data = page;
+
+        record.storedLength = GUEST_PAGE_SIZE;
+        if (checkpointCompression) {
+            record.storedLength = compressPage(page, encoded);
+            if (record.storedLength < GUEST_PAGE_SIZE) data = encoded;
+        }
+
+        fwrite(&record, sizeof(record), 1, file);
+        fwrite(data, 1, record.storedLength, file);
+
+        checksum = checksumBytes(checksum, (const uint8_t *)&record, sizeof(record));
+        checksum = checksumBytes(checksum, data, record.storedLength);
+    }
+
+    header.checksum = checksum;
+    rewind(file);
+    fwrite(&header, sizeof(header), 1, file);
+
+    bool written = !ferror(file) && syncFile(file);
+    written &= (fclose(file) == 0);
+
+    if (!written || rename(temporaryPath, path) != 0) {
+        remove(temporaryPath);
+        return false;
+    }
+
+    syncDirectoryOf(path);
+
+    if (verbose) {
+        printf("\nCheckpoint written to %s at step %d: %d page(s).\n", path, stepCount, space->dirtyPageCount);
+    }
+
+    return true;
+}
+
+
+/**
+ *  Restores a checkpoint written by writeCheckpoint() into the active address space. The file is memory
+ *  mapped and pages are copied straight out of the mapping. Must be called after setupVirtualMemory()
+ *  and in place of loading a program from standard input.
+ *
+ *  @param path the checkpoint to restore
+ *
+ *  @return FALSE if the file is missing, corrupt, or was taken with a different sandbox size or options
+ */
+bool restoreCheckpoint(const char *path){
+    int descriptor = open(path, O_RDONLY);
+    if (descriptor < 0) {
+        printf("\nFATAL ERROR: Could not open checkpoint %s\n", path);
+        return false;
+    }
+
+    struct stat info;
+    if (fstat(descriptor, &info) != 0 || info.st_size < (off_t)sizeof(CheckpointHeader)) {
+        close(descriptor);
+        printf("\nFATAL ERROR: Checkpoint %s is truncated\n", path);
+        return false;
+    }
+
+    size_t length = (size_t)info.st_size;
+    uint8_t *map = mmap(NULL, length, PROT_READ, MAP_PRIVATE, descriptor, 0);
+    close(descriptor);
+
+    if (map == MAP_FAILED) return false;
+
+    bool restored = false;
+    const CheckpointHeader *header = (const CheckpointHeader *)map;
+    const uint8_t *cursor = map + sizeof(CheckpointHeader);
+    const uint8_t *end = map + length;
+
+    if (memcmp(header->magic, CHECKPOINT_MAGIC, 8) || header->version != CHECKPOINT_VERSION) {
+        printf("\nFATAL ERROR: %s is not a checkpoint\n", path);
+        goto done;
+    }
+
+    CheckpointHeader unsummed = *header;                    // the checksum was taken with its own field zeroed
+    unsummed.checksum = 0;
+
+    uint64_t checksum = checksumBytes(0xCBF29CE484222325ULL, (const uint8_t *)&unsummed, sizeof(unsummed));
+    if (checksumBytes(checksum, cursor, end - cursor) != header->checksum) {
+        printf("\nFATAL ERROR: Checkpoint %s is corrupt\n", path);
+        goto done;
+    }
+
+    if (header->sandboxSize != requestedSize || header->imageLength < 0 || header->imageLength > requestedSize) {
+        printf("\nFATAL ERROR: Checkpoint %s was taken with a %d byte sandbox\n", path, header->sandboxSize);
+        goto done;
+    }
+
+    if (header->isaExtensions != isaExtensions || (header->writableCode != 0) != writableCode) {
+        printf("\nFATAL ERROR: Checkpoint %s was taken with different --extend, --files or --writable-code options\n", path);
+        goto done;
+    }
+
+    if (end - cursor < header->imageLength) goto done;
+
+    memcpy(sandboxFloor, cursor, header->imageLength);
+    if (!takePristineSnapshot(sandboxFloor, header->imageLength)) goto done;
+    cursor += header->imageLength;
+    instructionBytes = header->imageLength;
+
+    if (header->inputLength < 0 || end - cursor < header->inputLength) goto done;
+    if (header->inputPosition < 0 || header->inputPosition > header->inputLength) goto done;
+    if (!restoreConsoleInput(cursor, header->inputLength, header->inputEnded)) goto done;
+    cursor += header->inputLength;
+
+    DeviceState deviceState = { .consoleWritten = header->consoleWritten, .inputPosition = header->inputPosition };
+    restoreDeviceState(&deviceState);
+
+    for (int i = 0; i < header->pageRecords; i++) {
+        PageRecord record;
+        if (end - cursor < (long)sizeof(record)) goto done;
+
+        memcpy(&record, cursor, sizeof(record));
+        cursor += sizeof(record);
+
+        if (record.page < 0 || record.page >= activeAddressSpace->pageCount) goto done;
+        if (record.storedLength < 0 || record.storedLength > GUEST_PAGE_SIZE || end - cursor < record.storedLength) goto done;
+
+        uint8_t *page = activeAddressSpace->floor + ((size_t)record.page << GUEST_PAGE_SHIFT);
+
+        if (record.storedLength == GUEST_PAGE_SIZE) {
+            memcpy(page, cursor, GUEST_PAGE_SIZE);
+        } else if (!decompressPage(cursor, record.storedLength, page)) {
+            goto done;
+        }
+
+        markPageDirty(page);                                 // so the next reset knows to put it back
+        codeWritten((long)record.page << GUEST_PAGE_SHIFT, GUEST_PAGE_SIZE);     // the program may have written to itself
+        cursor += record.storedLength;
+    }
+
+    MemoryLayout memory = {
+        .programCounter = header->programCounter,
+        .stackPointer   = header->stackPointer,
+        .framePointer   = header->framePointer,
+        .heapPointer    = header->heapPointer,
+        .programLength  = header->imageLength
+    };
+
+    if (!restoreMemoryLayout(&memory)) goto done;
+
+    ProcessorState processor;
+    for (int i = 0; i < 8; i++) processor.registers[i] = header->registers[i];
+    processor.zeroFlag     = header->zeroFlag;
+    processor.signFlag     = header->signFlag;
+    processor.overflowFlag = header->overflowFlag;
+    processor.stepCount    = header->stepCount;
+    restoreProcessorState(&processor);
+
+    restored = true;
+
+    if (verbose) {
+        printf("\nRestored checkpoint %s at step %d.\n", path, stepCount);
+        printStackPointers();
+    }
+
+done:
+    if (!restored) printf("\nFATAL ERROR: Could not restore checkpoint %s\n", path);
+
+    munmap(map, length);
+    return restored;
+}
+
+
+/**
+ *  SIGUSR1 asks for a checkpoint at the next instruction boundary. SIGTERM does the same and then stops,
+ *  so a preempted job leaves a checkpoint it can resume from.
+ */
+void checkpointSignalReceived(int signal){
+    if (signal == SIGTERM) stopAfterCheckpoint = 1;
+
+    nextCheckpointStep = 0;
+}
+
+void installCheckpointSignals(){
+    signal(SIGUSR1, checkpointSignalReceived);
+    signal(SIGTERM, checkpointSignalReceived);
+}
+
+
+/**
+ *  The execution loop used whenever checkpointing is turned on. Same as the plain loop in alpha(), with
+ *  one comparison per step against the next scheduled checkpoint. Signals pull that step forward to now.
+ */
+void runWithCheckpoints(){
+    nextCheckpointStep = checkpointInterval > 0 ? stepCount + checkpointInterval : INT_MAX;
+
+    while (hasNextInstruction()) {
+        startCycle();
+
+        if (stepCount >= nextCheckpointStep) {
+            if (!writeCheckpoint(checkpointPath)) {
+                printf("\nFATAL ERROR: Could not write checkpoint %s\n", checkpointPath);
+            }
+
+            nextCheckpointStep = checkpointInterval > 0 ? stepCount + checkpointInterval : INT_MAX;
+
+            if (stopAfterCheckpoint) quit(AOK);             // the machine is fine, we were just asked to stop
+        }
+    }
+}
@@ -0,0 +1,32 @@
+//
+//  EScheckpoint.h
+//  Eighty-Sixer
+//
+//  Created by agent on 10/19/26.
+//  Copyright (c) 2026 agent. All rights reserved.
+//
+
+#ifndef __Eighty_Sixer__EScheckpoint__
+#define __Eighty_Sixer__EScheckpoint__
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <signal.h>
+
+extern const char *checkpointPath;
+extern const char *restorePath;
+extern int  checkpointInterval;
+extern bool checkpointCompression;
+
+extern volatile sig_atomic_t nextCheckpointStep;
+
+uint64_t checksumBytes(uint64_t, const uint8_t*, size_t);
+
+bool writeCheckpoint(const char*);
+bool restoreCheckpoint(const char*);
+
+void installCheckpointSignals();
+void runWithCheckpoints();
+
+#endif /* defined(__Eighty_Sixer__EScheckpoint__) */
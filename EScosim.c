@@ -0,0 +1,615 @@
+//
+//  EScosim.c
+//  Eighty-Sixer
+//
+//  Created by agent on 10/19/26.
+//  Copyright (c) 2026 agent. All rights reserved.
+//
+
+#include "EScosim.h"
+#include "main.h"
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <sys/time.h>
+
+/*  Co-simulation, --cosim: runs one of the fast engines and the reference interpreter side by side on the same
+    program and checks after every block that they agree, down to the last register, flag and written byte.
+
+    Each side is a machine of its own with an address space from the pool. The engine runs a block, or a verified
+    stretch, on its machine; the reference then single steps its machine to the same step count, and the two are
+    compared: the step count, the program counter, the status, every register and flag, and every page either one
+    has dirtied. With --cosim-every N the comparison waits until N more steps have gone by, which is quicker but
+    only narrows a divergence down to that many steps. Stops are caught rather than printed, see omega(), so a
+    fault has to happen on both sides at the same step too. If the two ever disagree, both sides are printed and
+    the machine exits; otherwise the reference side's trace is printed as a plain run's would be.
+
+    --fuzz N does that for N random programs instead of a loaded one, each in a child process so nothing a program
+    leaves behind, down to the decode caches, carries over to the next. A program that diverges is printed as hex,
+    to feed back in with --cosim, and run again here to show the divergence.
+ */
+
+typedef struct CosimMachine {
+    const char     *name;
+    AddressSpace   *space;
+    ProcessorState  processor;
+    long            programCounter;         // offsets from the sandbox floor
+    int             stackPointer;
+    int             framePointer;
+    DeviceState     devices;
+    bool            stopped;
+    FaultCode       status;
+} CosimMachine;
+
+const char *cosimEngineName = NULL;
+int cosimInterval = 0;                      // steps between comparisons, 0 after every block
+int fuzzPrograms = 0;
+unsigned int fuzzSeed = 0;
+
+bool cosimCatchingStops = false;            // a stop ends the machine's turn instead of the run, see cosimStopped()
+jmp_buf cosimStop;
+FaultCode cosimStatus;
+
+CosimMachine cosimReference;
+CosimMachine cosimFast;
+const CosimEngine *cosimEngine = NULL;
+int cosimStepLimit = 0;                     // 0 for none, fuzzed programs get COSIM_FUZZ_STEPS
+
+long cosimComparisons = 0;
+
+
+bool prepareOptimizedEngine(){
+    optimizing = true;
+    return programControlFlow() != NULL;
+}
+
+
+void stepOptimizedEngine(){
+    stepOptimizedProgram(false);            // a block at a time, so they can be compared between blocks
+}
+
+
+const CosimEngine cosimEngines[] = {
+    { "optimized", prepareOptimizedEngine, stepOptimizedEngine },
+    { "verified",  verifyProgram,          stepProgramVerified },
+};
+
+
+/**
+ *  Checks the modes that are on allow a co-simulation, and the engine was named right. Anything that keeps state
+ *  per run outside the machine, or does I/O the second machine would do again, is out.
+ *
+ *  @return FALSE after saying why not
+ */
+bool cosimModesSupported(){
+    cosimEngine = NULL;
+
+    for (int i = 0; i < (int)(sizeof(cosimEngines) / sizeof(cosimEngines[0])); i++) {
+        if (!strcmp(cosimEngineName, cosimEngines[i].name)) cosimEngine = &cosimEngines[i];
+    }
+
+    if (!cosimEngine) {
+        printf("\n\nNo engine called %s to co-simulate. Expected optimized or verified.", cosimEngineName);
+        return false;
+    }
+
+    if (wordBits == 64) {
+        printf("\n\nThe fast engines, and so co-simulation, only run Y86 programs, not Y86-64.");
+        return false;
+    }
+
+    if (profiling || tracing || collectingStats || pluginCount || debugging || lockstep || checkpointPath || restorePath ||
+        translationPath || fileSandboxPath) {
+        printf("\n\nCo-simulation runs without the profiler, trace, stats, plugins, debugger, lockstep, checkpoints, "
+               "translator and host files.");
+        return false;
+    }
+
+    return true;
+}
+
+
+/**
+ *  Readies the engine for the loaded program and puts runCosimulation() in place of runProgram().
+ *
+ *  @return FALSE if the modes don't allow it or the engine can't run the program
+ */
+bool prepareCosimulation(){
+    if (!cosimModesSupported()) return false;
+
+    if (!cosimEngine->prepare()) {
+        printf("\n\nThe %s engine can't run this program, so there is nothing to check it against.", cosimEngine->name);
+        return false;
+    }
+
+    cosimReference.name = "reference";
+    cosimFast.name = cosimEngine->name;
+    runProgram = runCosimulation;
+    checkingIdleLoops = false;                  // the engines would share its countdown and come to it at different times
+
+    return true;
+}
+
+
+/**
+ *  Ends the turn of the machine that stopped, in place of the trace omega() would print.
+ *
+ *  @param faultCode why it stopped
+ */
+void cosimStopped(int faultCode){
+    cosimCatchingStops = false;
+    cosimStatus = faultCode;
+    longjmp(cosimStop, 1);
+}
+
+
+void enterMachine(CosimMachine *machine){
+    enterAddressSpace(machine->space);
+
+    currentInstructionByte = sandboxFloor + machine->programCounter;
+    stackPointer = machine->stackPointer;
+    framePointer = machine->framePointer;
+
+    restoreProcessorState(&machine->processor);
+    restoreDeviceState(&machine->devices);
+}
+
+
+void leaveMachine(CosimMachine *machine){
+    machine->programCounter = currentInstructionByte - sandboxFloor;
+    machine->stackPointer = stackPointer;
+    machine->framePointer = framePointer;
+
+    saveProcessorState(&machine->processor);
+    saveDeviceState(&machine->devices);
+}
+
+
+/**
+ *  Gives a machine its turn: one go of the engine, or for the reference single steps up to a step count. Running
+ *  off the end of the program halts it, as it would a plain run.
+ *
+ *  @param machine the machine
+ *  @param steps   the step count the reference runs to, ignored for the engine
+ */
+void advanceMachine(CosimMachine *machine, int steps){
+    if (machine->stopped) return;
+
+    enterMachine(machine);
+
+    if (setjmp(cosimStop) == 0) {
+        cosimCatchingStops = true;
+
+        if (machine == &cosimFast) {
+            if (hasNextInstruction()) cosimEngine->step();
+        } else {
+            while (stepCount < steps && hasNextInstruction()) {
+                startCycle();
+            }
+        }
+
+        if (!hasNextInstruction()) quit(HALT);
+
+        cosimCatchingStops = false;
+    } else {
+        machine->stopped = true;
+        machine->status = cosimStatus;
+    }
+
+    leaveMachine(machine);
+}
+
+
+/**
+ *  Compares the word at an address in both machines' memory. Reads past the end of the sandbox read as zero.
+ */
+bool memoryWordsMatch(int address, int *reference, int *fast){
+    *reference = *fast = 0;
+
+    int length = requestedSize - address < (int)sizeof(int) ? requestedSize - address : (int)sizeof(int);
+    memcpy(reference, cosimReference.space->floor + address, length);
+    memcpy(fast, cosimFast.space->floor + address, length);
+
+    return *reference == *fast;
+}
+
+
+/**
+ *  Compares every page either machine has dirtied.
+ *
+ *  @param report TRUE to print the differing words, up to COSIM_MEMORY_REPORTED of them
+ *
+ *  @return TRUE if the memory matches
+ */
+bool compareMemory(bool report){
+    AddressSpace *spaces[2] = { cosimReference.space, cosimFast.space };
+    int reported = 0;
+    bool matching = true;
+
+    for (int side = 0; side < 2; side++) {
+        for (int i = 0; i < spaces[side]->dirtyPageCount; i++) {
+            int page = spaces[side]->dirtyPageList[i];
+            long offset = (long)page << GUEST_PAGE_SHIFT;
+
+            if (side == 1 && cosimReference.space->dirtyPageMap[page]) continue;        // compared already
+            if (!memcmp(cosimReference.space->floor + offset, cosimFast.space->floor + offset, GUEST_PAGE_SIZE)) continue;
+
+            matching = false;
+            if (!report) return false;
+
+            for (int address = (int)offset; address < offset + GUEST_PAGE_SIZE && address < requestedSize; address += sizeof(int)) {
+                int referenceWord, fastWord;
+                if (memoryWordsMatch(address, &referenceWord, &fastWord)) continue;
+
+                if (reported++ == COSIM_MEMORY_REPORTED) {
+                    printf("...           and more\n");
+                    return false;
+                }
+
+                printf("0x%08X    0x%08X    0x%08X    <<\n", address, referenceWord, fastWord);
+            }
+        }
+    }
+
+    return matching;
+}
+
+
+/**
+ *  Gives a machine's program counter as its trace would show it, -1 outside the sandbox. A fault can leave it
+ *  pointing anywhere, and the two machines' sandboxes are in different places.
+ */
+int tracedCounter(const CosimMachine *machine){
+    return machine->programCounter < 0 || machine->programCounter > requestedSize ? -1 : (int)machine->programCounter;
+}
+
+
+/**
+ *  Compares the two machines as they stand.
+ *
+ *  @param report TRUE to print them side by side, marking what differs
+ *
+ *  @return TRUE if they agree on everything
+ */
+bool compareMachines(bool report){
+    CosimMachine *reference = &cosimReference, *fast = &cosimFast;
+    bool matching = true;
+
+    #define COMPARE_FIELD(label, format, a, b)  do {                                                    \
+        bool same = (a) == (b);                                                                         \
+        matching = matching && same;                                                                    \
+        if (report && same) printf("%-10s    " format "    " format "\n", label, a, b);                  \
+        if (report && !same) printf("%-10s    " format "    " format "    <<\n", label, a, b);           \
+    } while (0)
+
+    if (report) printf("\n              %-10s    %s\n", reference->name, fast->name);
+
+    COMPARE_FIELD("Steps", "%-10d", reference->processor.stepCount, fast->processor.stepCount);
+    COMPARE_FIELD("PC", "0x%08X", tracedCounter(reference), tracedCounter(fast));
+    COMPARE_FIELD("Status", "%-10s", statusForFaultCode(reference->stopped ? reference->status : AOK),
+                  statusForFaultCode(fast->stopped ? fast->status : AOK));
+
+    COMPARE_FIELD("CZ", "%-10d", reference->processor.zeroFlag, fast->processor.zeroFlag);
+    COMPARE_FIELD("CS", "%-10d", reference->processor.signFlag, fast->processor.signFlag);
+    COMPARE_FIELD("CO", "%-10d", reference->processor.overflowFlag, fast->processor.overflowFlag);
+
+    for (int i = 0; i < 8; i++) {
+        const char *label = registerNames[i];
+
+        if (i == 4) COMPARE_FIELD(label, "0x%08X", reference->stackPointer, fast->stackPointer);
+        else if (i == 5) COMPARE_FIELD(label, "0x%08X", reference->framePointer, fast->framePointer);
+        else COMPARE_FIELD(label, "0x%08X", reference->processor.registers[i], fast->processor.registers[i]);
+    }
+
+    #undef COMPARE_FIELD
+
+    if (!matching && !report) return false;
+
+    return compareMemory(report) && matching;
+}
+
+
+/**
+ *  Prints both machines and exits, the two having disagreed.
+ *
+ *  @param agreedSteps   the step count they last agreed at
+ *  @param agreedCounter the program counter they agreed on then
+ */
+void reportDivergence(int agreedSteps, int agreedCounter){
+    flushConsole();
+
+    printf("\n\nCo-simulation diverged: the %s engine and the %s disagree by step %d.", cosimFast.name, cosimReference.name,
+           cosimReference.processor.stepCount > cosimFast.processor.stepCount ? cosimReference.processor.stepCount : cosimFast.processor.stepCount);
+    printf("\nThey last agreed after step %d, at PC 0x%08X.\n", agreedSteps, agreedCounter);
+
+    compareMachines(true);
+
+    exit(1);
+}
+
+
+/**
+ *  Runs the loaded program on the engine and the reference side by side, in place of runProgram(). If they agree
+ *  all the way, the reference side ends the run as a plain one would.
+ */
+void runCosimulation(){
+    CosimMachine *reference = &cosimReference, *fast = &cosimFast;
+
+    reference->space = activeAddressSpace;
+    reference->stopped = false;
+    leaveMachine(reference);
+
+    fast->space = acquireAddressSpace();
+    if (!fast->space) {
+        printf("\n\nFatal Error. No address space left in the pool for the %s engine.", fast->name);
+        quit(ADDRESS_FAULT);
+    }
+
+    fast->processor      = reference->processor;
+    fast->programCounter = reference->programCounter;
+    fast->stackPointer   = reference->stackPointer;
+    fast->framePointer   = reference->framePointer;
+    fast->devices        = reference->devices;
+    fast->stopped        = false;
+
+    int agreedSteps = reference->processor.stepCount;
+    int agreedCounter = tracedCounter(reference);
+    bool limited = false;
+
+    while (!reference->stopped || !fast->stopped) {
+        advanceMachine(fast, 0);
+        advanceMachine(reference, fast->processor.stepCount);
+
+        int steps = fast->processor.stepCount;
+        limited = cosimStepLimit && steps >= cosimStepLimit;
+
+        if (!fast->stopped && !reference->stopped && !limited && steps - agreedSteps < cosimInterval) continue;
+
+        cosimComparisons++;
+        if (!compareMachines(false)) reportDivergence(agreedSteps, agreedCounter);
+
+        agreedSteps = steps;
+        agreedCounter = tracedCounter(reference);
+
+        if (limited) break;
+    }
+
+    releaseAddressSpace(fast->space);
+    enterMachine(reference);
+    flushConsole();                             // the program's output comes first, as in omega()
+
+    if (verbose || !fuzzPrograms) {
+        printf("\nCo-simulation: the %s engine matched the %s over %d steps, %ld comparisons.", fast->name, reference->name,
+               agreedSteps, cosimComparisons);
+    }
+
+    if (limited) exit(0);                       // only fuzzed programs have a limit
+
+    quit(reference->status);
+}
+
+
+/**
+ *  Picks random numbers for the fuzzer, the same ones for the same seed on any host.
+ */
+unsigned int fuzzRandom(unsigned int *state){
+    unsigned int x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return *state = x;
+}
+
+
+/**
+ *  A register for a fuzzed instruction, seldom %esp or %ebp so more programs get a few blocks in.
+ */
+uint8_t fuzzRegister(unsigned int *state){
+    static const uint8_t common[6] = { 0, 1, 2, 3, 6, 7 };
+    return fuzzRandom(state) % 8 == 0 ? 4 + fuzzRandom(state) % 2 : common[fuzzRandom(state) % 6];
+}
+
+
+/**
+ *  Writes a random program: a stack set up most of the time, a few registers seeded with small values, then
+ *  random instructions of every kind the extensions that are on allow, with jumps and calls to instruction
+ *  boundaries, the odd invalid byte, and a halt at the end.
+ *
+ *  @param seed  picks the program
+ *  @param bytes where to write it, room for at least COSIM_FUZZ_INSTRUCTIONS * 6 + 64 bytes
+ *
+ *  @return its length
+ */
+int generateFuzzedProgram(unsigned int seed, uint8_t *bytes){
+    unsigned int state = seed * 2654435761u + 1;
+    int starts[COSIM_FUZZ_INSTRUCTIONS + 1];
+    int targets[COSIM_FUZZ_INSTRUCTIONS];
+    int length = 0;
+
+    #define EMIT_WORD(value)    do { int word_ = (value); memcpy(bytes + length, &word_, sizeof(int)); length += sizeof(int); } while (0)
+
+    if (fuzzRandom(&state) % 8) {                       // irmovl $0x4000, %esp; rrmovl %esp, %ebp
+        bytes[length++] = 0x30;
+        bytes[length++] = 0xF4;
+        EMIT_WORD(0x4000);
+        bytes[length++] = 0x20;
+        bytes[length++] = 0x45;
+    }
+
+    for (int i = fuzzRandom(&state) % 4; i > 0; i--) {    // irmovl $small, rB
+        bytes[length++] = 0x30;
+        bytes[length++] = 0xF0 | fuzzRegister(&state);
+        EMIT_WORD(fuzzRandom(&state) % 0x5000);
+    }
+
+    int count = 1 + fuzzRandom(&state) % COSIM_FUZZ_INSTRUCTIONS;
+
+    for (int i = 0; i < count; i++) {
+        uint8_t rA = fuzzRegister(&state), rB = fuzzRegister(&state);
+        int small = (int)(fuzzRandom(&state) % 0x5000) & ~3;
+        int any = fuzzRandom(&state) % 4 ? small : (int)fuzzRandom(&state);
+
+        starts[i] = length;
+        targets[i] = -1;
+
+        switch (fuzzRandom(&state) % 18) {
+            case 0:
+                bytes[length++] = fuzzRandom(&state) % 16 ? 0x10 : 0x00;       // nop, and now and then a halt
+                break;
+            case 1:
+            case 2:
+                bytes[length++] = 0x20 | fuzzRandom(&state) % 7;                // rrmovl, cmovXX
+                bytes[length++] = rA << 4 | rB;
+                break;
+            case 3:
+            case 4:
+                bytes[length++] = 0x30;
+                bytes[length++] = 0xF0 | rB;
+                EMIT_WORD(any);
+                break;
+            case 5:
+            case 6:
+                bytes[length++] = 0x40 | 0x10 * (fuzzRandom(&state) % 2);      // rmmovl, mrmovl
+                bytes[length++] = rA << 4 | rB;
+                EMIT_WORD(fuzzRandom(&state) % 4 ? small : any);
+                break;
+            case 7:
+            case 8:
+            case 9: {
+                int functions = isaExtensions & EXTENSION_MULDIV ? 7 : 4;
+                bytes[length++] = 0x60 | fuzzRandom(&state) % functions;
+                bytes[length++] = rA << 4 | rB;
+                break;
+            }
+            case 10:
+            case 11:
+                bytes[length++] = 0x70 | fuzzRandom(&state) % 7;                // jmp, jXX
+                targets[i] = fuzzRandom(&state) % (count + 1);
+                EMIT_WORD(0);
+                break;
+            case 12:
+                bytes[length++] = 0x80;
+                targets[i] = fuzzRandom(&state) % (count + 1);
+                EMIT_WORD(0);
+                break;
+            case 13:
+                bytes[length++] = 0x90;
+                break;
+            case 14:
+            case 15:
+                bytes[length++] = fuzzRandom(&state) % 2 ? 0xA0 : 0xB0;         // pushl, popl
+                bytes[length++] = rA << 4 | 0xF;
+                break;
+            case 16:
+                if (isaExtensions & EXTENSION_IADDL) {
+                    bytes[length++] = 0xC0;
+                    bytes[length++] = 0xF0 | rB;
+                    EMIT_WORD(any);
+                } else {
+                    bytes[length++] = 0x10;
+                }
+                break;
+            default:
+                if ((isaExtensions & EXTENSION_LEAVE) && fuzzRandom(&state) % 2) bytes[length++] = 0xD0;
+                else if ((isaExtensions & EXTENSION_BLOCK) && fuzzRandom(&state) % 2) bytes[length++] = 0xE0 | fuzzRandom(&state) % 2;
+                else bytes[length++] = fuzzRandom(&state) % 4 ? 0x10 : (uint8_t)fuzzRandom(&state);     // some invalid byte
+                break;
+        }
+    }
+
+    starts[count] = length;
+    bytes[length++] = 0x00;
+
+    for (int i = 0; i < count; i++) {                   // the jumps and calls land on instruction boundaries
+        if (targets[i] >= 0) memcpy(bytes + starts[i] + 1, &starts[targets[i]], sizeof(int));
+    }
+
+    if (bytes[0] == 0x2E) bytes[0] = 0x10;              // would read as a Y86-64 header
+
+    #undef EMIT_WORD
+
+    return length;
+}
+
+
+/**
+ *  Loads a fuzzed program in place of the input and co-simulates it. Never comes back.
+ */
+void runFuzzedProgram(unsigned int seed){
+    uint8_t bytes[COSIM_FUZZ_INSTRUCTIONS * 6 + 64];
+    int length = generateFuzzedProgram(seed, bytes);
+
+    if (!storeInstructionBlock(bytes, length) || !instructionLoadComplete()) exit(2);
+
+    selectInterpreter();
+    if (!prepareCosimulation()) exit(2);
+
+    cosimStepLimit = COSIM_FUZZ_STEPS;
+
+    if (setjmp(runCompleted) == 0) {
+        runInProgress = true;
+        runCosimulation();
+    }
+
+    exit(0);
+}
+
+
+/**
+ *  Co-simulates --fuzz random programs, each in a child process, and stops at the first that diverges or crashes.
+ *  One still going after COSIM_FUZZ_MILLISECONDS is skipped.
+ *  Program i comes from seed + i, so --fuzz 1 --seed with that number makes it again. Never comes back.
+ */
+void runFuzzer(){
+    if (!cosimModesSupported()) quit(PROGRAM_ERROR);
+    if (!fuzzSeed) fuzzSeed = (unsigned int)time(NULL);
+
+    int timedOut = 0;
+
+    printf("\nFuzzing %d programs against the %s engine, seed %u\n", fuzzPrograms, cosimEngineName, fuzzSeed);
+
+    for (int i = 0; i < fuzzPrograms; i++) {
+        unsigned int seed = fuzzSeed + i;
+
+        fflush(stdout);
+        pid_t child = fork();
+
+        if (child == 0) {
+            freopen("/dev/null", "r", stdin);           // fuzzed programs may read the console
+            freopen("/dev/null", "w", stdout);
+            struct itimerval limit = { { 0, 0 }, { 0, COSIM_FUZZ_MILLISECONDS * 1000 } };
+            setitimer(ITIMER_REAL, &limit, NULL);       // a verified stretch can loop where the step limit can't see
+            runFuzzedProgram(seed);
+        }
+
+        int status = 0;
+        if (child < 0 || waitpid(child, &status, 0) < 0) {
+            printf("\n\nCould not start a process for program %d.", i);
+            exit(1);
+        }
+
+        if (WIFEXITED(status) && WEXITSTATUS(status) == 0) continue;
+
+        if (WIFSIGNALED(status) && WTERMSIG(status) == SIGALRM) {
+            timedOut++;
+            continue;
+        }
+
+        uint8_t bytes[COSIM_FUZZ_INSTRUCTIONS * 6 + 64];
+        int length = generateFuzzedProgram(seed, bytes);
+
+        printf("\nProgram %d, seed %u, %s:\n", i, seed, WIFSIGNALED(status) ? "crashed the machine" : "diverged");
+        for (int j = 0; j < length; j++) printf("%02X", bytes[j]);
+        printf("\n");
+
+        if (WIFSIGNALED(status)) exit(1);
+
+        freopen("/dev/null", "r", stdin);
+        runFuzzedProgram(seed);                         // again, to show where
+    }
+
+    printf("\nThe %s engine matched the reference on all %d programs", cosimEngineName, fuzzPrograms - timedOut);
+    if (timedOut) printf(", and %d more ran out of time inside a single step", timedOut);
+    printf(".\n");
+    exit(0);
+}
@@ -0,0 +1,38 @@
+//
+//  EScosim.h
+//  Eighty-Sixer
+//
+//  Created by agent on 10/19/26.
+//  Copyright (c) 2026 agent. All rights reserved.
+//
+
+#ifndef __Eighty_Sixer__EScosim__
+#define __Eighty_Sixer__EScosim__
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#define COSIM_FUZZ_STEPS        20000       // steps a fuzzed program gets before it counts as agreeing, most loop
+#define COSIM_FUZZ_MILLISECONDS 250         // for one that never gets to the end of an engine step
+#define COSIM_FUZZ_INSTRUCTIONS 64          // instructions in a fuzzed program at most, before the final halt
+#define COSIM_MEMORY_REPORTED   8           // differing words listed in a divergence report
+
+typedef struct CosimEngine {
+    const char *name;
+    bool (*prepare)();                      // FALSE if it can't run the loaded program
+    void (*step)();                         // a block, a stretch or a single instruction from the program counter
+} CosimEngine;
+
+extern const char *cosimEngineName;         // the engine checked against the interpreter, NULL without --cosim
+extern int cosimInterval;
+extern int fuzzPrograms;
+extern unsigned int fuzzSeed;
+extern bool cosimCatchingStops;
+
+bool prepareCosimulation();
+void runCosimulation();
+void cosimStopped(int);                     // a FaultCode, from omega()
+void runFuzzer();
+
+#endif /* defined(__Eighty_Sixer__EScosim__) */
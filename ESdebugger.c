@@ -0,0 +1,471 @@
+//
+//  ESdebugger.c
+//  Eighty-Sixer
+//
+//  Created by agent on 10/19/26.
+//  Copyright (c) 2026 agent. All rights reserved.
+//
+
+#include "ESdebugger.h"
+#include "main.h"
+
+#define DEBUGGER_STOPPED    1               // what omega() hands back through runCompleted
+#define DEBUGGER_BREAK      2               // a breakpoint or watchpoint stopped us
+
+typedef struct Breakpoint {
+    int address;
+} Breakpoint;
+
+typedef struct Watchpoint {
+    int address;
+    int value;                              // what the word held the last time we looked
+} Watchpoint;
+
+typedef enum BreakpointMode {
+    BREAKPOINTS_PASS, BREAKPOINTS_STOP, BREAKPOINTS_RECORD
+} BreakpointMode;
+
+bool debugging = false;
+bool programStopped = false;            // TRUE once the program has halted or faulted; only going back makes sense then
+
+Breakpoint breakpoints[DEBUGGER_MAX_BREAKPOINTS];
+int breakpointCount = 0;
+
+Watchpoint watchpoints[DEBUGGER_MAX_WATCHPOINTS];
+int watchpointCount = 0;
+
+BreakpointMode breakpointMode = BREAKPOINTS_PASS;
+int resumeAddress = -1;                 // the breakpoint we are sitting on, run over once when we move off it
+int recordedBreakpointStep = -1;        // where BREAKPOINTS_RECORD last saw a breakpoint
+
+
+void printDebuggerHelp(){
+    printf("Commands:\n");
+    printf("  s, step [n]           run n instructions (default 1)\n");
+    printf("  c, continue           run until a breakpoint, a watchpoint, or the program stops\n");
+    printf("  rs, rstep [n]         go back n instructions (default 1)\n");
+    printf("  rc, rcontinue         go back to the last breakpoint or watched write, or the start\n");
+    printf("  lw, lastwrite ADDR    go back to just after the last store to ADDR\n");
+    printf("  b, break ADDR         stop before running the instruction at ADDR\n");
+    printf("  w, watch ADDR         stop after any store to the word at ADDR\n");
+    printf("  d, delete ADDR        remove the breakpoint or watchpoint at ADDR\n");
+    printf("  info                  list breakpoints and watchpoints\n");
+    printf("  x ADDR [n]            print n words of memory starting at ADDR (default 4)\n");
+    printf("  r, regs               print the registers\n");
+    printf("  snapshots             list the snapshots kept for going back\n");
+    printf("  q, quit               leave the debugger\n");
+    printf("ADDR is a number or a symbol, from --symbols or the labels of an assembled program.\n");
+}
+
+
+int currentAddress(){
+    return physicalToRelativeAddress((int *)currentInstructionByte);
+}
+
+void printLocation(){
+    char name[96];
+
+    if (symbolCount) printf("Step %d, PC 0x%08X <%s>\n", stepCount, currentAddress(), symbolForAddress(currentAddress(), name, sizeof(name)));
+    else printf("Step %d, PC 0x%08X\n", stepCount, currentAddress());
+}
+
+/**
+ *  Reads an ADDR argument: a symbol, e.g. an assembler label, or a number.
+ */
+int parseAddress(const char *argument){
+    int address;
+    if (addressForSymbol(argument, &address)) return address;
+
+    return (int)strtol(argument, NULL, 0);
+}
+
+
+/**
+ *  Reads a guest word for the debugger without any of the checks a guest load goes through.
+ *
+ *  @return FALSE if the word is outside the sandbox
+ */
+bool peekWord(int address, int *value){
+    if (address < 0 || address > requestedSize - (int)sizeof(int)) return false;
+
+    *value = *(int *)(sandboxFloor + address);
+    return true;
+}
+
+
+Breakpoint *breakpointAt(int address){
+    for (int i = 0; i < breakpointCount; i++) {
+        if (breakpoints[i].address == address) return &breakpoints[i];
+    }
+
+    return NULL;
+}
+
+
+/**
+ *  Plants the trap byte over the first byte of every breakpointed instruction. Restoring a snapshot can put
+ *  back code bytes from before a breakpoint was set, so this runs again after every trip through history.
+ */
+void refreshBreakpoints(){
+    for (int i = 0; i < breakpointCount; i++) {
+        sandboxFloor[breakpoints[i].address] = BREAKPOINT_TRAP;
+    }
+}
+
+
+/**
+ *  Write protects every page holding a watched word, and remembers what each word holds now.
+ */
+void armWatchpoints(){
+    writeTrapTripped = 0;
+
+    for (int i = 0; i < watchpointCount; i++) {
+        peekWord(watchpoints[i].address, &watchpoints[i].value);
+
+        trapWritesToPage(activeAddressSpace, watchpoints[i].address >> GUEST_PAGE_SHIFT, true);
+        trapWritesToPage(activeAddressSpace, (watchpoints[i].address + (int)sizeof(int) - 1) >> GUEST_PAGE_SHIFT, true);
+    }
+}
+
+
+/**
+ *  Finds the watchpoint whose word overlaps a store, as storeAboutToRun() gave it before the step. The trap only
+ *  says where the store first hit a watched page, not where it started or how far it went.
+ */
+Watchpoint *watchpointStoredTo(int64_t start, int64_t end){
+    for (int i = 0; i < watchpointCount; i++) {
+        if (start < (int64_t)watchpoints[i].address + (int)sizeof(int) && end > watchpoints[i].address) {
+            return &watchpoints[i];
+        }
+    }
+
+    return NULL;
+}
+
+
+/**
+ *  Called from the ALU when it runs into the trap byte. Breakpoints are patched into the program itself, so
+ *  running with breakpoints set costs nothing until one is actually reached. Depending on the mode we stop
+ *  in front of the instruction, note that we got here, or just run the instruction the trap is covering.
+ *
+ *  @param instruction the byte that was fetched
+ */
+void breakpointTrap(uint8_t instruction){
+    int address = currentAddress() - 1;
+    Breakpoint *breakpoint = breakpointAt(address);
+
+    if (!breakpoint && (instruction != BREAKPOINT_TRAP || !pristineImage || address >= pristineImageLength ||
+                        pristineImage[address] == BREAKPOINT_TRAP)) {
+        quit(INSTRUCTION_FAULT);                            // a genuine icode F in the program
+    }
+
+    uint8_t original = pristineImage[address];
+
+    if (!breakpoint) {
+        sandboxFloor[address] = original;                   // left over from a snapshot taken before the breakpoint was deleted
+    } else if (breakpointMode == BREAKPOINTS_STOP && address != resumeAddress) {
+        currentInstructionByte--;                           // the instruction underneath hasn't run yet
+        stepCount--;
+
+        runInProgress = false;
+        longjmp(runCompleted, DEBUGGER_BREAK);
+    } else if (breakpointMode == BREAKPOINTS_RECORD) {
+        recordedBreakpointStep = stepCount - 1;
+    }
+
+    resumeAddress = -1;
+    executeInstruction(original);
+}
+
+
+/**
+ *  Runs forward with breakpoints and watchpoints live. The only per-step work beyond the plain loop in alpha()
+ *  is taking snapshots and looking at the write trap flag; breakpoints cost nothing until reached.
+ *
+ *  @param step the step to stop at if nothing else stops us first
+ */
+void runForward(int step){
+    refreshBreakpoints();
+    armWatchpoints();
+
+    breakpointMode = BREAKPOINTS_STOP;
+    resumeAddress = currentAddress();
+
+    while (stepCount < step && hasNextInstruction()) {
+        takeSnapshotIfDue();
+
+        int64_t storeStart, storeEnd;
+        bool storing = storeAboutToRun(&storeStart, &storeEnd);
+
+        startCycle();
+
+        if (writeTrapTripped) {
+            writeTrapTripped = 0;
+
+            Watchpoint *watchpoint = storing ? watchpointStoredTo(storeStart, storeEnd) : NULL;
+            int before = watchpoint ? watchpoint->value : 0;
+
+            armWatchpoints();                           // the trap only fires once, put it back
+
+            if (watchpoint) {
+                printf("Watchpoint 0x%08X: 0x%08X -> 0x%08X\n", watchpoint->address, before, watchpoint->value);
+
+                breakpointMode = BREAKPOINTS_PASS;
+                runInProgress = false;
+                longjmp(runCompleted, DEBUGGER_BREAK);
+            }
+        }
+    }
+
+    breakpointMode = BREAKPOINTS_PASS;
+    clearWriteTraps(activeAddressSpace);
+}
+
+
+void reverseStartInterval(){
+    refreshBreakpoints();
+    armWatchpoints();
+
+    breakpointMode = BREAKPOINTS_RECORD;
+    recordedBreakpointStep = -1;
+}
+
+bool reverseStoring;                    // what the step being replayed stores, see storeAboutToRun()
+int64_t reverseStoreStart;
+int64_t reverseStoreEnd;
+
+void reverseBeforeStep(){
+    reverseStoring = storeAboutToRun(&reverseStoreStart, &reverseStoreEnd);
+}
+
+int reverseAfterStep(int startAddress){
+    (void)startAddress;
+    int match = -1;
+
+    if (recordedBreakpointStep >= 0) {
+        match = recordedBreakpointStep;
+        recordedBreakpointStep = -1;
+    }
+
+    if (writeTrapTripped) {
+        writeTrapTripped = 0;
+        if (reverseStoring && watchpointStoredTo(reverseStoreStart, reverseStoreEnd)) match = stepCount;
+
+        armWatchpoints();
+    }
+
+    return match;
+}
+
+void reverseFinishInterval(){
+    breakpointMode = BREAKPOINTS_PASS;
+    clearWriteTraps(activeAddressSpace);
+}
+
+
+/**
+ *  Prints memory as words, four to a line.
+ */
+void examineMemory(int address, int words){
+    for (int i = 0; i < words; i++) {
+        int value;
+
+        if (i % 4 == 0) printf("%s0x%08X:", i ? "\n" : "", address + i * 4);
+
+        if (peekWord(address + i * 4, &value)) printf(" 0x%08X", value);
+        else printf(" ----------");
+    }
+
+    printf("\n");
+}
+
+
+void listBreakpointsAndWatchpoints(){
+    if (!breakpointCount && !watchpointCount) printf("No breakpoints or watchpoints.\n");
+
+    for (int i = 0; i < breakpointCount; i++) printf("Breakpoint at 0x%08X\n", breakpoints[i].address);
+    for (int i = 0; i < watchpointCount; i++) printf("Watchpoint on 0x%08X\n", watchpoints[i].address);
+}
+
+
+/**
+ *  Carries out one debugger command.
+ *
+ *  @param command  the command word
+ *  @param argument the first argument, possibly empty
+ *  @param extra    the second argument, possibly empty
+ *
+ *  @return FALSE when the debugger should exit
+ */
+bool runDebuggerCommand(const char *command, const char *argument, const char *extra){
+    long count = argument[0] ? strtol(argument, NULL, 0) : 1;
+
+    if (!strcmp(command, "s") || !strcmp(command, "step")) {
+        if (programStopped) {
+            printf("The program has stopped. Use rstep to go back.\n");
+            return true;
+        }
+
+        runForward(stepCount + (int)count);
+        if (!hasNextInstruction()) quit(HALT);              // ran off the end of the program, same as alpha()
+
+        printLocation();
+
+    } else if (!strcmp(command, "c") || !strcmp(command, "continue")) {
+        if (programStopped) {
+            printf("The program has stopped. Use rstep to go back.\n");
+            return true;
+        }
+
+        runForward(INT_MAX);
+        quit(HALT);
+
+    } else if (!strcmp(command, "rs") || !strcmp(command, "rstep")) {
+        if (!travelToStep(stepCount - (int)count)) printf("Can't go back that far.\n");
+
+        programStopped = false;
+        printLocation();
+
+    } else if (!strcmp(command, "rc") || !strcmp(command, "rcontinue")) {
+        HistoryProbe probe = { reverseStartInterval, reverseBeforeStep, reverseAfterStep, reverseFinishInterval };
+
+        if (searchHistoryBackwards(&probe) < 0) travelToStep(0);
+
+        programStopped = false;
+        printLocation();
+
+    } else if (!strcmp(command, "lw") || !strcmp(command, "lastwrite")) {
+        if (!argument[0]) {
+            printf("Usage: lastwrite ADDR\n");
+            return true;
+        }
+
+        int writer = 0;
+        int step = findLastWriteTo(parseAddress(argument), &writer);
+
+        if (step < 0) {
+            printf("Nothing has written to %s yet.\n", argument);
+        } else {
+            programStopped = false;
+            printf("Written by the instruction at PC 0x%08X.\n", writer);
+            printLocation();
+        }
+
+    } else if (!strcmp(command, "b") || !strcmp(command, "break")) {
+        int address = parseAddress(argument);
+
+        if (!argument[0] || address < 0 || address >= pristineImageLength) {
+            printf("Breakpoints go on instructions inside the program (0x0 to 0x%X).\n", pristineImageLength - 1);
+        } else if (!breakpointAt(address) && breakpointCount < DEBUGGER_MAX_BREAKPOINTS) {
+            breakpoints[breakpointCount++].address = address;
+            printf("Breakpoint at 0x%08X\n", address);
+        }
+
+    } else if (!strcmp(command, "w") || !strcmp(command, "watch")) {
+        int address = parseAddress(argument);
+        int value;
+
+        if (!argument[0] || !peekWord(address, &value)) {
+            printf("Watchpoints go on words inside the sandbox.\n");
+        } else if (watchpointCount < DEBUGGER_MAX_WATCHPOINTS) {
+            watchpoints[watchpointCount].address = address;
+            watchpoints[watchpointCount++].value = value;
+            printf("Watchpoint on 0x%08X\n", address);
+        }
+
+    } else if (!strcmp(command, "d") || !strcmp(command, "delete")) {
+        int address = parseAddress(argument);
+
+        for (int i = 0; i < breakpointCount; i++) {
+            if (breakpoints[i].address != address) continue;
+
+            sandboxFloor[address] = pristineImage[address];
+            breakpoints[i] = breakpoints[--breakpointCount];
+            printf("Deleted breakpoint at 0x%08X\n", address);
+        }
+
+        for (int i = 0; i < watchpointCount; i++) {
+            if (watchpoints[i].address != address) continue;
+
+            watchpoints[i] = watchpoints[--watchpointCount];
+            printf("Deleted watchpoint on 0x%08X\n", address);
+        }
+
+    } else if (!strcmp(command, "info")) {
+        listBreakpointsAndWatchpoints();
+
+    } else if (!strcmp(command, "x")) {
+        if (!argument[0]) {
+            printf("Usage: x ADDR [n]\n");
+            return true;
+        }
+
+        examineMemory(parseAddress(argument), extra[0] ? (int)strtol(extra, NULL, 0) : 4);
+
+    } else if (!strcmp(command, "r") || !strcmp(command, "regs")) {
+        printHarmonFormattedTrace(programStopped ? statusForFaultCode(lastFaultCode) : "AOK");
+        printf("\n");
+
+    } else if (!strcmp(command, "snapshots")) {
+        listSnapshots();
+
+    } else if (!strcmp(command, "q") || !strcmp(command, "quit")) {
+        return false;
+
+    } else {
+        printDebuggerHelp();
+    }
+
+    return true;
+}
+
+
+/**
+ *  Reads debugger commands from standard input, after the program bytes, until quit or end of input.
+ *  If the program halts or faults while running, omega() prints the trace and drops us back here.
+ */
+void runDebugger(){
+    char line[256];
+
+    startTimeTravel();
+
+    printf("\nEighty-Sixer debugger. Type help for commands.\n");
+    printLocation();
+
+    for (;;) {
+        flushConsole();
+        printf("(86) ");
+        fflush(stdout);
+
+        if (!fgets(line, sizeof(line), stdin)) break;
+
+        char command[32] = { 0 };
+        char argument[64] = { 0 };
+        char extra[64] = { 0 };
+        if (sscanf(line, "%31s %63s %63s", command, argument, extra) < 1) continue;
+
+        int stopped = setjmp(runCompleted);
+
+        if (stopped) {                              // the program stopped while we were running it
+            breakpointMode = BREAKPOINTS_PASS;
+            clearWriteTraps(activeAddressSpace);
+
+            if (stopped == DEBUGGER_BREAK) {
+                printLocation();
+            } else {
+                programStopped = true;
+            }
+
+            continue;
+        }
+
+        runInProgress = true;
+        bool keepGoing = runDebuggerCommand(command, argument, extra);
+        runInProgress = false;
+
+        if (!keepGoing) break;
+    }
+
+    printf("\n");
+    exit(0);
+}
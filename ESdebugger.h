@@ -0,0 +1,25 @@
+//
+//  ESdebugger.h
+//  Eighty-Sixer
+//
+//  Created by agent on 10/19/26.
+//  Copyright (c) 2026 agent. All rights reserved.
+//
+
+#ifndef __Eighty_Sixer__ESdebugger__
+#define __Eighty_Sixer__ESdebugger__
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#define BREAKPOINT_TRAP             0xF0        // icode F is unused by Y86, so it makes a good trap
+#define DEBUGGER_MAX_BREAKPOINTS    64
+#define DEBUGGER_MAX_WATCHPOINTS    16
+
+extern bool debugging;
+
+void runDebugger();
+void breakpointTrap(uint8_t);
+
+#endif /* defined(__Eighty_Sixer__ESdebugger__) */
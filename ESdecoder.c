@@ -0,0 +1,343 @@
+//
+//  ESdecoder.c
+//  Eighty-Sixer
+//
+//  Created by agent on 10/19/26.
+//  Copyright (c) 2026 agent. All rights reserved.
+//
+
+#include "ESdecoder.h"
+#include "main.h"
+
+/*  Static decoding of a loaded program image. Everything here mirrors what the handlers in ESalu.c do when they
+    meet the same bytes, including which encodings they fault on, so that tools working from the image agree
+    with the interpreter instruction for instruction.
+ */
+
+
+/**
+ *  Gives the number of bytes the interpreter reads for an instruction with the given icode/ifun byte.
+ *
+ *  @param instruction the icode/ifun byte
+ *
+ *  @return the length in bytes. Unknown icodes, and extensions that are off, are one byte long; they fault as soon
+ *          as they are read.
+ */
+int instructionLength(uint8_t instruction){
+    switch ((instruction & 0xF0) >> 4) {
+        case 2:         // rrmovl, cmovXX
+        case 6:         // OPl
+        case 0xA:       // pushl
+        case 0xB:       // popl
+            return 2;
+        case 3:         // irmovl
+        case 4:         // rmmovl
+        case 5:         // mrmovl
+            return 6;
+        case 7:         // jXX
+        case 8:         // call
+            return 5;
+        case 0xC:       // iaddl, if the extension is on
+            return (isaExtensions & EXTENSION_IADDL) ? 6 : 1;
+
+        default:
+            return 1;
+    }
+}
+
+
+/**
+ *  Decodes the instruction starting at the given address of a program image.
+ *
+ *  @param image       the program image, address 0 first
+ *  @param imageLength the number of bytes in the image
+ *  @param address     where the instruction starts
+ *  @param decoded     filled in with the instruction
+ *
+ *  @return FALSE if the address is outside the image
+ */
+bool decodeInstruction(const uint8_t *image, int imageLength, int address, DecodedInstruction *decoded){
+    if (address < 0 || address >= imageLength) return false;
+
+    memset(decoded, 0, sizeof(DecodedInstruction));
+
+    uint8_t instruction = image[address];
+    decoded->address   = address;
+    decoded->icode     = (instruction & 0xF0) >> 4;
+    decoded->ifun      = instruction & 0xF;
+    decoded->registerA = NO_REGISTER;
+    decoded->registerB = NO_REGISTER;
+    decoded->length    = instructionLength(instruction);
+    decoded->available = imageLength - address < decoded->length ? imageLength - address : decoded->length;
+
+    if (decoded->available < decoded->length) return true;      // the interpreter faults ADR partway through reading it
+
+    int constantAt = address + 1;
+
+    if (decoded->length == 2 || decoded->length == 6) {
+        decoded->registerA = (image[address + 1] & 0xF0) >> 4;
+        decoded->registerB = image[address + 1] & 0xF;
+        constantAt++;
+    }
+
+    if (decoded->length >= 5) {
+        for (int i = 0; i < 4; i++) {
+            decoded->constant |= (int)((unsigned int)image[constantAt + i] << (i * 8));
+        }
+    }
+
+    bool validA = decoded->registerA < 8;
+    bool validB = decoded->registerB < 8;
+
+    switch (decoded->icode) {
+        case 0:         // halt
+        case 1:         // nop
+        case 8:         // call
+        case 9:         // ret
+            decoded->valid = true;
+            break;
+        case 2:
+            decoded->valid = decoded->ifun <= 6 && validA && validB;
+            break;
+        case 3:
+            decoded->valid = validB;                // irmovl never looks at register A
+            break;
+        case 4:
+        case 5:
+            decoded->valid = validA && validB;
+            break;
+        case 6:
+            decoded->valid = (decoded->ifun <= 3 || (decoded->ifun <= 6 && (isaExtensions & EXTENSION_MULDIV))) && validA && validB;
+            break;
+        case 7:
+            decoded->valid = decoded->ifun <= 6;
+            break;
+        case 0xA:
+        case 0xB:
+            decoded->valid = validA && decoded->registerB == NO_REGISTER;
+            break;
+        case 0xC:
+            decoded->valid = (isaExtensions & EXTENSION_IADDL) && decoded->ifun == 0 && decoded->registerA == NO_REGISTER && validB;
+            break;
+        case 0xD:
+            decoded->valid = (isaExtensions & EXTENSION_LEAVE) && decoded->ifun == 0;
+            break;
+        case 0xE:
+            decoded->valid = (isaExtensions & EXTENSION_BLOCK) && decoded->ifun <= 1;
+            break;
+        case 0xF:
+            decoded->valid = (isaExtensions & EXTENSION_TRAP) && decoded->ifun == 1;       // F0 is only ever a breakpoint
+            break;
+
+        default:
+            decoded->valid = false;
+            break;
+    }
+
+    return true;
+}
+
+
+/**
+ *  Tells whether execution can leave an instruction somewhere other than the next one, or stops at it.
+ */
+bool endsBasicBlock(const DecodedInstruction *decoded){
+    if (!decoded->valid || decoded->available < decoded->length) return true;
+
+    switch (decoded->icode) {
+        case 0:         // halt
+        case 7:         // jXX
+        case 8:         // call
+        case 9:         // ret
+            return true;
+
+        default:
+            return false;
+    }
+}
+
+
+/**
+ *  Tells whether execution can carry on to the instruction straight after this one.
+ */
+bool fallsThrough(const DecodedInstruction *decoded){
+    if (!decoded->valid || decoded->available < decoded->length) return false;
+
+    switch (decoded->icode) {
+        case 0:
+        case 9:
+            return false;
+        case 7:
+            return decoded->ifun != 0;              // only a conditional jump can fall through
+        case 8:
+            return true;                            // the return site, once the callee returns
+
+        default:
+            return true;
+    }
+}
+
+
+const char *registerName(int index){
+    static const char *names[] = { "%eax", "%ecx", "%edx", "%ebx", "%esp", "%ebp", "%esi", "%edi" };
+
+    if (index < 0 || index > 7) return "%???";
+
+    return names[index];
+}
+
+
+/**
+ *  Writes an instruction in assembler syntax, e.g. "mrmovl 0x8(%ebp), %eax".
+ *
+ *  @param decoded the instruction
+ *  @param buffer  where to put the text
+ *  @param size    the size of buffer
+ *
+ *  @return buffer
+ */
+const char *describeInstruction(const DecodedInstruction *decoded, char *buffer, size_t size){
+    static const char *conditions[] = { "", "le", "l", "e", "ne", "ge", "g" };
+    static const char *operations[] = { "addl", "subl", "andl", "xorl", "mull", "divl", "modl" };
+
+    const char *nameA = registerName(decoded->registerA);
+    const char *nameB = registerName(decoded->registerB);
+
+    if (decoded->available < decoded->length) {
+        snprintf(buffer, size, "(truncated, %d of %d bytes)", decoded->available, decoded->length);
+        return buffer;
+    }
+
+    if (!decoded->valid) {
+        snprintf(buffer, size, "(invalid %X%X)", decoded->icode, decoded->ifun);
+        return buffer;
+    }
+
+    switch (decoded->icode) {
+        case 0:
+            snprintf(buffer, size, "halt");
+            break;
+        case 1:
+            snprintf(buffer, size, "nop");
+            break;
+        case 2:
+            if (decoded->ifun == 0) snprintf(buffer, size, "rrmovl %s, %s", nameA, nameB);
+            else snprintf(buffer, size, "cmov%s %s, %s", conditions[decoded->ifun], nameA, nameB);
+            break;
+        case 3:
+            snprintf(buffer, size, "irmovl $0x%x, %s", decoded->constant, nameB);
+            break;
+        case 4:
+            snprintf(buffer, size, "rmmovl %s, 0x%x(%s)", nameA, decoded->constant, nameB);
+            break;
+        case 5:
+            snprintf(buffer, size, "mrmovl 0x%x(%s), %s", decoded->constant, nameB, nameA);
+            break;
+        case 6:
+            snprintf(buffer, size, "%s %s, %s", operations[decoded->ifun], nameA, nameB);
+            break;
+        case 7:
+            snprintf(buffer, size, "j%s 0x%x", decoded->ifun ? conditions[decoded->ifun] : "mp", decoded->constant);
+            break;
+        case 8:
+            snprintf(buffer, size, "call 0x%x", decoded->constant);
+            break;
+        case 9:
+            snprintf(buffer, size, "ret");
+            break;
+        case 0xA:
+            snprintf(buffer, size, "pushl %s", nameA);
+            break;
+        case 0xB:
+            snprintf(buffer, size, "popl %s", nameA);
+            break;
+        case 0xC:
+            snprintf(buffer, size, "iaddl $0x%x, %s", decoded->constant, nameB);
+            break;
+        case 0xD:
+            snprintf(buffer, size, "leave");
+            break;
+        case 0xE:
+            snprintf(buffer, size, decoded->ifun ? "memset" : "memcpy");
+            break;
+        case 0xF:
+            snprintf(buffer, size, "trap");
+            break;
+    }
+
+    return buffer;
+}
+
+
+/**
+ *  Marks an address as the start of a basic block, queueing it to be walked if it's new and inside the image.
+ */
+void markLeader(ControlFlowGraph *graph, int address, int *worklist, int *pending){
+    if (address < 0 || address >= graph->imageLength || graph->leader[address]) return;
+
+    graph->leader[address] = true;
+    graph->blockCount++;
+    worklist[(*pending)++] = address;
+}
+
+
+/**
+ *  Finds the basic blocks reachable from address 0 by following direct jumps, calls and fall throughs.
+ *  A block starts at the entry point, at every jump or call destination and after every conditional jump or call.
+ *  Where ret goes is only known at run time; the return sites after each call are the blocks it's expected to reach.
+ *
+ *  @param image       the program image
+ *  @param imageLength the number of bytes in the image
+ *  @param graph       filled in with the blocks. Free with freeControlFlow()
+ *
+ *  @return FALSE if memory ran out
+ */
+bool recoverControlFlow(const uint8_t *image, int imageLength, ControlFlowGraph *graph){
+    graph->imageLength = imageLength;
+    graph->blockCount  = 0;
+    graph->hasReturn   = false;
+    graph->leader      = calloc(imageLength + 1, sizeof(bool));
+
+    int *worklist = malloc((imageLength + 1) * sizeof(int));            // every address is queued at most once
+    int pending = 0;
+
+    if (!graph->leader || !worklist) {
+        free(worklist);
+        freeControlFlow(graph);
+        return false;
+    }
+
+    markLeader(graph, 0, worklist, &pending);
+
+    while (pending > 0) {
+        int address = worklist[--pending];
+        DecodedInstruction decoded;
+
+        while (decodeInstruction(image, imageLength, address, &decoded)) {
+            if (endsBasicBlock(&decoded)) {
+                if (decoded.valid && (decoded.icode == 7 || decoded.icode == 8)) {
+                    markLeader(graph, decoded.constant, worklist, &pending);
+                }
+
+                if (decoded.valid && decoded.icode == 9) graph->hasReturn = true;
+
+                if (fallsThrough(&decoded)) markLeader(graph, address + decoded.length, worklist, &pending);
+                break;
+            }
+
+            address += decoded.length;
+            if (address < imageLength && graph->leader[address]) break;        // already walked, or queued to be
+        }
+    }
+
+    free(worklist);
+
+    return true;
+}
+
+
+void freeControlFlow(ControlFlowGraph *graph){
+    free(graph->leader);
+    graph->leader = NULL;
+    graph->blockCount = 0;
+}
@@ -0,0 +1,47 @@
+//
+//  ESdecoder.h
+//  Eighty-Sixer
+//
+//  Created by agent on 10/19/26.
+//  Copyright (c) 2026 agent. All rights reserved.
+//
+
+#ifndef __Eighty_Sixer__ESdecoder__
+#define __Eighty_Sixer__ESdecoder__
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#define NO_REGISTER 0xF
+
+typedef struct DecodedInstruction {
+    int     address;
+    uint8_t icode;
+    uint8_t ifun;
+    uint8_t registerA;              // register nibbles as encoded, NO_REGISTER when unused
+    uint8_t registerB;
+    int     constant;               // the immediate, displacement or destination, if the instruction has one
+    int     length;                 // how many bytes the interpreter reads for it
+    int     available;              // how many of those are inside the image, less than length if it runs off the end
+    bool    valid;                  // FALSE if the interpreter faults INS once it has read all of it
+} DecodedInstruction;
+
+typedef struct ControlFlowGraph {
+    int   imageLength;
+    bool *leader;                   // by address, TRUE where a basic block starts
+    int   blockCount;
+    bool  hasReturn;                // some reachable block ends in ret
+} ControlFlowGraph;
+
+int  instructionLength(uint8_t);
+bool decodeInstruction(const uint8_t*, int, int, DecodedInstruction*);
+bool endsBasicBlock(const DecodedInstruction*);
+bool fallsThrough(const DecodedInstruction*);
+const char *registerName(int);
+const char *describeInstruction(const DecodedInstruction*, char*, size_t);
+
+bool recoverControlFlow(const uint8_t*, int, ControlFlowGraph*);
+void freeControlFlow(ControlFlowGraph*);
+
+#endif /* defined(__Eighty_Sixer__ESdecoder__) */
@@ -0,0 +1,223 @@
+//
+//  ESdevices.c
+//  Eighty-Sixer
+//
+//  Created by agent on 10/19/26.
+//  Copyright (c) 2026 agent. All rights reserved.
+//
+
+#include "ESdevices.h"
+#include "main.h"
+#include <unistd.h>
+
+/*  The memory mapped devices: a console and a step counter, in the top page of the guest address space. rmmovl
+    and mrmovl send anything in that page here instead of to memory.
+
+    Console output collects in a buffer and goes out in one write when it fills up, when the guest waits for
+    input, and when the run ends, rather than a system call per character.
+
+    Devices have to replay like everything else, for the debugger's time travel. Every byte of input is kept, so
+    reading the same step again gets the same byte; output the guest already produced is not written twice.
+    Each of the --runs starts over with the same input. Only input read from the host for the first time goes
+    to a --record log, or comes from a --replay one.
+ */
+
+uint8_t consoleBuffer[CONSOLE_BUFFER_SIZE];
+int consoleBuffered = 0;
+
+DeviceState devices;
+int64_t consoleEmitted = 0;             // output bytes that reached the buffer, so a replay can tell which are new
+
+uint8_t *inputLog = NULL;               // every byte of input read so far
+int inputLogLength = 0;
+int inputLogCapacity = 0;
+bool inputEnded = false;
+
+
+/**
+ *  Writes whatever console output is buffered to standard output. Anything printf() has buffered goes first,
+ *  so the two come out in the order they were produced.
+ */
+void flushConsole(){
+    if (!consoleBuffered) return;
+
+    fflush(stdout);
+
+    for (int written = 0; written < consoleBuffered; ) {
+        ssize_t count = write(STDOUT_FILENO, consoleBuffer + written, consoleBuffered - written);
+        if (count <= 0) break;                  // nowhere to write it, and the guest can't do anything about that
+        written += (int)count;
+    }
+
+    consoleBuffered = 0;
+}
+
+
+/**
+ *  Adds one byte of guest output, unless it's a byte a replay already wrote.
+ */
+void consoleWrite(uint8_t byte){
+    if (devices.consoleWritten++ < consoleEmitted) return;
+    consoleEmitted = devices.consoleWritten;
+
+    if (consoleBuffered == CONSOLE_BUFFER_SIZE) flushConsole();
+    consoleBuffer[consoleBuffered++] = byte;
+}
+
+
+/**
+ *  The next byte of input for the guest, from the log if it was read before.
+ *
+ *  @return the byte, or -1 at the end of the input
+ */
+int consoleRead(){
+    if (devices.inputPosition < inputLogLength) return inputLog[devices.inputPosition++];
+    if (inputEnded) return -1;
+
+    flushConsole();                             // the guest may be waiting on a prompt it just wrote
+    fflush(stdout);
+
+    int character = replayPath ? replayInput() : getchar();
+    if (recordPath) recordInput(character);
+
+    if (character == EOF) {
+        inputEnded = true;
+        return -1;
+    }
+
+    if (inputLogLength == inputLogCapacity) {
+        int capacity = inputLogCapacity ? inputLogCapacity * 2 : 4096;
+        uint8_t *grown = realloc(inputLog, capacity);
+        if (!grown) return -1;
+
+        inputLog = grown;
+        inputLogCapacity = capacity;
+    }
+
+    inputLog[inputLogLength++] = (uint8_t)character;
+    devices.inputPosition = inputLogLength;
+
+    return character;
+}
+
+
+/**
+ *  Stores a word to a device register.
+ *
+ *  @param offset the register's offset into the device window
+ *  @param word   what the guest stored, sign extended
+ *
+ *  @return FALSE if there's no register there to store to, which faults ADR like any bad address
+ */
+bool deviceStore(int offset, int64_t word){
+    char digits[24];
+
+    guestEffects++;
+
+    switch (offset) {
+        case DEVICE_CONSOLE_OUT:
+            consoleWrite((uint8_t)word);
+            return true;
+
+        case DEVICE_CONSOLE_NUMBER: {
+            int length = snprintf(digits, sizeof(digits), "%lld", (long long)word);
+            for (int i = 0; i < length; i++) consoleWrite((uint8_t)digits[i]);
+            return true;
+        }
+
+        default:
+            return false;
+    }
+}
+
+
+/**
+ *  Loads a word from a device register.
+ *
+ *  @param offset the register's offset into the device window
+ *  @param word   set to the value
+ *
+ *  @return FALSE if there's no register there to load from
+ */
+bool deviceLoad(int offset, int64_t *word){
+    guestEffects++;
+
+    switch (offset) {
+        case DEVICE_CONSOLE_IN:
+            *word = consoleRead();
+            return true;
+
+        case DEVICE_STEPS:
+            *word = (uint32_t)stepCount;
+            return true;
+
+        default:
+            return false;
+    }
+}
+
+
+/**
+ *  Starts a new run: no output yet, and the input from the beginning again.
+ */
+void resetDevices(){
+    flushConsole();
+
+    devices.consoleWritten = 0;
+    devices.inputPosition  = 0;
+    consoleEmitted = 0;
+}
+
+
+void saveDeviceState(DeviceState *state){
+    *state = devices;
+}
+
+
+/**
+ *  Puts the devices back as they were at a snapshot. Output since then is not taken back; it's only skipped when
+ *  the guest produces it again.
+ */
+void restoreDeviceState(const DeviceState *state){
+    devices = *state;
+}
+
+
+/**
+ *  The input read from the host so far, for a checkpoint.
+ *
+ *  @param bytes set to the bytes, which stay the devices'
+ *  @param ended set if the input has run out
+ *
+ *  @return how many
+ */
+int consoleInputRead(const uint8_t **bytes, bool *ended){
+    *bytes = inputLog;
+    *ended = inputEnded;
+
+    return inputLogLength;
+}
+
+
+/**
+ *  Takes up the input where a checkpoint left it. The guest may read back as far as the checkpoint's first byte,
+ *  and anything past its last comes from this process's standard input.
+ *
+ *  @return FALSE if there isn't the memory for it
+ */
+bool restoreConsoleInput(const uint8_t *bytes, int length, bool ended){
+    free(inputLog);
+    inputLog = NULL;
+    inputLogLength = inputLogCapacity = 0;
+    inputEnded = ended;
+
+    if (!length) return true;
+
+    inputLog = malloc(length);
+    if (!inputLog) return false;
+
+    memcpy(inputLog, bytes, length);
+    inputLogLength = inputLogCapacity = length;
+
+    return true;
+}
@@ -0,0 +1,54 @@
+//
+//  ESdevices.h
+//  Eighty-Sixer
+//
+//  Created by agent on 10/19/26.
+//  Copyright (c) 2026 agent. All rights reserved.
+//
+
+#ifndef __Eighty_Sixer__ESdevices__
+#define __Eighty_Sixer__ESdevices__
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/*  DEVICE REGISTERS, at offsets into the top page of the guest address space (0xFFFFF000 for Y86, the same page
+    sign extended for Y86-64). Registers are a word wide, and 8 bytes apart so the offsets are the same at either width.
+
+    0x00  console out      store: writes the low byte to standard output
+    0x08  console in       load:  the next byte of standard input after the program, -1 once there is none
+    0x10  console number   store: writes the word in decimal
+    0x18  steps            load:  the instructions run so far, this one included
+ */
+#define DEVICE_WINDOW           4096
+#define DEVICE_BASE             (-DEVICE_WINDOW)
+
+#define DEVICE_CONSOLE_OUT      0x00
+#define DEVICE_CONSOLE_IN       0x08
+#define DEVICE_CONSOLE_NUMBER   0x10
+#define DEVICE_STEPS            0x18
+
+#define CONSOLE_BUFFER_SIZE     65536       // output goes to the host in writes this big, or at the end of the run
+
+#define IN_DEVICE_WINDOW(address)   ((address) < 0 && (address) >= DEVICE_BASE)     // RAM addresses are never negative
+
+typedef struct DeviceState {
+    int64_t consoleWritten;             // output bytes the guest has produced this run
+    int     inputPosition;              // how far into the input log the guest has read
+} DeviceState;
+
+extern DeviceState devices;
+
+bool deviceStore(int, int64_t);
+bool deviceLoad(int, int64_t*);
+void flushConsole();
+
+void resetDevices();
+void saveDeviceState(DeviceState*);
+void restoreDeviceState(const DeviceState*);
+
+int  consoleInputRead(const uint8_t**, bool*);
+bool restoreConsoleInput(const uint8_t*, int, bool);
+
+#endif /* defined(__Eighty_Sixer__ESdevices__) */
@@ -0,0 +1,543 @@
+//
+//  ESfiles.c
+//  Eighty-Sixer
+//
+//  Created by agent on 10/19/26.
+//  Copyright (c) 2026 agent. All rights reserved.
+//
+
+#define _GNU_SOURCE                             // openat(), pread() and friends under -std=c99
+#include "ESfiles.h"
+#include "main.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#ifdef __linux__
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#include <linux/openat2.h>
+#endif
+
+/*  Host files for guest programs, through the trap instruction (F1, with --files DIR). Only files under the
+    sandbox directory can be opened, and reads and writes go straight between guest memory and the file, so a
+    bulk transfer is one host request however big it is.
+
+    Every read and write is a request submitted to the host: to an io_uring where the kernel has one, otherwise
+    to a few worker threads. TRAP_READ and TRAP_WRITE submit and wait; TRAP_SUBMIT_READ and TRAP_SUBMIT_WRITE
+    hand back a ticket straight away, so a program can work on one buffer while the next one is read into
+    another, and TRAP_WAIT collects the result. A buffer belongs to the host until its ticket is waited for.
+ */
+
+const char *fileSandboxPath = NULL;             // see --files
+int sandboxDirectory = -1;
+
+GuestFile   guestFiles[GUEST_FILES];
+FileRequest fileRequests[FILE_REQUESTS];        // a ticket is an index in here, plus one
+
+bool filesReady = false;
+
+
+/** IO_URING **/
+
+#ifdef __linux__
+
+int ringDescriptor = -1;
+unsigned int *ringSubmitHead, *ringSubmitTail, *ringSubmitMask, *ringSubmitArray;
+unsigned int *ringCompleteHead, *ringCompleteTail, *ringCompleteMask;
+struct io_uring_sqe *ringEntries;
+struct io_uring_cqe *ringCompletions;
+
+
+/**
+ *  Sets up an io_uring with the raw system calls, so there's nothing to link against.
+ *
+ *  @return FALSE if the kernel has none, or won't let us have one
+ */
+bool setupRing(){
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+
+    ringDescriptor = (int)syscall(__NR_io_uring_setup, FILE_REQUESTS, &params);
+    if (ringDescriptor < 0) return false;
+
+    size_t submitSize   = params.sq_off.array + params.sq_entries * sizeof(unsigned int);
+    size_t completeSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {             // both rings share one mapping
+        if (completeSize > submitSize) submitSize = completeSize;
+        completeSize = submitSize;
+    }
+
+    uint8_t *submitRing = mmap(NULL, submitSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringDescriptor, IORING_OFF_SQ_RING);
+    uint8_t *completeRing = submitRing;
+
+    if (submitRing != MAP_FAILED && !(params.features & IORING_FEAT_SINGLE_MMAP)) {
+        completeRing = mmap(NULL, completeSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringDescriptor, IORING_OFF_CQ_RING);
+    }
+
+    ringEntries = mmap(NULL, params.sq_entries * sizeof(struct io_uring_sqe), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                       ringDescriptor, IORING_OFF_SQES);
+
+    if (submitRing == MAP_FAILED || completeRing == MAP_FAILED || ringEntries == MAP_FAILED) {
+        close(ringDescriptor);                  // the mappings go with it
+        ringDescriptor = -1;
+        return false;
+    }
+
+    ringSubmitHead   = (unsigned int *)(submitRing + params.sq_off.head);
+    ringSubmitTail   = (unsigned int *)(submitRing + params.sq_off.tail);
+    ringSubmitMask   = (unsigned int *)(submitRing + params.sq_off.ring_mask);
+    ringSubmitArray  = (unsigned int *)(submitRing + params.sq_off.array);
+    ringCompleteHead = (unsigned int *)(completeRing + params.cq_off.head);
+    ringCompleteTail = (unsigned int *)(completeRing + params.cq_off.tail);
+    ringCompleteMask = (unsigned int *)(completeRing + params.cq_off.ring_mask);
+    ringCompletions  = (struct io_uring_cqe *)(completeRing + params.cq_off.cqes);
+
+    return true;
+}
+
+
+/**
+ *  Puts a request on the submission ring and has the kernel take it. If the kernel doesn't take it, it comes off
+ *  the ring again, so a later submission can't carry it in for a ticket that has been freed since.
+ *
+ *  @return FALSE if the request isn't in flight
+ */
+bool submitToRing(int ticket){
+    FileRequest *request = &fileRequests[ticket];
+
+    unsigned int tail  = *ringSubmitTail;
+    unsigned int index = tail & *ringSubmitMask;
+    struct io_uring_sqe *entry = &ringEntries[index];
+
+    memset(entry, 0, sizeof(*entry));
+    entry->opcode    = request->writing ? IORING_OP_WRITEV : IORING_OP_READV;
+    entry->fd        = request->descriptor;
+    entry->addr      = (uint64_t)(uintptr_t)&request->vector;
+    entry->len       = 1;
+    entry->off       = (uint64_t)request->offset;
+    entry->user_data = (uint64_t)ticket;
+
+    ringSubmitArray[index] = index;
+    __atomic_store_n(ringSubmitTail, tail + 1, __ATOMIC_RELEASE);
+
+    if (syscall(__NR_io_uring_enter, ringDescriptor, 1, 0, 0, NULL, 0) == 1) return true;
+
+    if (__atomic_load_n(ringSubmitHead, __ATOMIC_ACQUIRE) == tail + 1) return true;    // taken after all, its completion will come
+
+    __atomic_store_n(ringSubmitTail, tail, __ATOMIC_RELEASE);         // nothing but us moves the tail, and only enter reads it
+    return false;
+}
+
+
+/**
+ *  Collects every completion the ring has, waiting for one first if there are none.
+ */
+void reapRing(){
+    unsigned int head = *ringCompleteHead;
+
+    if (head == __atomic_load_n(ringCompleteTail, __ATOMIC_ACQUIRE)) {
+        syscall(__NR_io_uring_enter, ringDescriptor, 0, 1, IORING_ENTER_GETEVENTS, NULL, 0);
+    }
+
+    while (head != __atomic_load_n(ringCompleteTail, __ATOMIC_ACQUIRE)) {
+        struct io_uring_cqe *completion = &ringCompletions[head & *ringCompleteMask];
+        FileRequest *request = &fileRequests[completion->user_data];
+
+        request->result = completion->res;
+        request->done   = true;
+
+        head++;
+    }
+
+    __atomic_store_n(ringCompleteHead, head, __ATOMIC_RELEASE);
+}
+
+#endif
+
+
+/** THE WORKER THREADS **/
+
+pthread_t       fileWorkers[FILE_WORKERS];
+pthread_mutex_t fileLock         = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t  fileWorkReady    = PTHREAD_COND_INITIALIZER;
+pthread_cond_t  fileWorkFinished = PTHREAD_COND_INITIALIZER;
+
+int fileQueue[FILE_REQUESTS];                   // tickets waiting for a worker, oldest first
+int fileQueueHead = 0;
+int fileQueueLength = 0;
+
+
+void *fileWorker(void *unused){
+    (void)unused;
+
+    pthread_mutex_lock(&fileLock);
+
+    for (;;) {
+        while (!fileQueueLength) pthread_cond_wait(&fileWorkReady, &fileLock);
+
+        FileRequest *request = &fileRequests[fileQueue[fileQueueHead]];
+        fileQueueHead = (fileQueueHead + 1) % FILE_REQUESTS;
+        fileQueueLength--;
+
+        pthread_mutex_unlock(&fileLock);
+
+        ssize_t result = request->writing
+            ? pwrite(request->descriptor, request->vector.iov_base, request->vector.iov_len, request->offset)
+            : pread(request->descriptor, request->vector.iov_base, request->vector.iov_len, request->offset);
+
+        pthread_mutex_lock(&fileLock);
+
+        request->result = result < 0 ? -errno : result;
+        request->done   = true;
+        pthread_cond_broadcast(&fileWorkFinished);
+    }
+
+    return NULL;
+}
+
+
+bool startWorkers(){
+    for (int i = 0; i < FILE_WORKERS; i++) {
+        if (pthread_create(&fileWorkers[i], NULL, fileWorker, NULL) != 0) return i > 0;
+        pthread_detach(fileWorkers[i]);
+    }
+
+    return true;
+}
+
+
+/** REQUESTS **/
+
+/**
+ *  Sends a filled in request to whichever backend we have.
+ */
+bool submitRequest(int ticket){
+#ifdef __linux__
+    if (ringDescriptor >= 0) return submitToRing(ticket);
+#endif
+
+    pthread_mutex_lock(&fileLock);
+    fileQueue[(fileQueueHead + fileQueueLength) % FILE_REQUESTS] = ticket;
+    fileQueueLength++;
+    pthread_cond_signal(&fileWorkReady);
+    pthread_mutex_unlock(&fileLock);
+
+    return true;
+}
+
+
+/**
+ *  Waits for a request to finish and frees its ticket.
+ *
+ *  @return its result
+ */
+int64_t waitForRequest(int ticket){
+    FileRequest *request = &fileRequests[ticket];
+
+#ifdef __linux__
+    if (ringDescriptor >= 0) {
+        while (!request->done) reapRing();
+    } else
+#endif
+    {
+        pthread_mutex_lock(&fileLock);
+        while (!request->done) pthread_cond_wait(&fileWorkFinished, &fileLock);
+        pthread_mutex_unlock(&fileLock);
+    }
+
+    request->busy = false;
+    return request->result;
+}
+
+
+/**
+ *  Waits for a request the guest is collecting, and gives the bytes a read brought in to a --record log.
+ *
+ *  @return its result
+ */
+int64_t collectRequest(int ticket){
+    FileRequest *request = &fileRequests[ticket];
+    int64_t result = waitForRequest(ticket);
+
+    if (recordPath && !request->writing && result > 0) {
+        recordFileData((uint8_t *)request->vector.iov_base - sandboxFloor, request->vector.iov_base, result);
+    }
+
+    return result;
+}
+
+
+/**
+ *  Checks a guest buffer and starts reading into it or writing it out. Reads may only land above the program,
+ *  even with --writable-code, since the host fills the buffer in later; writes may come from anywhere in the sandbox.
+ *
+ *  @return the ticket, or minus an errno
+ */
+int64_t submitTransfer(bool writing, int64_t file, int64_t address, int64_t count){
+    if (file < 0 || file >= GUEST_FILES || guestFiles[file].descriptor < 0) return -EBADF;
+    if (count < 0 || address < 0 || address + count > requestedSize) return -EFAULT;
+    if (!writing && count && address <= lastInstructionByte - sandboxFloor) return -EFAULT;     // the last byte is code too
+
+    int ticket = 0;
+    while (ticket < FILE_REQUESTS && fileRequests[ticket].busy) ticket++;
+    if (ticket == FILE_REQUESTS) return -EAGAIN;
+
+    if (!writing) markBlockDirty((int)address, (int)count);         // before the host writes it, as if the guest had
+
+    FileRequest *request = &fileRequests[ticket];
+    request->busy       = true;
+    request->done       = false;
+    request->writing    = writing;
+    request->descriptor = guestFiles[file].descriptor;
+    request->offset     = guestFiles[file].offset;
+    request->vector.iov_base = sandboxFloor + address;
+    request->vector.iov_len  = (size_t)count;
+
+    guestFiles[file].offset += count;                               // the next one carries on from here
+
+    if (!submitRequest(ticket)) {
+        request->busy = false;
+        guestFiles[file].offset -= count;
+        return -EIO;
+    }
+
+    return ticket;
+}
+
+
+/** FILES **/
+
+/**
+ *  Opens the directory guest programs get to see. Call once, before anything runs.
+ *
+ *  @param path the sandbox directory
+ *
+ *  @return FALSE if it isn't a directory we can open
+ */
+bool openFileSandbox(const char *path){
+    sandboxDirectory = open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (sandboxDirectory < 0) return false;
+
+    for (int i = 0; i < GUEST_FILES; i++) guestFiles[i].descriptor = -1;
+
+    return true;
+}
+
+
+/**
+ *  Picks the backend, the first time a program asks for a file.
+ */
+bool startFiles(){
+    if (filesReady) return true;
+
+#ifdef __linux__
+    if (setupRing()) {
+        if (verbose) printf("\nGuest file I/O through io_uring.\n");
+        filesReady = true;
+        return true;
+    }
+#endif
+
+    if (!startWorkers()) return false;
+
+    if (verbose) printf("\nGuest file I/O through %d worker threads.\n", FILE_WORKERS);
+    filesReady = true;
+    return true;
+}
+
+
+/**
+ *  Opens a path under the sandbox directory a component at a time, where the kernel can't be asked to keep the
+ *  lookup beneath it. O_NOFOLLOW only covers the last component of a path, so each directory on the way is
+ *  opened on its own with it too, and no symbolic link is followed anywhere, not even one that stays inside.
+ *
+ *  @param path  the relative path, cut up in place
+ *  @param flags how to open the file at the end of it
+ *
+ *  @return the descriptor, or -errno
+ */
+int openBeneath(char *path, int flags){
+    int directory = sandboxDirectory;
+    char *part = path;
+
+    for (char *slash = strchr(part, '/'); slash; slash = strchr(part, '/')) {
+        *slash = '\0';
+
+        int next = openat(directory, part, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+        int error = errno;
+
+        if (directory != sandboxDirectory) close(directory);
+        if (next < 0) return -error;
+
+        directory = next;
+        part = slash + 1;
+    }
+
+    int descriptor = openat(directory, part, flags | O_NOFOLLOW | O_CLOEXEC, 0644);
+    int error = errno;
+
+    if (directory != sandboxDirectory) close(directory);
+    return descriptor < 0 ? -error : descriptor;
+}
+
+
+/**
+ *  Opens a file under the sandbox directory. The path is a relative one, with no .. in it; on Linux the kernel
+ *  makes sure symbolic links don't lead out of the sandbox either, and without openat2() none are followed.
+ */
+int64_t openGuestFile(int64_t address, int64_t mode){
+    char path[FILE_PATH_MAX];
+    int length = 0;
+
+    if (address < 0) return -EFAULT;
+
+    while (length < FILE_PATH_MAX) {
+        if (address + length >= requestedSize) return -EFAULT;
+        path[length] = (char)sandboxFloor[address + length];
+        if (!path[length]) break;
+        length++;
+    }
+
+    if (length == FILE_PATH_MAX) return -ENAMETOOLONG;
+    if (!length || path[0] == '/') return -EACCES;
+
+    for (char *part = path; part; part = strchr(part, '/') ? strchr(part, '/') + 1 : NULL) {
+        if (part[0] == '.' && part[1] == '.' && (part[2] == '/' || part[2] == '\0')) return -EACCES;
+    }
+
+    int flags;
+    switch (mode) {
+        case FILE_READ:     flags = O_RDONLY; break;
+        case FILE_WRITE:    flags = O_WRONLY | O_CREAT | O_TRUNC; break;
+        case FILE_APPEND:   flags = O_WRONLY | O_CREAT; break;
+
+        default:
+            return -EINVAL;
+    }
+
+    int file = 0;
+    while (file < GUEST_FILES && guestFiles[file].descriptor >= 0) file++;
+    if (file == GUEST_FILES) return -EMFILE;
+
+    int descriptor = -1;
+
+#ifdef __linux__
+    struct open_how how;
+    memset(&how, 0, sizeof(how));
+    how.flags   = flags | O_CLOEXEC;
+    how.mode    = (flags & O_CREAT) ? 0644 : 0;        // openat2() won't take a mode it has no use for
+    how.resolve = RESOLVE_BENEATH | RESOLVE_NO_MAGICLINKS;
+
+    descriptor = (int)syscall(__NR_openat2, sandboxDirectory, path, &how, sizeof(how));
+    if (descriptor < 0 && errno != ENOSYS) return -errno;
+#endif
+
+    if (descriptor < 0) {
+        descriptor = openBeneath(path, flags);
+        if (descriptor < 0) return descriptor;
+    }
+
+    guestFiles[file].descriptor = descriptor;
+    guestFiles[file].offset     = 0;
+
+    if (mode == FILE_APPEND) {
+        off_t end = lseek(descriptor, 0, SEEK_END);
+        guestFiles[file].offset = end < 0 ? 0 : end;
+    }
+
+    return file;
+}
+
+
+/**
+ *  Closes a guest file, once everything in flight on it is done.
+ */
+int64_t closeGuestFile(int64_t file){
+    if (file < 0 || file >= GUEST_FILES || guestFiles[file].descriptor < 0) return -EBADF;
+
+    for (int ticket = 0; ticket < FILE_REQUESTS; ticket++) {
+        if (fileRequests[ticket].busy && fileRequests[ticket].descriptor == guestFiles[file].descriptor) collectRequest(ticket);
+    }
+
+    close(guestFiles[file].descriptor);
+    guestFiles[file].descriptor = -1;
+
+    return 0;
+}
+
+
+/**
+ *  Closes every file the run left open, after waiting for whatever it still had in flight. The next run
+ *  starts with none.
+ */
+void closeGuestFiles(){
+    for (int ticket = 0; ticket < FILE_REQUESTS; ticket++) {
+        if (fileRequests[ticket].busy) waitForRequest(ticket);
+    }
+
+    for (int file = 0; file < GUEST_FILES; file++) {
+        if (guestFiles[file].descriptor >= 0) closeGuestFile(file);
+    }
+}
+
+
+/**
+ *  Does what a trap call asks of the host.
+ */
+int64_t performTrap(int64_t call, int64_t first, int64_t second, int64_t third){
+    if (!startFiles()) return -ENOSYS;
+
+    int64_t ticket;
+
+    switch (call) {
+        case TRAP_OPEN:
+            return openGuestFile(first, second);
+        case TRAP_CLOSE:
+            return closeGuestFile(first);
+
+        case TRAP_READ:
+        case TRAP_WRITE:
+            ticket = submitTransfer(call == TRAP_WRITE, first, second, third);
+            return ticket < 0 ? ticket : collectRequest((int)ticket);
+
+        case TRAP_SUBMIT_READ:
+        case TRAP_SUBMIT_WRITE:
+            ticket = submitTransfer(call == TRAP_SUBMIT_WRITE, first, second, third);
+            return ticket < 0 ? ticket : ticket + 1;
+
+        case TRAP_WAIT:
+            if (first < 1 || first > FILE_REQUESTS || !fileRequests[first - 1].busy) return -EINVAL;
+            return collectRequest((int)first - 1);
+
+        default:
+            return -ENOSYS;
+    }
+}
+
+
+/**
+ *  Does what the trap instruction asks for; see TRAP CALLS in ESfiles.h. A --replay takes the result, and
+ *  whatever reads finished, from the log instead of the host.
+ *
+ *  @param call   %eax
+ *  @param first  %ebx
+ *  @param second %ecx
+ *  @param third  %edx
+ *
+ *  @return the result for %eax
+ */
+int64_t systemTrap(int64_t call, int64_t first, int64_t second, int64_t third){
+    guestEffects++;
+
+    if (replayPath) return replayTrap();
+
+    int64_t result = performTrap(call, first, second, third);
+    if (recordPath) recordTrap(result);
+
+    return result;
+}
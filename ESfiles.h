@@ -0,0 +1,69 @@
+//
+//  ESfiles.h
+//  Eighty-Sixer
+//
+//  Created by agent on 10/19/26.
+//  Copyright (c) 2026 agent. All rights reserved.
+//
+
+#ifndef __Eighty_Sixer__ESfiles__
+#define __Eighty_Sixer__ESfiles__
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+
+#define TRAP_INSTRUCTION    0xF1        // F0 is the debugger's breakpoint
+
+/* TRAP CALLS
+    %eax is the call, %ebx, %ecx and %edx its arguments. The result goes in %eax, minus the host's errno on failure.
+
+    TRAP_OPEN           path address, FILE_ mode          a file number
+    TRAP_CLOSE          file                              0
+    TRAP_READ           file, buffer address, count       the bytes read, 0 at the end of the file
+    TRAP_WRITE          file, buffer address, count       the bytes written
+    TRAP_SUBMIT_READ    file, buffer address, count       a ticket, the read goes on while the program runs
+    TRAP_SUBMIT_WRITE   file, buffer address, count       a ticket
+    TRAP_WAIT           ticket                            what TRAP_READ or TRAP_WRITE would have returned
+ */
+#define TRAP_OPEN           1
+#define TRAP_CLOSE          2
+#define TRAP_READ           3
+#define TRAP_WRITE          4
+#define TRAP_SUBMIT_READ    5
+#define TRAP_SUBMIT_WRITE   6
+#define TRAP_WAIT           7
+
+#define FILE_READ           0
+#define FILE_WRITE          1           // created if need be, and emptied
+#define FILE_APPEND         2           // created if need be
+
+#define GUEST_FILES         16
+#define FILE_REQUESTS       64          // reads and writes in flight at once
+#define FILE_WORKERS        4           // threads for the fallback when there's no io_uring
+#define FILE_PATH_MAX       256
+
+typedef struct GuestFile {
+    int   descriptor;                   // the host's, -1 when the slot is free
+    off_t offset;                       // where the next read or write goes, moved on as each is submitted
+} GuestFile;
+
+typedef struct FileRequest {
+    bool         busy;                  // submitted and not yet waited for
+    bool         done;
+    bool         writing;
+    int          descriptor;
+    off_t        offset;
+    struct iovec vector;                // straight into or out of guest memory
+    int64_t      result;
+} FileRequest;
+
+extern const char *fileSandboxPath;
+
+bool openFileSandbox(const char*);
+int64_t systemTrap(int64_t, int64_t, int64_t, int64_t);
+void closeGuestFiles();
+
+#endif /* defined(__Eighty_Sixer__ESfiles__) */
@@ -0,0 +1,224 @@
+//
+//  EShostCounters.c
+//  Eighty-Sixer
+//
+//  Created by agent on 10/19/26.
+//  Copyright (c) 2026 agent. All rights reserved.
+//
+
+#define _GNU_SOURCE                             // syscall() and clock_gettime() under -std=c99
+#include "EShostCounters.h"
+#include "main.h"
+#include <time.h>
+
+#ifdef __linux__
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+/*  What the interpreter costs the host, by guest instruction, with --host-counters. About one dispatch in
+    hostSamplePeriod has the host's cycle, instruction and branch miss counters read before its fetch and after
+    it runs, and the difference goes to its icode. The gap between samples is drawn at random around the period,
+    so a loop the same length as the period doesn't land every sample on the same instruction.
+
+    The counters come from perf_event_open, user space only, so they work with perf_event_paranoid up to 2. Where
+    there are no hardware counters to be had, in a VM or on another system, the host's monotonic clock stands in
+    for the cycles and the other two go unreported.
+
+    Reading the counters costs far more than most dispatches, so what two reads back to back come to is measured
+    once, up front, and taken off every sample.
+ */
+
+bool hostCounting = false;
+int  hostSamplePeriod = HOST_SAMPLE_PERIOD;
+int  hostSampleCountdown = HOST_SAMPLE_PERIOD;
+bool hostSampleOpen = false;
+
+int  counterGroup = -1;                         // the cycles counter, which leads the other two, or -1 for the clock
+uint32_t sampleSeed = 0x2545F491;
+
+uint64_t sampleStart[HOST_COUNTERS];
+double   readOverhead[HOST_COUNTERS];           // what a sample counts with no dispatch in it
+
+uint64_t icodeSamples[16];
+uint64_t icodeCosts[16][HOST_COUNTERS];
+
+
+#ifdef __linux__
+int openCounter(uint64_t event, int leader){
+    struct perf_event_attr attributes;
+    memset(&attributes, 0, sizeof(attributes));
+
+    attributes.size           = sizeof(attributes);
+    attributes.type           = PERF_TYPE_HARDWARE;
+    attributes.config         = event;
+    attributes.disabled       = leader < 0;         // the leader starts the whole group at once
+    attributes.exclude_kernel = 1;                  // all perf_event_paranoid 2 allows, and the reads aren't ours to count
+    attributes.exclude_hv     = 1;
+    attributes.read_format    = PERF_FORMAT_GROUP;
+
+    return (int)syscall(SYS_perf_event_open, &attributes, 0, -1, leader, 0);
+}
+#endif
+
+
+void readHostCounters(uint64_t *values){
+#ifdef __linux__
+    uint64_t group[1 + HOST_COUNTERS];          // how many, then each counter in the order they were opened
+
+    if (counterGroup >= 0 && read(counterGroup, group, sizeof(group)) == sizeof(group)) {
+        memcpy(values, group + 1, sizeof(uint64_t) * HOST_COUNTERS);
+        return;
+    }
+#endif
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    values[0] = (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+    values[1] = values[2] = 0;
+}
+
+
+int nextSampleGap(){
+    sampleSeed ^= sampleSeed << 13;             // xorshift, the same gaps every time for the same period
+    sampleSeed ^= sampleSeed >> 17;
+    sampleSeed ^= sampleSeed << 5;
+
+    return hostSamplePeriod / 2 + (int)(sampleSeed % (uint32_t)hostSamplePeriod) + 1;
+}
+
+
+/**
+ *  Opens the hardware counters, or settles for the clock, and measures what reading them costs.
+ *
+ *  @return FALSE if the sample period makes no sense
+ */
+bool openHostCounters(){
+    if (hostSamplePeriod < 1) {
+        printf("\n\n--host-counters needs a sample period of at least 1.");
+        return false;
+    }
+
+#ifdef __linux__
+    counterGroup = openCounter(PERF_COUNT_HW_CPU_CYCLES, -1);
+
+    if (counterGroup >= 0) {
+        int instructions  = openCounter(PERF_COUNT_HW_INSTRUCTIONS, counterGroup);
+        int branchMisses  = openCounter(PERF_COUNT_HW_BRANCH_MISSES, counterGroup);
+
+        if (instructions < 0 || branchMisses < 0) {         // all three or the clock, never some of each
+            if (instructions >= 0) close(instructions);
+            if (branchMisses >= 0) close(branchMisses);
+            close(counterGroup);
+            counterGroup = -1;
+        } else {
+            ioctl(counterGroup, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+        }
+    }
+#endif
+
+    if (verbose && counterGroup < 0) printf("\nNo hardware counters, sampling the host clock instead.\n");
+
+    uint64_t before[HOST_COUNTERS], after[HOST_COUNTERS];
+    int rounds = 2000;
+
+    memset(readOverhead, 0, sizeof(readOverhead));
+    for (int i = 0; i < rounds; i++) {
+        readHostCounters(before);
+        readHostCounters(after);
+
+        for (int c = 0; c < HOST_COUNTERS; c++) readOverhead[c] += (double)(after[c] - before[c]) / rounds;
+    }
+
+    return true;
+}
+
+
+/**
+ *  Clears the samples for a new run.
+ */
+void startHostCounters(){
+    memset(icodeSamples, 0, sizeof(icodeSamples));
+    memset(icodeCosts, 0, sizeof(icodeCosts));
+
+    hostSampleOpen = false;                     // the last run may have halted in the middle of one
+    hostSampleCountdown = nextSampleGap();
+}
+
+
+/**
+ *  Called before the fetch of a dispatch that's to be measured.
+ */
+void beginHostSample(){
+    hostSampleOpen = true;
+    hostSampleCountdown = nextSampleGap();
+
+    readHostCounters(sampleStart);
+}
+
+
+/**
+ *  Called once the measured dispatch has run. One that ends the run never gets here, and isn't counted.
+ *
+ *  @param instruction its icode/ifun byte
+ */
+void endHostSample(uint8_t instruction){
+    uint64_t now[HOST_COUNTERS];
+    readHostCounters(now);
+
+    int icode = instruction >> 4;
+    icodeSamples[icode]++;
+    for (int c = 0; c < HOST_COUNTERS; c++) icodeCosts[icode][c] += now[c] - sampleStart[c];
+
+    hostSampleOpen = false;
+}
+
+
+/**
+ *  Prints the host cost of each guest instruction type the run sampled: per dispatch, with the cost of reading
+ *  the counters taken off, and each icode's estimated share of the run's host cycles.
+ */
+void finishHostCounters(){
+    double mean[16][HOST_COUNTERS], total = 0;
+    uint64_t samples = 0;
+
+    for (int icode = 0; icode < 16; icode++) {
+        for (int c = 0; c < HOST_COUNTERS && icodeSamples[icode]; c++) {
+            mean[icode][c] = (double)icodeCosts[icode][c] / icodeSamples[icode] - readOverhead[c];
+            if (mean[icode][c] < 0) mean[icode][c] = 0;
+        }
+
+        if (icodeSamples[icode]) total += mean[icode][0] * icodeSamples[icode];
+        samples += icodeSamples[icode];
+    }
+
+    if (!samples) {
+        printf("\nNo dispatches sampled for host counters, the run was shorter than the sample period.\n");
+        return;
+    }
+
+    bool hardware = counterGroup >= 0;
+    printf("\nHost cost by guest instruction (%s, %llu samples, 1 dispatch in ~%d):\n",
+           hardware ? "perf_event_open" : "host clock", (unsigned long long)samples, hostSamplePeriod);
+
+    if (hardware) {
+        printf("%-8s %10s %8s %14s %14s %14s\n", "icode", "samples", "share", "cycles", "instructions", "branch misses");
+    } else {
+        printf("%-8s %10s %8s %14s\n", "icode", "samples", "share", "nanoseconds");
+    }
+
+    for (int icode = 0; icode < 16; icode++) {
+        if (!icodeSamples[icode]) continue;
+
+        double share = total > 0 ? 100.0 * mean[icode][0] * icodeSamples[icode] / total : 0;
+        printf("%-8s %10llu %7.1f%% %14.1f", icodeNames[icode], (unsigned long long)icodeSamples[icode], share, mean[icode][0]);
+
+        if (hardware) printf(" %14.1f %14.2f", mean[icode][1], mean[icode][2]);
+        printf("\n");
+    }
+
+    printf("Per dispatch, less %.1f %s for reading the counters.\n", readOverhead[0], hardware ? "cycles" : "nanoseconds");
+}
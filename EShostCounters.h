@@ -0,0 +1,30 @@
+//
+//  EShostCounters.h
+//  Eighty-Sixer
+//
+//  Created by agent on 10/19/26.
+//  Copyright (c) 2026 agent. All rights reserved.
+//
+
+#ifndef __Eighty_Sixer__EShostCounters__
+#define __Eighty_Sixer__EShostCounters__
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#define HOST_SAMPLE_PERIOD      4096        // dispatches between samples on average, unless --host-counters says
+#define HOST_COUNTERS           3           // host cycles, instructions and branch misses
+
+extern bool hostCounting;                   // see --host-counters
+extern int  hostSamplePeriod;
+extern int  hostSampleCountdown;            // dispatches until the next sample
+extern bool hostSampleOpen;                 // a dispatch is being measured
+
+bool openHostCounters();
+void startHostCounters();
+void beginHostSample();
+void endHostSample(uint8_t);
+void finishHostCounters();
+
+#endif /* defined(__Eighty_Sixer__EShostCounters__) */
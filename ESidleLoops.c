@@ -0,0 +1,93 @@
+//
+//  ESidleLoops.c
+//  Eighty-Sixer
+//
+//  Created by agent on 10/19/26.
+//  Copyright (c) 2026 agent. All rights reserved.
+//
+
+#include "ESidleLoops.h"
+#include "main.h"
+
+/*  Loops that can never end. A program whose registers, flags and program counter come back to what they were,
+    with nothing stored, no device touched and no trap made in between, will go round that way forever: the next
+    step only depends on those and on memory. Such a run stops with IDLE_LOOP, LOP in the trace, instead of
+    spinning until it's killed.
+
+    Only taken backward jumps look, so straight line code pays nothing, and only one in IDLE_CHECK_INTERVAL of
+    those does more than count down. Each look compares the machine with a snapshot taken at an earlier look, and
+    the snapshot is retaken after twice as many looks each time (Brent's cycle finding), up to IDLE_SPAN_LIMIT. So a
+    cycle of any length up to that is caught within a couple of spans of entering it, and the comparison is of the
+    whole state, never a hash, so a live program is never stopped.
+
+    guestEffects stands for memory and the outside world: everything that stores or reaches a device bumps it.
+    A loop that keeps storing the same word is stuck too, but isn't caught.
+ */
+
+typedef struct IdleSnapshot {
+    int64_t  programCounter;
+    uint64_t effects;
+    int64_t  flags;
+    int64_t  registers[15];
+} IdleSnapshot;
+
+bool checkingIdleLoops = true;
+int  idleCheckCountdown = IDLE_CHECK_INTERVAL;
+uint64_t guestEffects = 0;
+
+IdleSnapshot idleSnapshot;
+bool haveIdleSnapshot = false;
+int  idleSpan = 1;                          // looks between snapshots
+int  idleLooks = 0;                         // since the last one
+
+
+/**
+ *  Forgets the snapshot, for a new run.
+ */
+void resetIdleCheck(){
+    haveIdleSnapshot = false;
+    idleSpan = 1;
+    idleLooks = 0;
+    idleCheckCountdown = IDLE_CHECK_INTERVAL;
+}
+
+
+void takeIdleSnapshot(IdleSnapshot *snapshot){
+    memset(snapshot, 0, sizeof(*snapshot));
+
+    snapshot->programCounter = currentInstructionByte - sandboxFloor;
+    snapshot->effects        = guestEffects;
+    snapshot->flags          = (zeroFlag << 2) | (signFlag << 1) | overflowFlag;
+
+    if (wordBits == 64) {
+        for (int i = 0; i < 15; i++) snapshot->registers[i] = *registerAtIndex64(i);
+    } else {
+        for (int i = 0; i < 8; i++) snapshot->registers[i] = *registerAtIndex(i);
+    }
+}
+
+
+/**
+ *  Looks at the machine just after a backward jump, once the countdown runs out. Stops the run if it's exactly as
+ *  it was at the snapshot.
+ */
+void checkIdleLoop(){
+    IdleSnapshot now;
+    takeIdleSnapshot(&now);
+
+    idleCheckCountdown = IDLE_CHECK_INTERVAL;
+
+    if (haveIdleSnapshot && !memcmp(&now, &idleSnapshot, sizeof(now))) {
+        if (verbose) printf("\nStuck in a loop at 0x%04llX: nothing has changed in %d backward jumps.\n",
+                            (long long)now.programCounter, (idleLooks + 1) * IDLE_CHECK_INTERVAL);
+        quit(IDLE_LOOP);
+    }
+
+    if (!haveIdleSnapshot || ++idleLooks >= idleSpan) {
+        idleSnapshot = now;
+        haveIdleSnapshot = true;
+        idleLooks = 0;
+
+        if (idleSpan < IDLE_SPAN_LIMIT) idleSpan *= 2;
+    }
+}
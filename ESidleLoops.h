@@ -0,0 +1,26 @@
+//
+//  ESidleLoops.h
+//  Eighty-Sixer
+//
+//  Created by agent on 10/19/26.
+//  Copyright (c) 2026 agent. All rights reserved.
+//
+
+#ifndef __Eighty_Sixer__ESidleLoops__
+#define __Eighty_Sixer__ESidleLoops__
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#define IDLE_CHECK_INTERVAL     64          // backward jumps taken between looks at the machine
+#define IDLE_SPAN_LIMIT         1024        // looks a snapshot is kept for at most, the longest cycle that's caught
+
+extern bool checkingIdleLoops;              // on unless --no-idle-check
+extern int  idleCheckCountdown;             // backward jumps until the next look
+extern uint64_t guestEffects;               // stores, device accesses and traps so far
+
+void resetIdleCheck();
+void checkIdleLoop();
+
+#endif /* defined(__Eighty_Sixer__ESidleLoops__) */
@@ -0,0 +1,334 @@
+//
+//  ESimageCache.c
+//  Eighty-Sixer
+//
+//  Created by agent on 10/19/26.
+//  Copyright (c) 2026 agent. All rights reserved.
+//
+
+#include "ESimageCache.h"
+#include "main.h"
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+const char *imageCachePath = NULL;              // the cache directory, see --image-cache
+
+DecodedInstruction *programInstructions = NULL; // by address, from the cache or decoded on first use
+bool *programDecodedAddress = NULL;             // NULL once every address is decoded, as on a cache hit
+ControlFlowGraph programGraph;
+bool programGraphReady = false;
+
+uint64_t inputKey = 0;                          // the key of the last lookup, before loading could change the width
+
+
+/**
+ *  FNV-1a, a word at a time where it can. Every cache hit checks the whole entry with this, so it has to be quick.
+ *
+ *  @param hash   the running hash, 0xCBF29CE484222325 to start
+ *  @param bytes  the bytes to add
+ *  @param length how many there are
+ *
+ *  @return the new hash
+ */
+uint64_t checksumWords(uint64_t hash, const uint8_t *bytes, size_t length){
+    size_t i = 0;
+
+    for (; i + 8 <= length; i += 8) {
+        uint64_t word;
+        memcpy(&word, bytes + i, 8);
+        hash ^= word;
+        hash *= 0x100000001B3ULL;
+        hash ^= hash >> 32;                     // otherwise the top bytes of a word never reach the bottom of the hash
+    }
+
+    for (; i < length; i++) {
+        hash ^= bytes[i];
+        hash *= 0x100000001B3ULL;
+    }
+
+    return hash;
+}
+
+
+/**
+ *  The cache key for some input. The same text decodes differently with other extensions or another word size,
+ *  so those go into the key as well.
+ */
+uint64_t imageCacheKey(const char *text, int length){
+    uint64_t hash = checksumWords(0xCBF29CE484222325ULL, (const uint8_t *)text, length);
+    uint32_t settings[2] = { isaExtensions, (uint32_t)wordBits };
+
+    return checksumWords(hash, (const uint8_t *)settings, sizeof(settings));
+}
+
+
+size_t alignSection(size_t offset){
+    return (offset + 7) & ~(size_t)7;
+}
+
+
+/**
+ *  Works out where each section of an entry starts and how long the whole entry is, from its header.
+ */
+size_t imageCacheLayout(const ImageCacheHeader *header, size_t *image, size_t *instructions, size_t *leaders){
+    *image        = alignSection(sizeof(ImageCacheHeader) + header->textLength);
+    *instructions = alignSection(*image + header->imageLength);
+    *leaders      = *instructions + (header->decoded ? (size_t)header->imageLength * sizeof(DecodedInstruction) : 0);
+
+    return *leaders + (header->decoded ? (size_t)header->imageLength + 1 : 0);
+}
+
+
+void imageCacheEntryPath(char *path, size_t size, uint64_t key){
+    snprintf(path, size, "%s/%016llX%s", imageCachePath, (unsigned long long)key, IMAGE_CACHE_SUFFIX);
+}
+
+
+/**
+ *  Looks the input up in the cache and, if there's a sound entry for it, loads the image straight into the sandbox
+ *  and finishes loading. The decoded instructions and basic blocks stay mapped from the file, so nothing gets parsed
+ *  or decoded. Anything wrong with the entry (another build, a hash collision, a torn or corrupted file) is a miss,
+ *  and the caller rebuilds it.
+ *
+ *  @param text   the program text as read from the input, terminator included
+ *  @param length how many characters there are
+ *
+ *  @return TRUE if the program was loaded from the cache
+ */
+bool loadCachedImage(const char *text, int length){
+    char path[4096];
+    uint64_t key = inputKey = imageCacheKey(text, length);
+    imageCacheEntryPath(path, sizeof(path), key);
+
+    int file = open(path, O_RDONLY);
+    if (file < 0) {
+        if (verbose) printf("\nImage cache miss: %s\n", path);
+        return false;
+    }
+
+    struct stat status;
+    uint8_t *entry = MAP_FAILED;
+    if (fstat(file, &status) == 0 && (size_t)status.st_size >= sizeof(ImageCacheHeader)) {
+        entry = mmap(NULL, status.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, file, 0);      // private, so nothing reaches the file
+    }
+    close(file);
+
+    if (entry == MAP_FAILED) {
+        if (verbose) printf("\nImage cache entry %s is unreadable, rebuilding it.\n", path);
+        return false;
+    }
+
+    const ImageCacheHeader *header = (const ImageCacheHeader *)entry;
+    size_t image, instructions, leaders;
+
+    bool sound = !memcmp(header->magic, IMAGE_CACHE_MAGIC, 8)
+              && header->version == IMAGE_CACHE_VERSION
+              && header->recordSize == sizeof(DecodedInstruction)
+              && header->key == key
+              && header->isaExtensions == isaExtensions
+              && header->textLength == length
+              && header->imageLength >= 0 && header->imageLength <= requestedSize
+              && (header->headerLength == 0 || header->headerLength == IMAGE_HEADER_LENGTH)
+              && imageCacheLayout(header, &image, &instructions, &leaders) == (size_t)status.st_size
+              && checksumWords(0xCBF29CE484222325ULL, entry + sizeof(ImageCacheHeader), status.st_size - sizeof(ImageCacheHeader)) == header->checksum
+              && !memcmp(entry + sizeof(ImageCacheHeader), text, length);
+
+    if (!sound) {
+        if (verbose) printf("\nImage cache entry %s is stale or corrupt, rebuilding it.\n", path);
+        munmap(entry, status.st_size);
+        return false;
+    }
+
+    static const char magic[IMAGE_HEADER_LENGTH] = IMAGE_HEADER_Y86_64;
+
+    bool stored = storeInstructionBlock((const uint8_t *)magic, header->headerLength)       // readImageHeader() takes it off again
+               && storeInstructionBlock(entry + image, header->imageLength);
+
+    if (!stored) {
+        munmap(entry, status.st_size);
+        return false;
+    }
+
+    instructionBytes = header->headerLength + header->imageLength;
+
+    if (!instructionLoadComplete()) {
+        printf("\nFATAL ERROR. Exiting.\n");
+        quit(INSTRUCTION_FAULT);
+    }
+
+    if (verbose) printf("\nImage cache hit: %s, %d bytes.\n", path, header->imageLength);
+
+    if (header->decoded) {                      // the mapping lives as long as we do
+        programInstructions   = (DecodedInstruction *)(entry + instructions);
+        programDecodedAddress = NULL;
+
+        programGraph.imageLength = header->imageLength;
+        programGraph.leader      = (bool *)(entry + leaders);
+        programGraph.blockCount  = header->blockCount;
+        programGraph.hasReturn   = header->hasReturn;
+        programGraphReady = true;
+    } else {
+        munmap(entry, status.st_size);
+    }
+
+    return true;
+}
+
+
+/**
+ *  Writes a cache entry for the program that was just loaded from the given text, after loadCachedImage() missed
+ *  on it. Y86 images get their decoded instructions and basic blocks stored along with them. The entry is written
+ *  next to its final name and renamed into place, so another run reading the cache at the same time never sees
+ *  half of it.
+ *
+ *  @param text   the program text the image was loaded from, terminator included
+ *  @param length how many characters there are
+ *
+ *  @return FALSE if the entry could not be written; the program runs just the same
+ */
+bool storeCachedImage(const char *text, int length){
+    if (!pristineImage) return false;
+
+    if (mkdir(imageCachePath, 0777) != 0 && errno != EEXIST) {
+        if (verbose) printf("\nCould not create the image cache directory %s\n", imageCachePath);
+        return false;
+    }
+
+    ImageCacheHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, IMAGE_CACHE_MAGIC, 8);
+    header.version       = IMAGE_CACHE_VERSION;
+    header.recordSize    = sizeof(DecodedInstruction);
+    header.key           = inputKey;
+    header.isaExtensions = isaExtensions;
+    header.wordBits      = wordBits;
+    header.textLength    = length;
+    header.imageLength   = pristineImageLength;
+    header.headerLength  = imageHeaderLength;
+    header.decoded       = wordBits == 32;
+
+    const ControlFlowGraph *graph = header.decoded ? programControlFlow() : NULL;
+    if (header.decoded && !graph) return false;
+
+    if (graph) {
+        header.blockCount = graph->blockCount;
+        header.hasReturn  = graph->hasReturn;
+    }
+
+    size_t image, instructions, leaders;
+    size_t size = imageCacheLayout(&header, &image, &instructions, &leaders);
+
+    uint8_t *entry = calloc(size, 1);           // calloc, so the padding between sections is zeros
+    if (!entry) return false;
+
+    memcpy(entry + sizeof(header), text, length);
+    memcpy(entry + image, pristineImage, pristineImageLength);
+
+    if (graph) {
+        for (int address = 0; address < pristineImageLength; address++) {
+            const DecodedInstruction *decoded = decodedInstructionAt(address);
+            if (!decoded) {
+                free(entry);
+                return false;
+            }
+
+            memcpy(entry + instructions + address * sizeof(DecodedInstruction), decoded, sizeof(DecodedInstruction));
+        }
+        memcpy(entry + leaders, graph->leader, pristineImageLength + 1);
+    }
+
+    header.checksum = checksumWords(0xCBF29CE484222325ULL, entry + sizeof(header), size - sizeof(header));
+    memcpy(entry, &header, sizeof(header));
+
+    char path[4096], temporaryPath[4096 + 32];
+    imageCacheEntryPath(path, sizeof(path), header.key);
+    snprintf(temporaryPath, sizeof(temporaryPath), "%s.%d.tmp", path, (int)getpid());      // runs may share a cache
+
+    FILE *file = fopen(temporaryPath, "wb");
+    bool written = file && fwrite(entry, 1, size, file) == size;
+    if (file && fclose(file) != 0) written = false;
+    free(entry);
+
+    if (!written || rename(temporaryPath, path) != 0) {
+        remove(temporaryPath);
+        if (verbose) printf("\nCould not write the image cache entry %s\n", path);
+        return false;
+    }
+
+    if (verbose) printf("\nImage cache entry written to %s: %zu bytes.\n", path, size);
+
+    return true;
+}
+
+
+/**
+ *  The decoded instruction at an address of the loaded program. Comes from the cache entry if the program did,
+ *  otherwise each address is decoded from memory the first time anyone asks for it, and again after a store
+ *  changes it; see invalidateDecodedInstructions().
+ *
+ *  @param address an address inside the program image
+ *
+ *  @return the decoded instruction; NULL if there's no image or it's out of memory
+ */
+const DecodedInstruction *decodedInstructionAt(int address){
+    if (!programInstructions) {
+        programInstructions   = calloc(pristineImageLength + 1, sizeof(DecodedInstruction));
+        programDecodedAddress = calloc(pristineImageLength + 1, sizeof(bool));
+
+        if (!programInstructions || !programDecodedAddress) {
+            free(programInstructions);
+            free(programDecodedAddress);
+            programInstructions = NULL;
+            programDecodedAddress = NULL;
+            return NULL;
+        }
+    }
+
+    if (programDecodedAddress && !programDecodedAddress[address]) {
+        decodeInstruction(sandboxFloor, pristineImageLength, address, &programInstructions[address]);
+        programDecodedAddress[address] = true;
+    }
+
+    return &programInstructions[address];
+}
+
+
+/**
+ *  Forgets the decoded instructions overlapping a range of the image that a store changed, see codeWritten(). An
+ *  instruction is six bytes at most, so those starting up to five bytes before the range go too.
+ *
+ *  @param start the first byte that changed
+ *  @param end   just past the last
+ */
+void invalidateDecodedInstructions(int start, int end){
+    if (!programInstructions) return;
+
+    if (!programDecodedAddress) {               // mapped read only from a cache entry, so start over on the heap
+        programInstructions = NULL;
+        return;
+    }
+
+    for (int address = start > 5 ? start - 5 : 0; address < end && address <= pristineImageLength; address++) {
+        programDecodedAddress[address] = false;
+    }
+}
+
+
+/**
+ *  The basic blocks of the loaded program, recovered once and kept; see recoverControlFlow(). They are the blocks
+ *  of the program as loaded, even once --writable-code has changed it.
+ *
+ *  @return the control flow graph, or NULL if it could not be recovered
+ */
+const ControlFlowGraph *programControlFlow(){
+    if (!programGraphReady) {
+        if (!pristineImage || !recoverControlFlow(pristineImage, pristineImageLength, &programGraph)) return NULL;
+        programGraphReady = true;
+    }
+
+    return &programGraph;
+}
@@ -0,0 +1,56 @@
+//
+//  ESimageCache.h
+//  Eighty-Sixer
+//
+//  Created by agent on 10/19/26.
+//  Copyright (c) 2026 agent. All rights reserved.
+//
+
+#ifndef __Eighty_Sixer__ESimageCache__
+#define __Eighty_Sixer__ESimageCache__
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "ESdecoder.h"
+
+#define IMAGE_CACHE_MAGIC       "ES86IMG"   // seven characters and the terminator
+#define IMAGE_CACHE_VERSION     1           // bump whenever the layout below or DecodedInstruction changes
+#define IMAGE_CACHE_SUFFIX      ".img"
+
+/*  One cache entry, mapped straight into memory on a hit. The sections after the header each start on an 8 byte
+    boundary, in this order:
+
+        text          the input exactly as read, so a hash collision can't hand back someone else's program
+        image         the program as it ended up in the sandbox, without the Y86-64 header
+        instructions  a DecodedInstruction for every address in the image, Y86 images only
+        leaders       the basic block table, one bool per address and one past the end, Y86 images only
+
+    Everything is in host byte order; an entry from a different build fails the recordSize check and is rebuilt.
+ */
+typedef struct ImageCacheHeader {
+    char     magic[8];
+    uint32_t version;
+    uint32_t recordSize;            // sizeof(DecodedInstruction) when the entry was written
+    uint64_t key;                   // what the file is named after
+    uint32_t isaExtensions;         // the decoding depends on these, so they're part of the key too
+    int32_t  wordBits;              // the width the image ran at after loading
+    int32_t  textLength;
+    int32_t  imageLength;
+    int32_t  headerLength;          // how many bytes of Y86-64 header the input had in front of the image
+    int32_t  decoded;               // 1 if the instruction and leader tables are present
+    int32_t  blockCount;
+    int32_t  hasReturn;
+    uint64_t checksum;              // over every byte after this header
+} ImageCacheHeader;
+
+extern const char *imageCachePath;
+
+bool loadCachedImage(const char*, int);
+bool storeCachedImage(const char*, int);
+
+const DecodedInstruction *decodedInstructionAt(int);
+void invalidateDecodedInstructions(int, int);
+const ControlFlowGraph *programControlFlow();
+
+#endif /* defined(__Eighty_Sixer__ESimageCache__) */
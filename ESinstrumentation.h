@@ -0,0 +1,137 @@
+//
+//  ESinstrumentation.h
+//  Eighty-Sixer
+//
+//  Created by agent on 10/19/26.
+//  Copyright (c) 2026 agent. All rights reserved.
+//
+
+/*  The hooks ESaluHandlers.inc calls wherever some mode might want to see what the interpreter is doing, defined
+    for the variant being compiled. VARIANT_NAME says which one; its FEATURES_ macro in ESaluVariants.inc says which
+    INSTRUMENT_ bits it has. A hook the variant has tests its mode's flag at run time, the rest expand to nothing,
+    so the plain interpreter has neither the branches nor the calls.
+
+    A new mode needs an INSTRUMENT_ bit in ESalu.h, its work in one of the hooks below, and a variant in
+    ESaluVariants.inc that has it. The handlers stay as they are.
+
+    There is no include guard, for the same reason as ESwordWidth.h.
+ */
+
+#undef VARIANT_FEATURES
+#undef VARIANT
+#undef VARIANT_MNEMONIC
+#undef DIAGNOSTIC
+#undef ON_STEP
+#undef ON_CALL
+#undef ON_RETURN
+#undef ON_PUSH
+#undef ON_STORE
+#undef ON_LOAD
+#undef TRACE_STEP
+#undef COUNT_STEP
+#undef STATS_PUSH
+#undef STATS_STORE
+#undef PROFILE_CALL
+#undef PROFILE_RETURN
+#undef PLUGIN_STEP
+#undef PLUGIN_LOAD
+#undef PLUGIN_STORE
+#undef PLUGIN_PUSH
+#undef PLUGIN_CALL_HOOK
+#undef PLUGIN_RETURN_HOOK
+#undef MEMO_STEP
+#undef MEMO_CALL
+#undef MEMO_RETURN
+#undef BEFORE_DISPATCH
+#undef AFTER_DISPATCH
+#undef FETCH_BYTE
+#undef FETCH_WORD
+#undef JUMP_TO
+
+#define VARIANT_PASTE_(a, b)    a ## b
+#define VARIANT_PASTE(a, b)     VARIANT_PASTE_(a, b)
+
+#define VARIANT_FEATURES        VARIANT_PASTE(FEATURES_, VARIANT_NAME)
+#define VARIANT(name)           VARIANT_PASTE(FOR_WIDTH(name), VARIANT_NAME)     // startCyclePlain, startCycle64Verbose...
+#define VARIANT_MNEMONIC(name)  VARIANT_PASTE(MNEMONIC(name), VARIANT_NAME)      // rrmovlPlain, pushqTrace...
+
+#if VARIANT_FEATURES & INSTRUMENT_VERBOSE       // the running commentary of -v
+#define DIAGNOSTIC(...)                 do { if (verbose) printf(__VA_ARGS__); } while (0)
+#else
+#define DIAGNOSTIC(...)                 ((void)0)
+#endif
+
+#if VARIANT_FEATURES & INSTRUMENT_TRACE
+#define TRACE_STEP(address, instruction) do { if (tracing) traceStep(address, instruction); } while (0)
+#else
+#define TRACE_STEP(address, instruction) ((void)0)
+#endif
+
+#if VARIANT_FEATURES & INSTRUMENT_STATS         // counters only, cheap enough to leave on
+#define COUNT_STEP(instruction)         do { if (collectingStats) instructionCounts[instruction]++; } while (0)
+#define STATS_PUSH()                    do { if (collectingStats && FOR_WIDTH(stackPointer) < lowestStackPointer) stackLowered(FOR_WIDTH(stackPointer) + WORD_BYTES); } while (0)
+#define STATS_STORE(address, length)    do { if (collectingStats && (int64_t)(address) + (length) > dataHighWater) dataHighWater = (int64_t)(address) + (length); } while (0)
+#else
+#define COUNT_STEP(instruction)         ((void)0)
+#define STATS_PUSH()                    ((void)0)
+#define STATS_STORE(address, length)    ((void)0)
+#endif
+
+#if VARIANT_FEATURES & INSTRUMENT_PROFILE       // once a call or return has gone through
+#define PROFILE_CALL(target, returnAddress) do { if (profiling) profileCall(target, returnAddress); } while (0)
+#define PROFILE_RETURN(returnAddress)   do { if (profiling) profileReturn(returnAddress); } while (0)
+#else
+#define PROFILE_CALL(target, returnAddress) ((void)0)
+#define PROFILE_RETURN(returnAddress)   ((void)0)
+#endif
+
+#if VARIANT_FEATURES & INSTRUMENT_PLUGIN        // only the events some plugin subscribed to, see ESplugins.c
+#define PLUGIN_STEP(address, instruction) do { if (pluginEvents & (PLUGIN_INSTRUCTION | PLUGIN_BLOCK)) pluginStep(address, instruction); } while (0)
+#define PLUGIN_LOAD(address, length)    do { if (pluginEvents & PLUGIN_READ) pluginMemoryRead((int64_t)(address), (int)(length)); } while (0)
+#define PLUGIN_STORE(address, length)   do { if (pluginEvents & PLUGIN_WRITE) pluginMemoryWrite((int64_t)(address), (int)(length)); } while (0)
+#define PLUGIN_PUSH()                   PLUGIN_STORE(FOR_WIDTH(stackPointer), WORD_BYTES)
+#define PLUGIN_CALL_HOOK(target, returnAddress) do { if (pluginEvents & PLUGIN_CALL) pluginCall(target, returnAddress); } while (0)
+#define PLUGIN_RETURN_HOOK(returnAddress) do { if (pluginEvents & PLUGIN_RETURN) pluginReturn(returnAddress); } while (0)
+#else
+#define PLUGIN_STEP(address, instruction) ((void)0)
+#define PLUGIN_LOAD(address, length)    ((void)0)
+#define PLUGIN_STORE(address, length)   ((void)0)
+#define PLUGIN_PUSH()                   ((void)0)
+#define PLUGIN_CALL_HOOK(target, returnAddress) ((void)0)
+#define PLUGIN_RETURN_HOOK(returnAddress) ((void)0)
+#endif
+
+#if VARIANT_FEATURES & INSTRUMENT_MEMO          // a call may be skipped, so this one goes after the others
+#define MEMO_STEP(address)              do { if (memoDepth) memoStep(address); } while (0)
+#define MEMO_CALL(target, returnAddress) do { if (memoizing) memoCall(target, returnAddress); } while (0)
+#define MEMO_RETURN(returnAddress)      do { if (memoizing) memoReturn(returnAddress); } while (0)
+#else
+#define MEMO_STEP(address)              ((void)0)
+#define MEMO_CALL(target, returnAddress) ((void)0)
+#define MEMO_RETURN(returnAddress)      ((void)0)
+#endif
+
+#if VARIANT_FEATURES & INSTRUMENT_COUNTERS      // one dispatch in every hostSamplePeriod or so
+#define BEFORE_DISPATCH()               do { if (hostCounting && --hostSampleCountdown <= 0) beginHostSample(); } while (0)
+#define AFTER_DISPATCH(instruction)     do { if (hostSampleOpen) endHostSample(instruction); } while (0)
+#else
+#define BEFORE_DISPATCH()               ((void)0)
+#define AFTER_DISPATCH(instruction)     ((void)0)
+#endif
+
+#define ON_STEP(address, instruction)   do { TRACE_STEP(address, instruction); COUNT_STEP(instruction); PLUGIN_STEP(address, instruction); MEMO_STEP(address); } while (0)     // once per instruction, after the step is counted
+#define ON_PUSH()                       do { STATS_PUSH(); PLUGIN_PUSH(); } while (0)                    // once pushl or call has stored its word
+#define ON_STORE(address, length)       do { STATS_STORE(address, length); PLUGIN_STORE(address, length); } while (0)
+#define ON_LOAD(address, length)        PLUGIN_LOAD(address, length)                                      // memory only, the devices aren't
+#define ON_CALL(target, returnAddress)  do { PROFILE_CALL(target, returnAddress); PLUGIN_CALL_HOOK(target, returnAddress); MEMO_CALL(target, returnAddress); } while (0)
+#define ON_RETURN(returnAddress)        do { PROFILE_RETURN(returnAddress); PLUGIN_RETURN_HOOK(returnAddress); MEMO_RETURN(returnAddress); } while (0)
+
+#if VARIANT_FEATURES & VERIFIED_FETCH           // not instrumentation: the verifier already proved these in bounds
+#define FETCH_BYTE()                    (*currentInstructionByte++)
+#define FETCH_WORD()                    VARIANT(readNextInstructionWord)()
+#define JUMP_TO(address)                (currentInstructionByte = sandboxFloor + (address))
+#else
+#define FETCH_BYTE()                    FOR_WIDTH(readNextInstructionByte)()
+#define FETCH_WORD()                    FOR_WIDTH(readNextInstructionWord)()
+#define JUMP_TO(address)                FOR_WIDTH(jumpToReadAtInternalAddress)(address)
+#endif
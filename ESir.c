@@ -0,0 +1,763 @@
+//
+//  ESir.c
+//  Eighty-Sixer
+//
+//  Created by agent on 10/19/26.
+//  Copyright (c) 2026 agent. All rights reserved.
+//
+
+#include "ESir.h"
+#include "main.h"
+
+/*  The optimizer, for --optimize. Each basic block is lifted the first time the program gets to it into a few
+    register ops, see IROpcode, and a short pipeline of passes runs over them before they ever run:
+
+        propagateConstants()    irmovl immediates go into the ops that use them, OPl on constants is folded
+        foldPushPop()           a pushl straight into a popl becomes one store and a move
+        eliminateDeadFlags()    an OPl whose flags the next OPl overwrites before a jXX or cmovXX looks doesn't set them
+        removeRedundantMoves()  moves to the same register, and writes nothing reads before the next one, go
+
+    Nothing outside a block is assumed, so at the end of one every register and flag is what the interpreter would
+    have left. A block runs on a copy of the registers; the flags and the stores it makes can be put back. Anything
+    that would fault or needs the interpreter's hand, the devices included, rolls the whole block back and steps
+    through it the ordinary way instead, so a fault stops at the same instruction with the same state it always did.
+ */
+
+#define IR_ROLLBACK_LIMIT   64          // a block rolled back this often is left to the interpreter
+
+bool optimizing = false;                // --optimize
+int optimizedBlocks = 0;                // lifted so far
+int optimizedOpsRemoved = 0;            // taken out of them by the passes
+
+IRBlock **irBlocks = NULL;              // by address, the block starting there. NULL until it is first run
+int *irRollbacks = NULL;
+int irBlocksLength = 0;
+IRBlock unliftable;                     // marks an address the interpreter keeps
+
+int undoAddress[IR_BLOCK_INSTRUCTIONS];     // what the stores of the running block overwrote, at most one each
+int undoWord[IR_BLOCK_INSTRUCTIONS];
+
+bool conditionTable[7][8];              // by jXX or cmovXX ifun and packed flags, see packFlags()
+bool conditionTableReady = false;
+
+
+#define REGISTER_BIT(index)     ((index) == IR_NONE ? 0u : 1u << (index))
+#define OPERAND(op)             ((op)->source == IR_NONE ? (op)->operand : registers[(op)->source])
+#define PACK_FLAGS(zero, sign, overflow)    ((uint8_t)((zero) | (sign) << 1 | (overflow) << 2))
+#define JUMP_LANDS(target)      ((target) >= 0 && (target) <= imageLast && (target) < registers[4])     // as jumpToReadAtInternalAddress() checks
+#define ADDRESS(op)             ((int)((unsigned)((op)->base == IR_NONE ? 0 : registers[(op)->base]) + (unsigned)(op)->constant))
+
+
+/**
+ *  Works out an OPl the way arithmetic() does, flags and all.
+ *
+ *  @param function the ifun
+ *  @param a        register A's value
+ *  @param b        register B's value, which the result replaces
+ *  @param result   set to the result
+ *  @param overflow set to what the overflow flag becomes
+ *
+ *  @return FALSE if the interpreter would fault INS
+ */
+bool evaluateOperation(uint8_t function, int a, int b, int *result, bool *overflow){
+    switch (function) {
+        case 0:
+            *overflow = (a > 0 && b > INT_MAX - a) || (a < 0 && b < INT_MIN - a);
+            *result = (int)((unsigned)b + (unsigned)a);
+            return true;
+        case 1:
+            *overflow = (a < 0 && b > INT_MAX + a) || (a > 0 && b < INT_MIN + a);
+            *result = (int)((unsigned)b - (unsigned)a);
+            return true;
+        case 2:
+            *overflow = false;
+            *result = b & a;
+            return true;
+        case 3:
+            *overflow = false;
+            *result = b ^ a;
+            return true;
+        case 4:
+        case 5:
+        case 6:
+            return (isaExtensions & EXTENSION_MULDIV) && extendedArithmetic(function, a, b, result, overflow);
+
+        default:
+            return false;
+    }
+}
+
+
+/**
+ *  The three flags in the bits of one byte, zero, sign then overflow, the way a block carries them.
+ */
+uint8_t packFlags(bool zero, bool sign, bool overflow){
+    return PACK_FLAGS(zero, sign, overflow);
+}
+
+
+/**
+ *  Adds an op to the end of a block, with no registers and no constant.
+ */
+IROp *emitOp(IRBlock *block, IROpcode opcode){
+    IROp *op = &block->ops[block->opCount++];
+
+    memset(op, 0, sizeof(IROp));
+    op->opcode = opcode;
+    op->dest   = IR_NONE;
+    op->source = IR_NONE;
+    op->base   = IR_NONE;
+
+    return op;
+}
+
+
+/**
+ *  Lifts the instructions from an address on into ops, up to and including the jXX, call or ret that ends the
+ *  block. It stops short of anything the ops don't cover, halt and the other extensions among them, and of the last
+ *  byte of the image, which stores can change.
+ *
+ *  @param start the address of the first instruction
+ *  @param block filled in
+ *
+ *  @return FALSE if not even the first instruction could be lifted
+ */
+bool liftBlock(int start, IRBlock *block){
+    const ControlFlowGraph *graph = programControlFlow();
+    int address = start;
+
+    block->start = start;
+    block->instructions = 0;
+    block->opCount = 0;
+
+    while (graph && block->instructions < IR_BLOCK_INSTRUCTIONS && address < graph->imageLength) {
+        const DecodedInstruction *decoded = decodedInstructionAt(address);
+        if (!decoded || !decoded->valid || decoded->available < decoded->length) break;
+        if (address + decoded->length >= graph->imageLength) break;
+
+        IROp *op;
+        switch (decoded->icode) {
+            case 0x1:                       // nop
+                break;
+            case 0x2:
+                op = emitOp(block, decoded->ifun ? IR_CMOV : IR_MOVE);
+                op->function = decoded->ifun;
+                op->dest     = decoded->registerB;
+                op->source   = decoded->registerA;
+                break;
+            case 0x3:
+                op = emitOp(block, IR_CONST);
+                op->dest     = decoded->registerB;
+                op->constant = decoded->constant;
+                break;
+            case 0x4:
+                op = emitOp(block, IR_STORE);
+                op->source   = decoded->registerA;
+                op->base     = decoded->registerB;
+                op->constant = decoded->constant;
+                break;
+            case 0x5:
+                op = emitOp(block, IR_LOAD);
+                op->dest     = decoded->registerA;
+                op->base     = decoded->registerB;
+                op->constant = decoded->constant;
+                break;
+            case 0x6:
+                op = emitOp(block, IR_ALU);
+                op->function  = decoded->ifun;
+                op->dest      = decoded->registerB;
+                op->source    = decoded->registerA;
+                op->setsFlags = true;
+                break;
+            case 0x7:
+                op = emitOp(block, IR_BRANCH);
+                op->function = decoded->ifun;
+                op->constant = decoded->constant;
+                break;
+            case 0x8:
+                op = emitOp(block, IR_CALL);
+                op->constant    = decoded->constant;
+                op->guardsStack = true;
+                break;
+            case 0x9:
+                emitOp(block, IR_RETURN);
+                break;
+            case 0xA:
+                op = emitOp(block, IR_PUSH);
+                op->source      = decoded->registerA;
+                op->guardsStack = true;
+                break;
+            case 0xB:
+                op = emitOp(block, IR_POP);
+                op->dest = decoded->registerA;
+                break;
+            case 0xC:                       // iaddl is addl with the immediate for register A
+                op = emitOp(block, IR_ALU);
+                op->dest      = decoded->registerB;
+                op->operand   = decoded->constant;
+                op->setsFlags = true;
+                break;
+            case 0xD:                       // leave
+                op = emitOp(block, IR_MOVE);
+                op->dest   = 4;
+                op->source = 5;
+                op = emitOp(block, IR_POP);
+                op->dest        = 5;
+                op->guardsStack = true;
+                break;
+
+            default:
+                goto lifted;
+        }
+
+        if (block->opCount && block->ops[block->opCount - 1].dest == 4) block->ops[block->opCount - 1].guardsStack = true;
+
+        block->instructions++;
+        address += decoded->length;
+
+        if (endsBasicBlock(decoded)) break;
+    }
+
+lifted:
+    block->end = address;
+
+    return block->instructions > 0;
+}
+
+
+/**
+ *  Which registers an op reads, as a mask by register encoding.
+ */
+unsigned int registersRead(const IROp *op){
+    switch (op->opcode) {
+        case IR_MOVE:
+            return REGISTER_BIT(op->source);
+        case IR_CMOV:
+        case IR_ALU:
+            return REGISTER_BIT(op->source) | REGISTER_BIT(op->dest);
+        case IR_LOAD:
+            return REGISTER_BIT(op->base);
+        case IR_STORE:
+            return REGISTER_BIT(op->base) | REGISTER_BIT(op->source);
+        case IR_PUSH:
+        case IR_SPILL:
+            return REGISTER_BIT(op->source) | REGISTER_BIT(4);
+        case IR_POP:
+        case IR_CALL:
+        case IR_RETURN:
+            return REGISTER_BIT(4);
+
+        default:
+            return 0;
+    }
+}
+
+
+/**
+ *  Which registers an op writes, as a mask by register encoding.
+ */
+unsigned int registersWritten(const IROp *op){
+    switch (op->opcode) {
+        case IR_CONST:
+        case IR_MOVE:
+        case IR_CMOV:
+        case IR_ALU:
+        case IR_LOAD:
+        case IR_SPILL:
+            return REGISTER_BIT(op->dest);
+        case IR_POP:
+            return REGISTER_BIT(op->dest) | REGISTER_BIT(4);
+        case IR_PUSH:
+        case IR_CALL:
+        case IR_RETURN:
+            return REGISTER_BIT(4);
+
+        default:
+            return 0;
+    }
+}
+
+
+/**
+ *  Makes a known register A the op's immediate operand instead.
+ */
+void foldOperand(IROp *op, unsigned int known, const int *values){
+    if (known & REGISTER_BIT(op->source)) {
+        op->operand = values[op->source];
+        op->source  = IR_NONE;
+    }
+}
+
+
+/**
+ *  Adds a known base register into the op's displacement, leaving it an absolute address.
+ */
+void foldBase(IROp *op, unsigned int known, const int *values){
+    if (known & REGISTER_BIT(op->base)) {
+        op->constant = (int)((unsigned)values[op->base] + (unsigned)op->constant);
+        op->base     = IR_NONE;
+    }
+}
+
+
+/**
+ *  Carries the values irmovl gives registers forward through the block. A register that holds a known value stands
+ *  in as an immediate wherever it's read, and an OPl of two known values is worked out now, flags included. %esp is
+ *  never taken as known, since it moves without being named.
+ */
+void propagateConstants(IRBlock *block){
+    unsigned int known = 0;
+    int values[8];
+
+    for (int i = 0; i < block->opCount; i++) {
+        IROp *op = &block->ops[i];
+        int result;
+        bool overflow;
+
+        switch (op->opcode) {
+            case IR_CONST:
+                if (!op->setsFlags && (known & REGISTER_BIT(op->dest)) && values[op->dest] == op->constant) op->opcode = IR_NOP;
+                break;
+            case IR_MOVE:
+                if (known & REGISTER_BIT(op->source)) {
+                    op->opcode   = IR_CONST;
+                    op->constant = values[op->source];
+                    op->source   = IR_NONE;
+                }
+                break;
+            case IR_ALU:
+                if ((op->function == 1 || op->function == 3) && op->source == op->dest) {      // subl or xorl of a register from itself
+                    op->opcode   = IR_CONST;
+                    op->constant = 0;
+                    op->function = packFlags(true, false, false);
+                    op->source   = IR_NONE;
+                    break;
+                }
+
+                foldOperand(op, known, values);
+                if (op->source == IR_NONE && (known & REGISTER_BIT(op->dest)) && op->function <= 4 &&
+                    evaluateOperation(op->function, op->operand, values[op->dest], &result, &overflow)) {
+                    op->opcode   = IR_CONST;
+                    op->constant = result;
+                    op->function = packFlags(result == 0, result < 0, overflow);
+                }
+                break;
+            case IR_CMOV:
+            case IR_PUSH:
+                foldOperand(op, known, values);
+                break;
+            case IR_STORE:
+                foldOperand(op, known, values);
+                foldBase(op, known, values);
+                break;
+            case IR_LOAD:
+                foldBase(op, known, values);
+                break;
+
+            default:
+                break;
+        }
+
+        if (op->opcode == IR_NOP) continue;
+
+        known &= ~registersWritten(op);
+        if (op->opcode == IR_CONST && op->dest != 4) {
+            known |= REGISTER_BIT(op->dest);
+            values[op->dest] = op->constant;
+        }
+    }
+}
+
+
+/**
+ *  Turns a pushl followed by a popl into a single IR_SPILL. The word still goes to the stack, where the interpreter
+ *  would have left it, but %esp never moves and nothing is read back. Pushes or pops of %esp itself are left be.
+ */
+void foldPushPop(IRBlock *block){
+    for (int i = 0; i < block->opCount; i++) {
+        IROp *push = &block->ops[i];
+        if (push->opcode != IR_PUSH || push->source == 4) continue;
+
+        int j = i + 1;
+        while (j < block->opCount && block->ops[j].opcode == IR_NOP) j++;
+        if (j == block->opCount || block->ops[j].opcode != IR_POP || block->ops[j].dest == 4) continue;
+
+        push->opcode = IR_SPILL;
+        push->dest   = block->ops[j].dest;
+        block->ops[j].opcode = IR_NOP;
+    }
+}
+
+
+/**
+ *  Stops an op setting flags that another overwrites before anything looks at them. Whatever the block leaves in
+ *  the flags counts as looked at, since the next block or the trace may.
+ */
+void eliminateDeadFlags(IRBlock *block){
+    bool live = true;
+
+    for (int i = block->opCount - 1; i >= 0; i--) {
+        IROp *op = &block->ops[i];
+
+        if (op->opcode == IR_CMOV || (op->opcode == IR_BRANCH && op->function != 0)) {
+            live = true;
+        } else if (op->setsFlags) {
+            op->setsFlags = live;
+            live = false;
+        }
+    }
+}
+
+
+/**
+ *  Drops moves of a register to itself, and writes to a register that nothing reads before it's written again.
+ *  Only ops that can't fault go, and none that write %esp, which may have to stop the block.
+ */
+void removeRedundantMoves(IRBlock *block){
+    unsigned int live = 0xFF;           // the block leaves every register behind
+
+    for (int i = block->opCount - 1; i >= 0; i--) {
+        IROp *op = &block->ops[i];
+
+        if ((op->opcode == IR_MOVE || op->opcode == IR_CMOV) && op->dest == op->source) op->opcode = IR_NOP;
+        if (op->opcode == IR_NOP) continue;
+
+        bool removable = op->dest != 4 && !op->setsFlags &&
+                         (op->opcode == IR_CONST || op->opcode == IR_MOVE || op->opcode == IR_CMOV || (op->opcode == IR_ALU && op->function <= 4));
+
+        if (removable && !(live & REGISTER_BIT(op->dest))) {
+            op->opcode = IR_NOP;
+            continue;
+        }
+
+        if (op->opcode == IR_SPILL && !(live & REGISTER_BIT(op->dest))) op->dest = IR_NONE;
+
+        live = (live & ~registersWritten(op)) | registersRead(op);
+    }
+}
+
+
+/**
+ *  Runs the passes over a freshly lifted block, then closes up the gaps they left.
+ */
+void optimizeBlock(IRBlock *block){
+    propagateConstants(block);
+    foldPushPop(block);
+    eliminateDeadFlags(block);
+    removeRedundantMoves(block);
+
+    int kept = 0;
+    for (int i = 0; i < block->opCount; i++) {
+        if (block->ops[i].opcode != IR_NOP) block->ops[kept++] = block->ops[i];
+    }
+
+    optimizedOpsRemoved += block->opCount - kept;
+    block->opCount = kept;
+}
+
+
+/**
+ *  The optimized block starting at an address, lifted on the first visit.
+ *
+ *  @return the block, or NULL if the interpreter has to run the instruction there
+ */
+IRBlock *optimizedBlockAt(int address){
+    if (!irBlocks) {
+        const ControlFlowGraph *graph = programControlFlow();
+        if (!graph) return NULL;
+
+        irBlocks    = calloc(graph->imageLength + 1, sizeof(IRBlock *));
+        irRollbacks = calloc(graph->imageLength + 1, sizeof(int));
+        if (!irBlocks || !irRollbacks) {
+            free(irBlocks);
+            free(irRollbacks);
+            irBlocks = NULL;
+            irRollbacks = NULL;
+            optimizing = false;
+            return NULL;
+        }
+
+        irBlocksLength = graph->imageLength;
+    }
+
+    if (address >= irBlocksLength) return NULL;
+
+    if (!irBlocks[address]) {
+        IRBlock *block = malloc(sizeof(IRBlock));
+
+        if (block && liftBlock(address, block)) {
+            optimizeBlock(block);
+            irBlocks[address] = block;
+            optimizedBlocks++;
+        } else {
+            free(block);
+            irBlocks[address] = &unliftable;
+        }
+    }
+
+    return irBlocks[address] == &unliftable ? NULL : irBlocks[address];
+}
+
+
+/**
+ *  Drops the blocks lifted from a range of the image that a store changed, see codeWritten(), to be lifted again
+ *  from the new bytes the next time they run. The addresses the interpreter kept get another chance too. None of
+ *  this happens while blocks run: their stores never reach the image, see runOptimizedBlocks().
+ *
+ *  @param start the first byte that changed
+ *  @param end   just past the last
+ */
+void invalidateOptimizedBlocks(int start, int end){
+    if (!irBlocks) return;
+
+    int reach = IR_BLOCK_INSTRUCTIONS * 6;                  // the most bytes a block can cover
+
+    for (int address = start > reach ? start - reach : 0; address < end && address < irBlocksLength; address++) {
+        IRBlock *block = irBlocks[address];
+        if (!block) continue;
+
+        if (block == &unliftable || block->end > start) {
+            if (block != &unliftable) free(block);
+            irBlocks[address] = NULL;
+            irRollbacks[address] = 0;
+        }
+    }
+}
+
+
+/**
+ *  Fills in conditionTable, for every condition and every setting of the flags.
+ */
+void buildConditionTable(){
+    for (int flags = 0; flags < 8; flags++) {
+        bool zero = flags & 1, less = ((flags >> 1) ^ (flags >> 2)) & 1;        // sign xor overflow
+
+        conditionTable[0][flags] = true;
+        conditionTable[1][flags] = less || zero;
+        conditionTable[2][flags] = less;
+        conditionTable[3][flags] = zero;
+        conditionTable[4][flags] = !zero;
+        conditionTable[5][flags] = !less;
+        conditionTable[6][flags] = !less && !zero;
+    }
+
+    conditionTableReady = true;
+}
+
+
+/**
+ *  Runs blocks one after another from the program counter, for as long as the next one has been lifted and is
+ *  clear of %esp. The registers and flags are worked on in copies until the last one is done, and every word stored
+ *  is logged first, so that anything a block can't do the way the interpreter would can undo that block entirely.
+ *
+ *  @param block    the block at the program counter, whose end is below %esp
+ *  @param chaining FALSE to stop after the one block
+ *
+ *  @return the block that was rolled back, for the interpreter to step through, or NULL if none was
+ */
+IRBlock *runOptimizedBlocks(IRBlock *block, bool chaining){
+    int registers[8], entry[8];
+    memcpy(registers, registerFile, sizeof(registers));
+    registers[4] = stackPointer;
+    registers[5] = framePointer;
+
+    uint8_t flags = packFlags(zeroFlag, signFlag, overflowFlag), entryFlags;
+
+    int memoryLimit = (int)(sandboxCeiling - sandboxFloor) - 4;
+    if (memoryLimit > requestedSize) memoryLimit = requestedSize;
+
+    int stackBottom = (int)(heapPointer - sandboxFloor);
+    int stackTop    = requestedSize - 4;
+    int imageLast   = (int)(lastInstructionByte - sandboxFloor);
+
+    IRBlock *rolledBack = NULL;
+    int steps = 0, next, stores, value, operand, address;
+    bool overflowed, jumped, idleCheckDue = false;
+
+    for (;;) {
+        memcpy(entry, registers, sizeof(entry));
+        entryFlags = flags;
+        next = block->end;
+        stores = 0;
+        jumped = false;
+
+        for (const IROp *op = block->ops; op < block->ops + block->opCount; op++) {
+            switch (op->opcode) {
+                case IR_CONST:
+                    registers[op->dest] = op->constant;
+                    if (op->setsFlags) flags = op->function;
+                    break;
+                case IR_MOVE:
+                    registers[op->dest] = registers[op->source];
+                    break;
+                case IR_CMOV:
+                    if (conditionTable[op->function][flags]) registers[op->dest] = OPERAND(op);
+                    break;
+                case IR_ALU:
+                    operand = OPERAND(op);
+                    value = registers[op->dest];
+
+                    switch (op->function) {         // addl and subl inline, they're most of them
+                        case 0:
+                            overflowed = (operand > 0 && value > INT_MAX - operand) || (operand < 0 && value < INT_MIN - operand);
+                            value = (int)((unsigned)value + (unsigned)operand);
+                            break;
+                        case 1:
+                            overflowed = (operand < 0 && value > INT_MAX + operand) || (operand > 0 && value < INT_MIN + operand);
+                            value = (int)((unsigned)value - (unsigned)operand);
+                            break;
+
+                        default:
+                            if (!evaluateOperation(op->function, operand, value, &value, &overflowed)) goto rollBack;
+                    }
+
+                    registers[op->dest] = value;
+                    if (op->setsFlags) flags = PACK_FLAGS(value == 0, value < 0, overflowed);
+                    break;
+                case IR_LOAD:
+                    address = ADDRESS(op);
+                    if (address < 0 || address > memoryLimit) goto rollBack;       // the devices are below 0
+
+                    registers[op->dest] = *(int *)(sandboxFloor + address);
+                    break;
+                case IR_STORE:
+                    address = ADDRESS(op);
+                    if (address <= imageLast || address > memoryLimit) goto rollBack;
+
+                    value = OPERAND(op);
+                    goto store;
+                case IR_PUSH:
+                case IR_SPILL:
+                case IR_CALL:
+                    address = (int)((unsigned)registers[4] - 4);
+                    if (address < stackBottom || address > stackTop || address < block->end) goto rollBack;
+
+                    value = op->opcode == IR_CALL ? block->end : OPERAND(op);
+                    if (op->opcode != IR_SPILL) registers[4] = address;
+                    else if (op->dest != IR_NONE) registers[op->dest] = value;
+
+                    if (op->opcode == IR_CALL) {
+                        next = op->constant;
+                        if (!JUMP_LANDS(next)) goto rollBack;
+                    }
+                store:
+                    undoAddress[stores] = address;
+                    undoWord[stores++]  = *(int *)(sandboxFloor + address);
+
+                    *(int *)(sandboxFloor + address) = value;
+                    markPageDirty(sandboxFloor + address);
+                    markPageDirty(sandboxFloor + address + 3);
+                    break;
+                case IR_POP:
+                case IR_RETURN:
+                    if (registers[4] < stackBottom || registers[4] > stackTop) goto rollBack;
+
+                    value = *(int *)(sandboxFloor + registers[4]);
+                    registers[4] += 4;
+
+                    if (op->opcode == IR_POP) {
+                        registers[op->dest] = value;
+                    } else {
+                        next = value;
+                        if (!JUMP_LANDS(next)) goto rollBack;
+                    }
+                    break;
+                case IR_BRANCH:
+                    if (conditionTable[op->function][flags]) {
+                        next = op->constant;
+                        jumped = true;
+                        if (!JUMP_LANDS(next)) goto rollBack;
+                    }
+                    break;
+
+                default:
+                    goto rollBack;
+            }
+
+            if (op->guardsStack && registers[4] < block->end) goto rollBack;      // the instructions after it would not fetch
+        }
+
+        steps += block->instructions;
+
+        if (jumped && next < block->end && checkingIdleLoops && --idleCheckCountdown <= 0) {     // the jXX ends the block
+            idleCheckDue = true;
+            break;
+        }
+
+        if (!chaining) break;
+
+        IRBlock *following = next < irBlocksLength ? irBlocks[next] : NULL;
+        if (!following || following == &unliftable || following->end > registers[4]) break;
+
+        block = following;
+        continue;
+
+    rollBack:
+        while (stores--) *(int *)(sandboxFloor + undoAddress[stores]) = undoWord[stores];
+
+        memcpy(registers, entry, sizeof(registers));
+        flags = entryFlags;
+        next = block->start;
+        rolledBack = block;
+        break;
+    }
+
+    for (int i = 0; i < 8; i++) {
+        if (i != 4 && i != 5) registerFile[i] = registers[i];
+    }
+    stackPointer = registers[4];
+    framePointer = registers[5];
+
+    zeroFlag     = flags & 1;
+    signFlag     = (flags >> 1) & 1;
+    overflowFlag = (flags >> 2) & 1;
+
+    stepCount += steps;
+    currentInstructionByte = sandboxFloor + next;
+
+    if (idleCheckDue) checkIdleLoop();          // with the machine as the interpreter would have it after the jump
+
+    return rolledBack;
+}
+
+
+/**
+ *  Runs what it can from the program counter: a run of blocks, or with no block there a single step of the
+ *  interpreter. A block that had to be rolled back is stepped through by the interpreter instead.
+ *
+ *  @param chaining FALSE to run no more than one block, see runOptimizedBlocks()
+ */
+void stepOptimizedProgram(bool chaining){
+    if (!conditionTableReady) buildConditionTable();
+
+    int address = (int)(currentInstructionByte - sandboxFloor);
+    IRBlock *block = optimizedBlockAt(address);
+
+    if (!block || block->end > stackPointer) {
+        startCycle();
+        return;
+    }
+
+    block = runOptimizedBlocks(block, chaining);
+    if (!block) return;
+
+    address = block->start;
+    int instructions = block->instructions;
+    if (++irRollbacks[address] == IR_ROLLBACK_LIMIT) {
+        irBlocks[address] = &unliftable;
+        free(block);
+    }
+
+    for (int i = 0; i < instructions && hasNextInstruction(); i++) startCycle();     // faults where it always did
+}
+
+
+/**
+ *  Runs the program from the current program counter until it finishes, the way runProgram() would, a run of
+ *  blocks at a time.
+ */
+void runOptimizedProgram(){
+    while (hasNextInstruction()) {
+        stepOptimizedProgram(true);
+    }
+}
@@ -0,0 +1,64 @@
+//
+//  ESir.h
+//  Eighty-Sixer
+//
+//  Created by agent on 10/19/26.
+//  Copyright (c) 2026 agent. All rights reserved.
+//
+
+#ifndef __Eighty_Sixer__ESir__
+#define __Eighty_Sixer__ESir__
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#define IR_BLOCK_INSTRUCTIONS   32          // guest instructions lifted into one block at most
+#define IR_BLOCK_OPS            (IR_BLOCK_INSTRUCTIONS * 2)     // leave lifts to two
+#define IR_NONE                 0xF         // no register: the operand is the op's constant instead
+
+typedef enum IROpcode {
+    IR_NOP,             // taken out by a pass, dropped before the block runs
+    IR_CONST,           // dest = constant. Sets the flags packed in function if setsFlags, for a folded OPl
+    IR_MOVE,            // dest = source
+    IR_CMOV,            // if condition function holds, dest = source or operand
+    IR_ALU,             // dest = dest OPl source or operand, function is the OPl's ifun
+    IR_LOAD,            // dest = memory[base + constant]
+    IR_STORE,           // memory[base + constant] = source or operand
+    IR_PUSH,            // source or operand
+    IR_POP,             // dest
+    IR_SPILL,           // a pushl and popl folded together: memory[%esp - 4] = source, dest = source, %esp as it was
+    IR_BRANCH,          // to constant if condition function holds, otherwise on to the end of the block
+    IR_CALL,            // to constant, pushing the end of the block
+    IR_RETURN
+} IROpcode;
+
+typedef struct IROp {
+    uint8_t opcode;
+    uint8_t function;
+    uint8_t dest;
+    uint8_t source;
+    uint8_t base;
+    bool    setsFlags;
+    bool    guardsStack;            // may lower %esp, which has to stay above the rest of the block
+    int     constant;               // immediate, displacement or target
+    int     operand;                // the value used when source is IR_NONE
+} IROp;
+
+typedef struct IRBlock {
+    int   start;                    // guest addresses, end is just past the last instruction
+    int   end;
+    int   instructions;             // how many steps running the block counts for
+    int   opCount;
+    IROp  ops[IR_BLOCK_OPS];
+} IRBlock;
+
+extern bool optimizing;
+extern int  optimizedBlocks;
+extern int  optimizedOpsRemoved;
+
+void invalidateOptimizedBlocks(int, int);
+void stepOptimizedProgram(bool);
+void runOptimizedProgram();
+
+#endif /* defined(__Eighty_Sixer__ESir__) */
@@ -0,0 +1,574 @@
+//
+//  ESlockstep.c
+//  Eighty-Sixer
+//
+//  Created by agent on 10/19/26.
+//  Copyright (c) 2026 agent. All rights reserved.
+//
+
+#include "ESlockstep.h"
+#include "main.h"
+
+/*  Runs of the same program, e.g. a --sweep, executed LOCKSTEP_LANES at a time in lockstep.
+
+    Registers, flags, program counters and step counts are kept structure of arrays, one vector per register
+    with a lane per run, so register moves, conditional moves and arithmetic are a handful of vector operations
+    for every lane at once. Each lane has its own address space from the pool, and memory operations loop over
+    the lanes.
+
+    Every cycle picks the running lane with the deepest stack, and of those the lowest program counter, and runs
+    its instruction masked to every lane at the same program counter. Lanes that branch away wait until the others
+    catch up, which is where they reconverge; going by the stack first means a lane inside a call finishes it
+    before the lanes that skipped the call run on, wherever the function sits in the program. If
+    only one lane gets to run for LOCKSTEP_SCALAR_AFTER cycles in a row the lanes are not coming back together,
+    and whatever is still running is finished on the ordinary interpreter instead. So is a batch that reaches a
+    device register or a trap, which keeps each run's console output and file I/O together and the runs in order.
+
+    The instruction semantics are the interpreter's, faults included, so each run prints the trace it would have.
+ */
+
+typedef int32_t  LaneVector  __attribute__((vector_size(LOCKSTEP_LANES * sizeof(int32_t))));
+typedef uint32_t LaneUnsigned __attribute__((vector_size(LOCKSTEP_LANES * sizeof(uint32_t))));
+
+bool lockstep = false;
+
+LaneVector laneRegisters[8];                // by register encoding, %esp and %ebp included
+LaneVector laneZeroFlag;                    // flags are 0 or -1 so they can be used as masks
+LaneVector laneSignFlag;
+LaneVector laneOverflowFlag;
+LaneVector laneCounter;                     // program counters
+LaneVector laneSteps;
+LaneVector laneRunning;                     // -1 until the lane stops
+
+FaultCode     laneStatus[LOCKSTEP_LANES];
+AddressSpace *laneSpace[LOCKSTEP_LANES];
+int           laneRun[LOCKSTEP_LANES];      // which of the --runs each lane is
+bool          laneOverran[LOCKSTEP_LANES];  // stopped by a fetch or jump out of bounds, which the interpreter reports
+
+
+long lockstepCycles = 0;
+long laneCycles = 0;                        // instructions run summed over lanes, to tell how well the lanes kept together
+
+
+/*  Vectors never cross a function call here: how they are passed depends on which vector extensions the
+    build enables, so the helpers are macros or write through a pointer.
+ */
+#define BLEND_LANES(mask, a, b)     (((a) & (mask)) | ((b) & ~(mask)))     // a's lanes where the mask is set, b's elsewhere
+#define BROADCAST(value)            ((LaneVector){ 0 } + (value))
+
+
+/**
+ *  Works out the lanes where a jump or conditional move condition holds. Same conditions as conditionHolds().
+ *
+ *  @param functionCode the ifun, 0 through 6
+ *  @param condition    set to -1 in the lanes where it holds and 0 elsewhere
+ */
+void laneCondition(uint8_t functionCode, LaneVector *condition){
+    LaneVector lessThan = laneSignFlag ^ laneOverflowFlag;
+
+    switch (functionCode) {
+        case 1:
+            *condition = lessThan | laneZeroFlag;
+            break;
+        case 2:
+            *condition = lessThan;
+            break;
+        case 3:
+            *condition = laneZeroFlag;
+            break;
+        case 4:
+            *condition = ~laneZeroFlag;
+            break;
+        case 5:
+            *condition = ~lessThan;
+            break;
+        case 6:
+            *condition = ~lessThan & ~laneZeroFlag;
+            break;
+
+        default:
+            *condition = BROADCAST(-1);
+            break;
+    }
+}
+
+
+void stopLane(int lane, FaultCode status, int programCounter){
+    laneRunning[lane] = 0;
+    laneStatus[lane]  = status;
+    laneCounter[lane] = programCounter;
+}
+
+
+/**
+ *  Moves a lane to a new program counter, with the checks jumpToReadAtInternalAddress() makes.
+ */
+void jumpLane(int lane, int destination){
+    if (destination >= 0 && destination < pristineImageLength && destination < laneRegisters[4][lane]) {
+        laneCounter[lane] = destination;
+        return;
+    }
+
+    stopLane(lane, ADDRESS_FAULT, destination < 0 || destination > requestedSize ? -1 : destination);
+    laneOverran[lane] = true;
+}
+
+
+/**
+ *  Pushes a word onto a lane's stack, with the bounds pushToStack() checks.
+ *
+ *  @return FALSE if the stack overflowed into the program or out of the sandbox
+ */
+bool pushLane(int lane, int word){
+    int top = laneRegisters[4][lane] - (int)sizeof(int);
+
+    if (laneRegisters[4][lane] < INT_MIN + (int)sizeof(int) || top < pristineImageLength || top > requestedSize - (int)sizeof(int)) return false;
+
+    uint8_t *slot = laneSpace[lane]->floor + top;
+    memcpy(slot, &word, sizeof(int));
+    markPageDirtyIn(laneSpace[lane], slot);
+    markPageDirtyIn(laneSpace[lane], slot + sizeof(int) - 1);
+
+    laneRegisters[4][lane] = top;
+    return true;
+}
+
+
+/**
+ *  Pops a word off a lane's stack, with the bounds popFromStack() checks.
+ *
+ *  @return FALSE if the stack pointer is outside the stack
+ */
+bool popLane(int lane, int *word){
+    int top = laneRegisters[4][lane];
+
+    if (top < pristineImageLength || top > requestedSize - (int)sizeof(int)) return false;
+
+    memcpy(word, laneSpace[lane]->floor + top, sizeof(int));
+    laneRegisters[4][lane] = top + (int)sizeof(int);
+    return true;
+}
+
+
+/**
+ *  Runs mull, divl or modl lane by lane; there are no vector divides, and the overflow of a multiply needs the
+ *  64 bit product. Lanes dividing by zero stop and drop out of the mask.
+ */
+void extendedArithmeticLanes(uint8_t functionCode, LaneVector *mask, LaneVector *regA, LaneVector *regB, int next){
+    for (int lane = 0; lane < LOCKSTEP_LANES; lane++) {
+        int result;
+        bool overflow;
+
+        if (!(*mask)[lane]) continue;
+
+        if (!extendedArithmetic(functionCode, (*regA)[lane], (*regB)[lane], &result, &overflow)) {
+            stopLane(lane, INSTRUCTION_FAULT, next);
+            (*mask)[lane] = 0;
+            continue;
+        }
+
+        laneZeroFlag[lane]     = result == 0 ? -1 : 0;
+        laneSignFlag[lane]     = result < 0 ? -1 : 0;
+        laneOverflowFlag[lane] = overflow ? -1 : 0;
+        (*regB)[lane] = result;
+    }
+}
+
+
+/**
+ *  Runs memcpy or memset for one lane, with the bounds copyMemoryBlock() and fillMemoryBlock() check.
+ *
+ *  @return FALSE if a block is out of bounds
+ */
+bool blockMemoryLane(int lane, uint8_t functionCode){
+    int count       = laneRegisters[1][lane];
+    int source      = laneRegisters[6][lane];
+    int destination = laneRegisters[7][lane];
+    uint8_t *floor  = laneSpace[lane]->floor;
+
+    if (count < 0) return false;
+
+    if (count > 0) {
+        if (destination < pristineImageLength - 1 || (long)destination + count > requestedSize) return false;
+        if (functionCode == 0 && (source < 0 || (long)source + count > requestedSize)) return false;
+
+        for (int page = destination >> GUEST_PAGE_SHIFT; page <= (destination + count - 1) >> GUEST_PAGE_SHIFT; page++) {
+            markPageDirtyIn(laneSpace[lane], floor + ((long)page << GUEST_PAGE_SHIFT));
+        }
+
+        if (functionCode == 0) memmove(floor + destination, floor + source, count);
+        else memset(floor + destination, (uint8_t)laneRegisters[0][lane], count);
+    }
+
+    if (functionCode == 0) laneRegisters[6][lane] = (int)((unsigned int)source + (unsigned int)count);
+
+    laneRegisters[7][lane] = (int)((unsigned int)destination + (unsigned int)count);
+    laneRegisters[1][lane] = 0;
+
+    return true;
+}
+
+
+/**
+ *  Runs one instruction on every lane sitting at the program counter picked to go next.
+ *
+ *  @return the number of lanes that ran it, 0 once every lane has stopped
+ */
+int lockstepCycle(){
+    int programCounter = INT_MAX;
+    int stackPointer = INT_MAX;
+
+    for (int lane = 0; lane < LOCKSTEP_LANES; lane++) {                 // the deepest stack first, then the lowest program counter
+        if (!laneRunning[lane]) continue;
+
+        if (laneRegisters[4][lane] < stackPointer || (laneRegisters[4][lane] == stackPointer && laneCounter[lane] < programCounter)) {
+            stackPointer = laneRegisters[4][lane];
+            programCounter = laneCounter[lane];
+        }
+    }
+
+    if (programCounter == INT_MAX) return 0;
+
+    LaneVector mask = (laneCounter == programCounter) & laneRunning;
+    int lanes = 0;
+
+    if (programCounter >= pristineImageLength) {                    // ran off the end of the program
+        for (int lane = 0; lane < LOCKSTEP_LANES; lane++) {
+            if (mask[lane]) stopLane(lane, HALT, programCounter);
+        }
+        return 1;
+    }
+
+    const DecodedInstruction *decoded = decodedInstructionAt(programCounter);
+    if (!decoded) quit(PROGRAM_ERROR);
+
+    int next = programCounter + decoded->length;
+
+    for (int lane = 0; lane < LOCKSTEP_LANES; lane++) {              // the fetch checks readNextInstructionByte() makes
+        if (!mask[lane]) continue;
+
+        long reached = (long)laneRegisters[4][lane] - programCounter;
+        if (reached > decoded->available) reached = decoded->available;
+
+        if (reached >= decoded->length) {
+            lanes++;
+            continue;
+        }
+
+        if (reached <= 0) {
+            stopLane(lane, HALT, programCounter);
+        } else {
+            laneSteps[lane]++;
+            stopLane(lane, ADDRESS_FAULT, programCounter + (int)reached);
+            laneOverran[lane] = true;
+        }
+
+        mask[lane] = 0;
+    }
+
+    if (!lanes) return 1;
+
+    if (decoded->valid && decoded->icode == 0xF) return 0;         // so are host files
+
+    if (decoded->valid && (decoded->icode == 4 || decoded->icode == 5)) {     // devices are the interpreter's, see finishLane()
+        for (int lane = 0; lane < LOCKSTEP_LANES; lane++) {
+            int address = (int)((unsigned int)laneRegisters[decoded->registerB][lane] + (unsigned int)decoded->constant);
+            if (mask[lane] && IN_DEVICE_WINDOW(address)) return 0;
+        }
+    }
+
+    laneSteps -= mask;                                              // mask lanes are -1
+
+    lockstepCycles++;
+    laneCycles += lanes;
+
+    if (!decoded->valid) {
+        for (int lane = 0; lane < LOCKSTEP_LANES; lane++) {
+            if (mask[lane]) stopLane(lane, INSTRUCTION_FAULT, next);
+        }
+        return lanes;
+    }
+
+    LaneVector *regA = decoded->registerA < 8 ? &laneRegisters[decoded->registerA] : NULL;
+    LaneVector *regB = decoded->registerB < 8 ? &laneRegisters[decoded->registerB] : NULL;
+
+    switch (decoded->icode) {
+        case 0:
+            for (int lane = 0; lane < LOCKSTEP_LANES; lane++) {
+                if (mask[lane]) stopLane(lane, HALT, next);
+            }
+            return lanes;
+        case 1:
+            break;
+        case 2: {
+            LaneVector moving;
+            laneCondition(decoded->ifun, &moving);
+
+            moving &= mask;
+            *regB = BLEND_LANES(moving, *regA, *regB);
+            break;
+        }
+        case 3:
+            *regB = BLEND_LANES(mask, BROADCAST(decoded->constant), *regB);
+            break;
+        case 4:
+            for (int lane = 0; lane < LOCKSTEP_LANES; lane++) {
+                if (!mask[lane]) continue;
+
+                int address = (int)((unsigned int)(*regB)[lane] + (unsigned int)decoded->constant);
+                if (address < pristineImageLength - 1 || address > requestedSize - (int)sizeof(int)) {
+                    stopLane(lane, ADDRESS_FAULT, next);
+                    mask[lane] = 0;
+                    continue;
+                }
+
+                int word = (*regA)[lane];
+                memcpy(laneSpace[lane]->floor + address, &word, sizeof(int));
+                markPageDirtyIn(laneSpace[lane], laneSpace[lane]->floor + address);
+                markPageDirtyIn(laneSpace[lane], laneSpace[lane]->floor + address + sizeof(int) - 1);
+            }
+            break;
+        case 5:
+            for (int lane = 0; lane < LOCKSTEP_LANES; lane++) {
+                if (!mask[lane]) continue;
+
+                int address = (int)((unsigned int)(*regB)[lane] + (unsigned int)decoded->constant);
+                if (address < 0 || address > requestedSize - (int)sizeof(int)) {
+                    stopLane(lane, ADDRESS_FAULT, next);
+                    mask[lane] = 0;
+                    continue;
+                }
+
+                int word;
+                memcpy(&word, laneSpace[lane]->floor + address, sizeof(int));
+                (*regA)[lane] = word;
+            }
+            break;
+        case 6:
+        case 0xC: {
+            if (decoded->icode == 6 && decoded->ifun >= 4) {
+                extendedArithmeticLanes(decoded->ifun, &mask, regA, regB, next);
+                break;
+            }
+
+            LaneVector a = decoded->icode == 0xC ? BROADCAST(decoded->constant) : *regA;          // iaddl adds its immediate
+            LaneVector b = *regB, result, overflow;
+
+            switch (decoded->icode == 0xC ? 0 : decoded->ifun) {
+                case 0:
+                    result = (LaneVector)((LaneUnsigned)b + (LaneUnsigned)a);          // wraps like the hardware would
+                    overflow = (~(a ^ b) & (b ^ result)) < 0;
+                    break;
+                case 1:
+                    result = (LaneVector)((LaneUnsigned)b - (LaneUnsigned)a);
+                    overflow = ((a ^ b) & (b ^ result)) < 0;
+                    break;
+                case 2:
+                    result = b & a;
+                    overflow = result ^ result;
+                    break;
+                default:
+                    result = b ^ a;
+                    overflow = result ^ result;
+                    break;
+            }
+
+            laneZeroFlag     = BLEND_LANES(mask, result == 0, laneZeroFlag);
+            laneSignFlag     = BLEND_LANES(mask, result < 0, laneSignFlag);
+            laneOverflowFlag = BLEND_LANES(mask, overflow, laneOverflowFlag);
+            *regB = BLEND_LANES(mask, result, *regB);
+            break;
+        }
+        case 7: {
+            LaneVector taken;
+            laneCondition(decoded->ifun, &taken);
+
+            taken &= mask;
+
+            laneCounter = BLEND_LANES(mask & ~taken, BROADCAST(next), laneCounter);
+
+            for (int lane = 0; lane < LOCKSTEP_LANES; lane++) {
+                if (taken[lane]) jumpLane(lane, decoded->constant);
+            }
+            return lanes;
+        }
+        case 8:
+            for (int lane = 0; lane < LOCKSTEP_LANES; lane++) {
+                if (!mask[lane]) continue;
+
+                if (!pushLane(lane, next)) stopLane(lane, ADDRESS_FAULT, next);
+                else jumpLane(lane, decoded->constant);
+            }
+            return lanes;
+        case 9:
+            for (int lane = 0; lane < LOCKSTEP_LANES; lane++) {
+                int returnAddress;
+                if (!mask[lane]) continue;
+
+                if (!popLane(lane, &returnAddress)) stopLane(lane, ADDRESS_FAULT, next);
+                else jumpLane(lane, returnAddress);
+            }
+            return lanes;
+        case 0xA:
+            for (int lane = 0; lane < LOCKSTEP_LANES; lane++) {
+                if (!mask[lane]) continue;
+
+                if (!pushLane(lane, (*regA)[lane])) {
+                    stopLane(lane, ADDRESS_FAULT, next);
+                    mask[lane] = 0;
+                }
+            }
+            break;
+        case 0xB:
+            for (int lane = 0; lane < LOCKSTEP_LANES; lane++) {
+                int word;
+                if (!mask[lane]) continue;
+
+                if (!popLane(lane, &word)) {
+                    stopLane(lane, ADDRESS_FAULT, next);
+                    mask[lane] = 0;
+                    continue;
+                }
+
+                (*regA)[lane] = word;
+            }
+            break;
+        case 0xD:
+            for (int lane = 0; lane < LOCKSTEP_LANES; lane++) {
+                int word;
+                if (!mask[lane]) continue;
+
+                laneRegisters[4][lane] = laneRegisters[5][lane];
+
+                if (!popLane(lane, &word)) {
+                    stopLane(lane, ADDRESS_FAULT, next);
+                    mask[lane] = 0;
+                    continue;
+                }
+
+                laneRegisters[5][lane] = word;
+            }
+            break;
+        case 0xE:
+            for (int lane = 0; lane < LOCKSTEP_LANES; lane++) {
+                if (mask[lane] && !blockMemoryLane(lane, decoded->ifun)) {
+                    stopLane(lane, ADDRESS_FAULT, next);
+                    mask[lane] = 0;
+                }
+            }
+            break;
+    }
+
+    laneCounter = BLEND_LANES(mask, BROADCAST(next), laneCounter);
+
+    return lanes;
+}
+
+
+/**
+ *  Gives every lane of a batch a fresh address space and the registers its run would start with.
+ *
+ *  @param firstRun the run the first lane does
+ *  @param lanes    how many lanes the batch uses
+ *
+ *  @return FALSE if the pool ran out of address spaces
+ */
+bool startBatch(int firstRun, int lanes){
+    memset(laneRegisters, 0, sizeof(laneRegisters));
+
+    laneZeroFlag = laneSignFlag = laneOverflowFlag = laneCounter = laneSteps = laneRunning = (LaneVector){ 0 };
+    laneRegisters[4] = laneRegisters[5] = BROADCAST(requestedSize);      // the stack starts at the top
+
+    for (int lane = 0; lane < lanes; lane++) {
+        laneSpace[lane] = acquireAddressSpace();
+        if (!laneSpace[lane]) return false;
+
+        laneRun[lane] = firstRun + lane;
+        laneRunning[lane] = -1;
+        laneOverran[lane] = false;
+
+        if (sweepRegister >= 0) laneRegisters[sweepRegister][lane] = sweepStart + laneRun[lane] * sweepStride;
+    }
+
+    return true;
+}
+
+
+/**
+ *  Puts a lane into the interpreter's registers and address space and lets the interpreter finish it, which
+ *  prints its output and its trace. A lane that already stopped is finished straight away.
+ */
+void finishLane(int lane){
+    enterAddressSpace(laneSpace[lane]);
+    resetDevices();
+
+    for (int index = 0; index < 8; index++) {
+        *registerAtIndex(index) = laneRegisters[index][lane];
+    }
+
+    zeroFlag     = laneZeroFlag[lane] != 0;
+    signFlag     = laneSignFlag[lane] != 0;
+    overflowFlag = laneOverflowFlag[lane] != 0;
+    stepCount    = laneSteps[lane];
+
+    currentInstructionByte = (uint8_t *)relativeToPhysicalAddress(laneCounter[lane]);
+
+    if (runCount > 1) {
+        printf("\n\nRun %d of %d", laneRun[lane] + 1, runCount);
+    }
+
+    if (setjmp(runCompleted) == 0) {
+        runInProgress = true;
+
+        if (laneRunning[lane]) {
+            while (hasNextInstruction()) {
+                startCycle();
+            }
+
+            quit(HALT);
+        }
+
+        if (laneOverran[lane]) printf("\nFATAL ERROR: Stack Overflow / Segmentation Fault\n");
+
+        quit(laneStatus[lane]);
+    }
+
+    runInProgress = false;
+}
+
+
+/**
+ *  Does every one of the --runs, LOCKSTEP_LANES at a time, and prints their traces in run order.
+ */
+void runLockstep(){
+    releaseAddressSpace(activeAddressSpace);                       // every lane takes its own from the pool
+
+    for (int firstRun = 0; firstRun < runCount; firstRun += LOCKSTEP_LANES) {
+        int lanes = runCount - firstRun < LOCKSTEP_LANES ? runCount - firstRun : LOCKSTEP_LANES;
+
+        if (!startBatch(firstRun, lanes)) {
+            printf("\n\nFatal Error. No address space left in the pool.");
+            quit(ADDRESS_FAULT);
+        }
+
+        int alone = 0;                                              // cycles in a row that ran a single lane
+        int ran;
+
+        while (alone < LOCKSTEP_SCALAR_AFTER && (ran = lockstepCycle()) > 0) {
+            alone = ran == 1 ? alone + 1 : 0;
+        }
+
+        for (int lane = 0; lane < lanes; lane++) {
+            finishLane(lane);
+        }
+
+        for (int lane = 0; lane < lanes; lane++) {
+            releaseAddressSpace(laneSpace[lane]);
+        }
+    }
+
+    if (verbose && lockstepCycles) {
+        printf("\nLockstep: %ld cycles ran %ld instructions, %.2f lanes per cycle\n",
+               lockstepCycles, laneCycles, (double)laneCycles / lockstepCycles);
+    }
+}
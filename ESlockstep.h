@@ -0,0 +1,26 @@
+//
+//  ESlockstep.h
+//  Eighty-Sixer
+//
+//  Created by agent on 10/19/26.
+//  Copyright (c) 2026 agent. All rights reserved.
+//
+
+#ifndef __Eighty_Sixer__ESlockstep__
+#define __Eighty_Sixer__ESlockstep__
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifndef LOCKSTEP_LANES
+#define LOCKSTEP_LANES              8           // 8 x 32 bits fills an AVX2 register. Build with -DLOCKSTEP_LANES=16 for AVX-512
+#endif
+
+#define LOCKSTEP_SCALAR_AFTER       64          // steps in a row with a single lane before the rest go to the interpreter
+
+extern bool lockstep;
+
+void runLockstep();
+
+#endif /* defined(__Eighty_Sixer__ESlockstep__) */
@@ -0,0 +1,549 @@
+//
+//  ESmemo.c
+//  Eighty-Sixer
+//
+//  Created by agent on 10/19/26.
+//  Copyright (c) 2026 agent. All rights reserved.
+//
+
+#include "ESmemo.h"
+#include "main.h"
+
+#define MEMO_ALL            0x1FF           // the eight registers and the flags
+#define MEMO_STACK_POINTER  (1 << 4)
+#define MEMO_FLAGS_BIT      (1 << MEMO_FLAGS)
+
+#define MEMO_TAG_PLAIN      0               // shadow tags. 1 through 8 are a register saved as it was at the call
+#define MEMO_TAG_DERIVED    0xFF
+
+/*  Memoized calls, with --memoize. Every call is followed from the call to its ret, and one that turns out to be
+    pure has its result remembered, keyed on its target, the registers it used from its caller and the stack above
+    its return address that it read. The next call with the same key goes straight to the return address with the
+    registers the first one left, and the steps it would have taken are counted all the same.
+
+    A call is pure when nothing it did depends on anything outside that key:
+    - it stores only into its own frame, at or above %esp and below its return address
+    - it loads only the program image, which can't change without --writable-code, words it stored itself, and
+      the stack above its return address
+    - it leaves the devices, the trap and memcpy and memset alone, and returns where it was called from
+    - nothing it leaves in a register or the flags was worked out from %esp, so where its frame was doesn't matter
+
+    Registers are followed a step at a time, from the decoded instruction before it runs. Pushing a register to
+    save it isn't using it, and loading the same word back into it puts it back as it was, so saving and restoring
+    %ebx around the body makes it neither an input nor an output. Shadow memory, a serial and a tag per word, says
+    which call stored each word last and whether that was a saved register.
+
+    A call inside a call is folded into its caller when it returns or is skipped: the registers it used are the
+    caller's, the arguments it read are the caller's memory, and its outputs are the caller's to have changed.
+
+    Only the registers come back on a skip. The frame the call would have left below %esp isn't written, so a
+    program reading beneath its stack pointer finds something different there.
+ */
+
+bool memoizing = false;
+int  memoDepth = 0;
+long memoHits = 0;
+long memoStepsSkipped = 0;
+
+MemoFrame memoFrames[MEMO_DEPTH];
+int memoOverflow = 0;                   // calls open past MEMO_DEPTH
+uint32_t memoSerial = 0;
+
+uint32_t *memoShadowSerial = NULL;      // by word of guest memory: the call that last stored there
+uint8_t  *memoShadowTag = NULL;         // and what, see MEMO_TAG_PLAIN
+
+MemoEntry   *memoEntries = NULL;
+MemoFunction memoFunctions[MEMO_FUNCTIONS];
+
+
+/**
+ *  Sets up the shadow memory and the table of results, once the program is loaded.
+ *
+ *  @return FALSE if there isn't the memory for them
+ */
+bool prepareMemoization(){
+    int words = requestedSize / 4 + 1;
+
+    memoShadowSerial = calloc(words, sizeof(uint32_t));
+    memoShadowTag    = calloc(words, sizeof(uint8_t));
+    memoEntries      = calloc(MEMO_ENTRIES, sizeof(MemoEntry));
+
+    return memoShadowSerial && memoShadowTag && memoEntries;
+}
+
+
+/**
+ *  Forgets the calls in progress and zeroes the counts, for a new run. What was learned about the program is kept.
+ */
+void resetMemoFrames(){
+    memoDepth = 0;
+    memoOverflow = 0;
+    memoHits = 0;
+    memoStepsSkipped = 0;
+}
+
+
+void giveUpOnOpenCalls(){
+    for (int i = 0; i < memoDepth; i++) memoFrames[i].impure = true;
+}
+
+
+int registerValue(int index){
+    int *value = registerAtIndex(index);
+    return value ? *value : 0;
+}
+
+
+void currentValues(int *values){
+    for (int i = 0; i < 8; i++) values[i] = registerValue(i);
+    values[MEMO_FLAGS] = zeroFlag << 2 | signFlag << 1 | overflowFlag;
+}
+
+
+/** FOLLOWING A CALL **/
+
+/**
+ *  A register is read.
+ *
+ *  @return TRUE if its value was worked out from %esp
+ */
+bool useRegister(MemoFrame *frame, int index){
+    if (index == 4) return true;
+    if (index >= 8) return false;                   // NO_REGISTER
+
+    uint16_t bit = 1 << index;
+    if (frame->unchanged & bit) frame->inputs |= bit;
+
+    return frame->derived & bit;
+}
+
+
+void defineRegister(MemoFrame *frame, int index, bool derived){
+    if (index == 4) {
+        if (!derived) frame->impure = true;         // %esp off to a stack of its own
+        return;
+    }
+
+    if (index >= 8) return;
+
+    uint16_t bit = 1 << index;
+    frame->unchanged &= ~bit;
+    frame->derived = derived ? frame->derived | bit : frame->derived & ~bit;
+}
+
+
+void useFlags(MemoFrame *frame){
+    if (frame->unchanged & MEMO_FLAGS_BIT) frame->inputs |= MEMO_FLAGS_BIT;
+    if (frame->derived & MEMO_FLAGS_BIT) frame->impure = true;             // a branch on where the frame is
+}
+
+
+void defineFlags(MemoFrame *frame, bool derived){
+    frame->unchanged &= ~MEMO_FLAGS_BIT;
+    frame->derived = derived ? frame->derived | MEMO_FLAGS_BIT : frame->derived & ~MEMO_FLAGS_BIT;
+}
+
+
+/**
+ *  A word is stored from a register, or NO_REGISTER for a return address. Only the call's own frame may be
+ *  stored to, and only whole words, so a saved register's tag always covers all of it.
+ */
+void storeWord(MemoFrame *frame, int address, int source, bool pushing){
+    if (address < 0 || (address & 3) || address + 4 > frame->entry || (!pushing && address < stackPointer)) {
+        frame->impure = true;
+        return;
+    }
+
+    uint8_t tag = MEMO_TAG_PLAIN;
+    if (source == 4) {
+        tag = MEMO_TAG_DERIVED;
+    } else if (source < 8 && (frame->unchanged & (1 << source))) {
+        tag = (uint8_t)(source + 1);
+    } else if (source < 8 && (frame->derived & (1 << source))) {
+        tag = MEMO_TAG_DERIVED;
+    }
+
+    memoShadowSerial[address >> 2] = frame->serial;
+    memoShadowTag[address >> 2]    = tag;
+}
+
+
+/**
+ *  Checks that a load depends on nothing outside the call's key, and stretches the arguments it read.
+ *
+ *  @param saved   set to the registers whose saved values it loaded
+ *  @param derived set if it loaded something worked out from %esp
+ *
+ *  @return FALSE if the call isn't pure any more
+ */
+bool checkLoad(MemoFrame *frame, int address, int length, uint16_t *saved, bool *derived){
+    if (address < 0 || length <= 0 || address + length > requestedSize) return false;      // the devices too
+    if (address + length <= pristineImageLength) return true;
+
+    int arguments = frame->entry + 4;
+
+    for (int word = address >> 2; word <= (address + length - 1) >> 2; word++) {
+        if (memoShadowSerial[word] >= frame->serial) {          // stored during the call
+            uint8_t tag = memoShadowTag[word];
+            if (tag == MEMO_TAG_PLAIN) continue;
+            if (memoShadowSerial[word] != frame->serial) return false;     // a register some finished call saved
+
+            if (tag == MEMO_TAG_DERIVED) *derived = true;
+            else *saved |= 1 << (tag - 1);
+        } else if (word * 4 >= arguments) {
+            int reach = (word + 1) * 4 - arguments;
+            if (reach > MEMO_ARGUMENT_BYTES) return false;
+            if (reach > frame->argumentBytes) frame->argumentBytes = reach;
+        } else {
+            return false;                                       // globals, the heap, the return address, stale stack
+        }
+    }
+
+    return true;
+}
+
+
+void loadInto(MemoFrame *frame, int address, int destination){
+    uint16_t saved = 0;
+    bool derived = false;
+
+    if (!checkLoad(frame, address, 4, &saved, &derived)) {
+        frame->impure = true;
+        return;
+    }
+
+    if (destination < 8 && destination != 4 && !(address & 3) && saved == 1 << destination) {     // restoring a saved register
+        frame->unchanged |= saved;
+        frame->derived &= ~saved;
+        return;
+    }
+
+    frame->inputs |= saved;
+    defineRegister(frame, destination, derived);
+}
+
+
+/**
+ *  Follows the instruction about to run, in the innermost open call. Called from the interpreter's step hook,
+ *  only while a call is open.
+ *
+ *  @param address where the instruction is
+ */
+void memoStep(int address){
+    MemoFrame *frame = &memoFrames[memoDepth - 1];
+    if (frame->impure || memoOverflow) return;
+
+    const DecodedInstruction *decoded = decodedInstructionAt(address);
+    if (!decoded) {
+        frame->impure = true;
+        return;
+    }
+
+    if (!decoded->valid) return;                                // it faults, and the run ends there
+
+    int a = decoded->registerA, b = decoded->registerB;
+    bool derived;
+
+    switch (decoded->icode) {
+        case 0x0:                                               // halt ends the run
+        case 0x1:
+        case 0x9:                                               // see memoReturn()
+            break;
+
+        case 0x2:
+            derived = useRegister(frame, a);
+            if (decoded->ifun) {                                // cmovXX may leave rB as it was
+                useFlags(frame);
+                derived |= useRegister(frame, b);
+            }
+            defineRegister(frame, b, derived);
+            break;
+
+        case 0x3:
+            defineRegister(frame, b, false);
+            break;
+
+        case 0x4:
+            useRegister(frame, b);
+            storeWord(frame, registerValue(b) + decoded->constant, a, false);
+            break;
+
+        case 0x5:
+            useRegister(frame, b);
+            loadInto(frame, registerValue(b) + decoded->constant, a);
+            break;
+
+        case 0x6:
+        case 0xC:                                               // iaddl's rA is NO_REGISTER
+            derived = useRegister(frame, a);
+            derived |= useRegister(frame, b);
+            defineRegister(frame, b, derived);
+            defineFlags(frame, derived);
+            break;
+
+        case 0x7:
+            if (decoded->ifun) useFlags(frame);
+            break;
+
+        case 0x8:
+            storeWord(frame, stackPointer - 4, NO_REGISTER, true);
+            break;
+
+        case 0xA:
+            storeWord(frame, stackPointer - 4, a, true);
+            break;
+
+        case 0xB:
+            loadInto(frame, stackPointer, a);
+            break;
+
+        case 0xD:
+            if (!useRegister(frame, 5)) {                       // %esp would leave the call's stack
+                frame->impure = true;
+                break;
+            }
+            loadInto(frame, registerValue(5), 5);
+            break;
+
+        default:                                                // memcpy, memset and the trap
+            frame->impure = true;
+            break;
+    }
+}
+
+
+/**
+ *  Folds a finished or skipped call into its caller.
+ *
+ *  @param entry where the call's return address was
+ */
+void foldIntoCaller(MemoFrame *caller, uint16_t inputs, uint16_t outputs, int entry, int argumentBytes){
+    if (caller->impure) return;
+    if (inputs & caller->derived) caller->impure = true;
+
+    caller->inputs |= inputs & caller->unchanged;
+
+    if (argumentBytes) {
+        uint16_t saved = 0;
+        bool derived = false;
+
+        if (!checkLoad(caller, entry + 4, argumentBytes, &saved, &derived) || derived) caller->impure = true;
+        caller->inputs |= saved;
+    }
+
+    caller->unchanged &= ~outputs;
+    caller->derived   &= ~outputs;
+}
+
+
+/** REMEMBERING **/
+
+MemoFunction *functionFor(int target, bool adding){
+    for (int i = 0; i < MEMO_FUNCTIONS; i++) {
+        MemoFunction *function = &memoFunctions[((unsigned int)target * 2654435761u + i) & (MEMO_FUNCTIONS - 1)];
+        if (function->used && function->target == target) return function;
+
+        if (!function->used) {
+            if (!adding) return NULL;
+
+            function->used = true;
+            function->target = target;
+            return function;
+        }
+    }
+
+    return NULL;
+}
+
+
+uint64_t keyHash(int target, uint16_t inputs, int argumentBytes, const int *values, const uint8_t *arguments){
+    uint64_t hash = checksumBytes(0xCBF29CE484222325ULL, (const uint8_t *)&target, sizeof(target));
+    hash = checksumBytes(hash, (const uint8_t *)&inputs, sizeof(inputs));
+
+    for (int i = 0; i <= MEMO_FLAGS; i++) {
+        if (inputs & (1 << i)) hash = checksumBytes(hash, (const uint8_t *)&values[i], sizeof(int));
+    }
+
+    return checksumBytes(hash, arguments, argumentBytes);
+}
+
+
+bool entryMatches(const MemoEntry *entry, int target, uint16_t inputs, int argumentBytes, const int *values, const uint8_t *arguments){
+    if (!entry->used || entry->target != target || entry->inputs != inputs || entry->argumentBytes != argumentBytes) return false;
+
+    for (int i = 0; i <= MEMO_FLAGS; i++) {
+        if ((inputs & (1 << i)) && entry->inputValues[i] != values[i]) return false;
+    }
+
+    return !memcmp(entry->arguments, arguments, argumentBytes);
+}
+
+
+/**
+ *  Remembers a pure call that just returned.
+ */
+void rememberCall(const MemoFrame *frame, uint16_t outputs){
+    MemoFunction *function = functionFor(frame->target, true);
+    if (!function) return;
+
+    int signature = 0;
+    while (signature < function->signatureCount
+           && (function->inputs[signature] != frame->inputs || function->argumentBytes[signature] != frame->argumentBytes)) signature++;
+
+    if (signature == MEMO_SIGNATURES) return;
+    if (signature == function->signatureCount) {
+        function->inputs[signature]        = frame->inputs;
+        function->argumentBytes[signature] = frame->argumentBytes;
+        function->signatureCount++;
+    }
+
+    const uint8_t *arguments = sandboxFloor + frame->entry + 4;
+    uint64_t hash = keyHash(frame->target, frame->inputs, frame->argumentBytes, frame->entryValues, arguments);
+
+    MemoEntry *entry = &memoEntries[hash & (MEMO_ENTRIES - 1)];         // replaced if every slot it could have is taken
+    for (int probe = 0; probe < MEMO_PROBES; probe++) {
+        MemoEntry *candidate = &memoEntries[(hash + probe) & (MEMO_ENTRIES - 1)];
+        if (!candidate->used) {
+            entry = candidate;
+            break;
+        }
+    }
+
+    entry->used          = true;
+    entry->target        = frame->target;
+    entry->inputs        = frame->inputs;
+    entry->outputs       = outputs;
+    entry->argumentBytes = frame->argumentBytes;
+    entry->steps         = stepCount - frame->entryStep;
+
+    memcpy(entry->inputValues, frame->entryValues, sizeof(entry->inputValues));
+    currentValues(entry->outputValues);
+    memcpy(entry->arguments, arguments, frame->argumentBytes);
+}
+
+
+/**
+ *  Looks for a remembered result for the call just made, and if there is one, returns from it.
+ *
+ *  @return TRUE if the call was skipped
+ */
+bool skipRememberedCall(int target, int returnAddress){
+    MemoFunction *function = functionFor(target, false);
+    if (!function) return false;
+
+    int entry = stackPointer;
+    int values[MEMO_FLAGS + 1];
+    currentValues(values);
+
+    for (int signature = 0; signature < function->signatureCount; signature++) {
+        uint16_t inputs   = function->inputs[signature];
+        int argumentBytes = function->argumentBytes[signature];
+        if (entry + 4 + argumentBytes > requestedSize) continue;
+
+        const uint8_t *arguments = sandboxFloor + entry + 4;
+        uint64_t hash = keyHash(target, inputs, argumentBytes, values, arguments);
+
+        for (int probe = 0; probe < MEMO_PROBES; probe++) {
+            const MemoEntry *remembered = &memoEntries[(hash + probe) & (MEMO_ENTRIES - 1)];
+            if (!entryMatches(remembered, target, inputs, argumentBytes, values, arguments)) continue;
+
+            if (memoDepth) foldIntoCaller(&memoFrames[memoDepth - 1], inputs, remembered->outputs, entry, argumentBytes);
+
+            for (int i = 0; i < 8; i++) {
+                if (remembered->outputs & (1 << i)) *registerAtIndex(i) = remembered->outputValues[i];
+            }
+
+            if (remembered->outputs & MEMO_FLAGS_BIT) {
+                zeroFlag     = remembered->outputValues[MEMO_FLAGS] >> 2 & 1;
+                signFlag     = remembered->outputValues[MEMO_FLAGS] >> 1 & 1;
+                overflowFlag = remembered->outputValues[MEMO_FLAGS] & 1;
+            }
+
+            stackPointer = entry + 4;                           // the ret's pop
+            jumpToReadAtInternalAddress(returnAddress);
+            stepCount += remembered->steps;
+
+            memoHits++;
+            memoStepsSkipped += remembered->steps;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+/** THE HOOKS **/
+
+/**
+ *  A call has just gone through: skips it if its result is remembered, otherwise starts following it.
+ *
+ *  @param target        where it went
+ *  @param returnAddress where it will come back to
+ */
+void memoCall(int target, int returnAddress){
+    if (memoOverflow || memoDepth == MEMO_DEPTH) {
+        giveUpOnOpenCalls();
+        memoOverflow++;
+        return;
+    }
+
+    if (skipRememberedCall(target, returnAddress)) return;
+
+    if (++memoSerial == 0) {                                    // wrapped, so the shadow can't tell old stores from new
+        memset(memoShadowSerial, 0, (requestedSize / 4 + 1) * sizeof(uint32_t));
+        giveUpOnOpenCalls();
+        memoSerial = 1;
+    }
+
+    MemoFrame *frame = &memoFrames[memoDepth++];
+
+    frame->target        = target;
+    frame->entry         = stackPointer;
+    frame->returnAddress = returnAddress;
+    frame->entryStep     = stepCount;
+    frame->serial        = memoSerial;
+    frame->unchanged     = MEMO_ALL;
+    frame->inputs        = 0;
+    frame->derived       = MEMO_STACK_POINTER;
+    frame->argumentBytes = 0;
+    frame->impure        = false;
+
+    currentValues(frame->entryValues);
+}
+
+
+/**
+ *  A ret has just gone through: remembers the call it ends if that was pure, and folds it into its caller.
+ *
+ *  @param returnAddress where it went
+ */
+void memoReturn(int returnAddress){
+    if (memoOverflow) {
+        memoOverflow--;
+        return;
+    }
+
+    if (!memoDepth) return;                                     // a call made before the run was followed
+
+    MemoFrame *frame = &memoFrames[memoDepth - 1];
+    if (frame->returnAddress != returnAddress || stackPointer != frame->entry + 4) {        // not the return it was called for
+        giveUpOnOpenCalls();
+        memoDepth = 0;
+        return;
+    }
+
+    memoDepth--;
+
+    uint16_t outputs = MEMO_ALL & ~frame->unchanged & ~MEMO_STACK_POINTER;
+    if (frame->derived & outputs) frame->impure = true;
+
+    if (!frame->impure) rememberCall(frame, outputs);
+
+    if (memoDepth) {
+        MemoFrame *caller = &memoFrames[memoDepth - 1];
+
+        if (frame->impure) caller->impure = true;
+        else foldIntoCaller(caller, frame->inputs, outputs, frame->entry, frame->argumentBytes);
+    }
+}
@@ -0,0 +1,70 @@
+//
+//  ESmemo.h
+//  Eighty-Sixer
+//
+//  Created by agent on 10/19/26.
+//  Copyright (c) 2026 agent. All rights reserved.
+//
+
+#ifndef __Eighty_Sixer__ESmemo__
+#define __Eighty_Sixer__ESmemo__
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#define MEMO_DEPTH              4096        // calls followed at once, deeper ones make every open call impure
+#define MEMO_ENTRIES            16384       // results remembered, a power of two
+#define MEMO_PROBES             8           // slots an entry may land in before it replaces one
+#define MEMO_FUNCTIONS          1024        // call targets, a power of two
+#define MEMO_SIGNATURES         4           // different sets of inputs remembered for one function
+#define MEMO_ARGUMENT_BYTES     64          // stack above the return address a remembered call may read
+#define MEMO_FLAGS              8           // the flags' bit in a register mask, after the eight registers
+
+typedef struct MemoFrame {
+    int      target;
+    int      entry;                         // where its return address is, %esp just after the call
+    int      returnAddress;
+    int      entryStep;
+    uint32_t serial;                        // tells its stores from older ones, see memoShadowSerial
+    uint16_t unchanged;                     // register mask: still holding what they held at the call
+    uint16_t inputs;                        // what they held at the call was used
+    uint16_t derived;                       // holding something worked out from %esp
+    int      argumentBytes;                 // how far above the return address it read
+    bool     impure;
+    int      entryValues[MEMO_FLAGS + 1];   // the registers at the call, and the flags packed
+} MemoFrame;
+
+typedef struct MemoEntry {
+    bool     used;
+    int      target;
+    uint16_t inputs;
+    uint16_t outputs;                       // registers the call changed, %esp aside
+    int      argumentBytes;
+    int      steps;
+    int      inputValues[MEMO_FLAGS + 1];
+    int      outputValues[MEMO_FLAGS + 1];
+    uint8_t  arguments[MEMO_ARGUMENT_BYTES];
+} MemoEntry;
+
+typedef struct MemoFunction {
+    bool     used;
+    int      target;
+    int      signatureCount;                // the input masks and argument lengths its entries are keyed on
+    uint16_t inputs[MEMO_SIGNATURES];
+    int      argumentBytes[MEMO_SIGNATURES];
+} MemoFunction;
+
+extern bool memoizing;                      // see --memoize
+extern int  memoDepth;
+extern long memoHits;
+extern long memoStepsSkipped;
+
+bool prepareMemoization();
+void resetMemoFrames();
+
+void memoStep(int);
+void memoCall(int, int);
+void memoReturn(int);
+
+#endif /* defined(__Eighty_Sixer__ESmemo__) */
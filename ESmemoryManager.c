@@ -15,14 +15,24 @@ uint8_t *lastInstructionByte;
 
 uint8_t *currentInstructionByte;
 
-uint8_t *stackPointer;
-uint8_t *framePointer;
 uint8_t *heapPointer;
 
 int requestedSize;
 
 bool initialized = false;
 bool isLocked = false;
+int imageHeaderLength = 0;                      // how many header bytes readImageHeader() dropped
+bool writableCode = false;                      // stores may land anywhere in the program image, see --writable-code
+
+#define WORD_BITS 32                            // the word sized half, once per width. See ESwordWidth.h
+#include "ESwordWidth.h"
+#include "ESmemoryCore.inc"
+#undef WORD_BITS
+
+#define WORD_BITS 64
+#include "ESwordWidth.h"
+#include "ESmemoryCore.inc"
+#undef WORD_BITS
 
 
 /**
@@ -41,19 +51,23 @@ bool setupVirtualMemory(int bytes){
 
     requestedSize = bytes;
 
-    sandboxCeiling = calloc(bytes, 1);          // calloc allocated memory for an array of size 'bytes' of 1 byte each, setting to zero in the process
-
-    if (!sandboxCeiling) {                      // check to make sure calloc returned an appropriate chunk of memory
+    if (!setupAddressSpacePool(addressSpacePoolSize, bytes)) {     // every address space is mapped up front, already zeroed
         return false;                           // return false on error
     }
 
-    sandboxFloor = sandboxCeiling - bytes;      // the floor of the sandbox is the malloc pointer minus the byte length
+    activeAddressSpace = acquireAddressSpace();
+    if (!activeAddressSpace) return false;
+
+    sandboxFloor   = activeAddressSpace->floor; // the floor of the sandbox is the bottom of the mapping
+    sandboxCeiling = sandboxFloor + bytes;      // and the ceiling is the byte length above it
     heapPointer  = sandboxFloor;                // before adding the program code, the heap pointer is the floor of the memory space
     nextInstructionByte = sandboxFloor;         // the program code goes at the bottom of the sandbox
     lastInstructionByte = sandboxFloor;         // start it at the bottom
 
-    stackPointer = sandboxCeiling;              // the stack starts at the top
-    framePointer = sandboxCeiling;              // nothing on the stack, so frame = stack
+    stackPointer = bytes;                       // the stack starts at the top
+    framePointer = bytes;                       // nothing on the stack, so frame = stack
+    stackPointer64 = bytes;
+    framePointer64 = bytes;
 
     if (verbose) printStackPointers();
 
@@ -71,7 +85,7 @@ bool setupVirtualMemory(int bytes){
  *  @return FALSE if an error occured during the store operation.
  */
 bool storeInstructionByte(uint8_t byte){
-    if (heapPointer >= stackPointer || !initialized) {          // if the heap pointer is at the stack pointer, we've overflowed the stack
+    if (heapPointer >= sandboxFloor + stackPointer || !initialized) {          // if the heap pointer is at the stack pointer, we've overflowed the stack
         printf("FATAL ERROR: Stack Overflow / Segmentation Fault");
         quit(PROGRAM_ERROR);
     }
@@ -93,23 +107,67 @@ bool storeInstructionByte(uint8_t byte){
 }
 
 
+/**
+ *  Stores a program byte at the given address, for loaders that don't write the image front to back. The image
+ *  runs up to the highest byte stored, and any gap in between stays zero.
+ *
+ *  @param address where the byte goes, from the sandbox floor
+ *  @param byte    the byte to store
+ *
+ *  @return FALSE if the address is outside the room below the stack, or loading has finished
+ */
+bool storeInstructionByteAt(int address, uint8_t byte){
+    if (!initialized || isLocked || address < 0 || address >= stackPointer) return false;
+
+    sandboxFloor[address] = byte;
+    if (sandboxFloor + address >= nextInstructionByte) nextInstructionByte = sandboxFloor + address + 1;
+
+    return true;
+}
+
+
+/**
+ *  Stores a run of program bytes after the ones already stored, for loaders that have the whole image at hand.
+ *
+ *  @param bytes  the program bytes
+ *  @param length how many there are
+ *
+ *  @return FALSE if they don't fit below the stack, or loading has finished
+ */
+bool storeInstructionBlock(const uint8_t *bytes, int length){
+    if (!initialized || isLocked || length < 0 || nextInstructionByte - sandboxFloor + length > stackPointer) return false;
+
+    memcpy(nextInstructionByte, bytes, length);
+    nextInstructionByte += length;
+
+    return true;
+}
+
+
 /**
  *  Finalizes the instruction loading process and readies the virtual memory for program execution.
  *
  *  @return FALSE if an error occurred.
  */
 bool instructionLoadComplete(){
-    if (heapPointer >= stackPointer || !initialized) {          // if the heap pointer is at the stack pointer, we've overflowed the stack
+    if (heapPointer >= sandboxFloor + stackPointer || !initialized) {          // if the heap pointer is at the stack pointer, we've overflowed the stack
         printf("\nFATAL ERROR: Stack Overflow / Segmentation Fault\n");
         return false;
     }
 
+    readImageHeader();                                          // before anything points into the image
+
     lastInstructionByte = nextInstructionByte - 1;              // this is the address of the very last instruction
     heapPointer = nextInstructionByte;                          // start the bottom now we're here
     currentInstructionByte = sandboxFloor;                      // start reading at the very first byte
 
     isLocked = true;                                            // locks the program from entering more codes
 
+    if (!takePristineSnapshot(sandboxFloor, (int)(nextInstructionByte - sandboxFloor))) {    // every reset goes back to this image
+        printf("\nFATAL ERROR: Could not snapshot the program image\n");
+        return false;
+    }
+
 
     if (verbose) {
         printf("\nInstruction loading complete.\n");
@@ -121,6 +179,113 @@ bool instructionLoadComplete(){
 }
 
 
+/**
+ *  Picks the word size from the image header, if the image starts with one, and drops the header so the program
+ *  starts at address 0 either way. Images without a header run at whatever width the command line chose.
+ */
+void readImageHeader(){
+    static const char magic[IMAGE_HEADER_LENGTH] = IMAGE_HEADER_Y86_64;
+
+    if (nextInstructionByte - sandboxFloor < IMAGE_HEADER_LENGTH || memcmp(sandboxFloor, magic, IMAGE_HEADER_LENGTH)) return;
+
+    memmove(sandboxFloor, sandboxFloor + IMAGE_HEADER_LENGTH, nextInstructionByte - sandboxFloor - IMAGE_HEADER_LENGTH);
+    nextInstructionByte -= IMAGE_HEADER_LENGTH;
+    memset(nextInstructionByte, 0, IMAGE_HEADER_LENGTH);
+    instructionBytes -= IMAGE_HEADER_LENGTH;
+
+    wordBits = 64;
+    imageHeaderLength = IMAGE_HEADER_LENGTH;
+
+    if (verbose) printf("\nY86-64 image header found.\n");
+}
+
+
+/**
+ *  Moves execution into another address space from the pool and rewinds every pointer to where it
+ *  stood right after the program was loaded. The space must already hold the program image.
+ *
+ *  @param space the address space to run in
+ *
+ *  @return FALSE if the program has not been loaded yet or the space is missing
+ */
+bool enterAddressSpace(AddressSpace *space){
+    if (!space || !isLocked) return false;
+
+    AddressSpace *previous = activeAddressSpace;        // the image may differ wherever either one wrote to it
+    if (previous && previous != space && previous->codeWrittenStart < previous->codeWrittenEnd) {
+        invalidateCode(previous->codeWrittenStart, previous->codeWrittenEnd);
+    }
+    if (previous != space && space->codeWrittenStart < space->codeWrittenEnd) {
+        invalidateCode(space->codeWrittenStart, space->codeWrittenEnd);
+    }
+
+    long programLength = nextInstructionByte - sandboxFloor;
+
+    activeAddressSpace = space;
+
+    sandboxFloor   = space->floor;
+    sandboxCeiling = sandboxFloor + requestedSize;
+
+    nextInstructionByte = sandboxFloor + programLength;
+    lastInstructionByte = nextInstructionByte - 1;
+    heapPointer = nextInstructionByte;
+    currentInstructionByte = sandboxFloor;
+
+    stackPointer = requestedSize;
+    framePointer = requestedSize;
+    stackPointer64 = requestedSize;
+    framePointer64 = requestedSize;
+
+    return true;
+}
+
+
+/**
+ *  Records where every pointer stands, as offsets from the sandbox floor so the layout
+ *  can be put back into any address space, in this process or another one.
+ *
+ *  @param layout where to put the offsets
+ */
+void saveMemoryLayout(MemoryLayout *layout){
+    layout->programCounter = (int)(currentInstructionByte - sandboxFloor);
+    layout->stackPointer   = stackPointer;
+    layout->framePointer   = framePointer;
+    layout->heapPointer    = (int)(heapPointer - sandboxFloor);
+    layout->programLength  = (int)(nextInstructionByte - sandboxFloor);
+}
+
+
+/**
+ *  Puts every pointer back where saveMemoryLayout() found it, in the active address space, and locks
+ *  the program code as if it had just been loaded. The program image must already be in place.
+ *
+ *  @param layout the offsets to restore
+ *
+ *  @return FALSE if any offset falls outside the sandbox
+ */
+bool restoreMemoryLayout(const MemoryLayout *layout){
+    if (!initialized) return false;
+
+    const int *offsets[] = { &layout->programCounter, &layout->stackPointer, &layout->framePointer,
+                             &layout->heapPointer, &layout->programLength };
+
+    for (int i = 0; i < 5; i++) {
+        if (*offsets[i] < 0 || *offsets[i] > requestedSize) return false;
+    }
+
+    nextInstructionByte    = sandboxFloor + layout->programLength;
+    lastInstructionByte    = nextInstructionByte - 1;
+    currentInstructionByte = sandboxFloor + layout->programCounter;
+    stackPointer           = layout->stackPointer;
+    framePointer           = layout->framePointer;
+    heapPointer            = sandboxFloor + layout->heapPointer;
+
+    isLocked = true;
+
+    return true;
+}
+
+
 /**
  *  Prints the current state of stack pointers, as well as the size of each memory segment.
  */
@@ -132,12 +297,12 @@ void printStackPointers(){
     printf("Next Instruction Pointer:   %p\n", nextInstructionByte);
     printf("Last Instruction Pointer:   %p\n", lastInstructionByte);
     printf("Current Instruction:        %p\n", currentInstructionByte);
-    printf("Stack Pointer:              %p\n", stackPointer);
-    printf("Frame Pointer:              %p\n", framePointer);
+    printf("Stack Pointer:              %p\n", sandboxFloor + stackPointer);
+    printf("Frame Pointer:              %p\n", sandboxFloor + framePointer);
     printf("Heap Pointer:               %p\n", heapPointer);
     printf("Sandbox Size/Specified:     %ld/%d\n", sandboxCeiling - sandboxFloor, requestedSize);
-    printf("Stack Size:                 %ld\n",  stackPointer - sandboxCeiling);
-    printf("Current Stack Frame Size:   %ld\n",  stackPointer - framePointer);
+    printf("Stack Size:                 %d\n",  requestedSize - stackPointer);
+    printf("Current Stack Frame Size:   %d\n",  framePointer - stackPointer);
     printf("Heap Size:                  %ld\n",  heapPointer - nextInstructionByte);
     printf("Program Code Size:          %ld\n",  nextInstructionByte - sandboxFloor);
     printf("Instruction Bytes Read:     %d\n", instructionBytes);
@@ -195,78 +360,14 @@ bool programWriteIsLocked(){
  */
 
 int physicalToRelativeAddress(int* address){
-    if (address > (int *)sandboxCeiling || address < (int *)sandboxFloor) {       // the pointer is not within the virtual memory space
+    if ((uint8_t *)address > sandboxCeiling || (uint8_t *)address < sandboxFloor) {      // the pointer is not within the virtual memory space
         return -1;
     }
 
 
-    return (int)(address - (int *)sandboxFloor);                                   // subtraction does the trick
-}
-
-/**
- *  Translates the given internal address into the external address system.
- *
- *  @param address an address within the virtual memory, treating the base of the memory space as 0x00000000
- *
- *  @return a pointer to the physical memory address referenced by the internal address
- */
-int* relativeToPhysicalAddress(int address){
-    if (address > requestedSize || address < 0) {       // the pointer is not within the virtual memory space
-        return NULL;
-    }
-
-
-    return (int *)sandboxFloor + address;                      // addition does the trick here
-}
-
-
-/**
- *  Reads the next lowest unread instruction byte and increments the counter for iteration.
- *
- *  @return the instruction byte
- */
-uint8_t readNextInstructionByte(){
-    if (!isLocked || !initialized) {
-        printf("\nFATAL ERROR: Concurrent Modification / Read Exception\n");
-        quit(ADDRESS_FAULT);
-    }
-
-    if (currentInstructionByte >= stackPointer || currentInstructionByte > lastInstructionByte) {
-        printf("\nFATAL ERROR: Stack Overflow / Segmentation Fault\n");
-        quit(ADDRESS_FAULT);
-    }
-
-    return *(currentInstructionByte++);                     // post-increment will return the proper byte and then increment for future calls
-
+    return (int)((uint8_t *)address - sandboxFloor);                               // subtraction does the trick, one byte per address
 }
 
-
-/**
- *  Jumps to the internal memory address and returns the byte located there. DOES NOT INCREMENT the current instruction.
- *  Fails by halting execution if the jump address is not a valid program instruction address.
- *
- *  @param address the internal memory address target of the jump instruction, treating the bottom of the sandbox as 0x00000000
- *
- *  @return the byte located at that address
- */
-bool jumpToReadAtInternalAddress(int address){
-    if (!isLocked || !initialized) {
-        printf("\nFATAL ERROR: Concurrent Modification / Read Exception\n");
-        quit(ADDRESS_FAULT);
-    }
-
-    currentInstructionByte = (uint8_t *)relativeToPhysicalAddress(address);
-
-
-    if (currentInstructionByte >= stackPointer || currentInstructionByte > lastInstructionByte) {
-        printf("\nFATAL ERROR: Stack Overflow / Segmentation Fault\n");
-        quit(ADDRESS_FAULT);
-    }
-
-    return true;
-}
-
-
 /**
  *  Jumps to the physical memory address and returns the byte located there. DOES NOT INCREMENT the current instruction.
  *  Fails by halting execution if the jump address is not a valid program instruction address.
@@ -284,7 +385,7 @@ bool jumpToReadAtExternalAddress(uint8_t *address){
     currentInstructionByte = address;
 
 
-    if (currentInstructionByte >= stackPointer || currentInstructionByte > lastInstructionByte) {
+    if (currentInstructionByte - sandboxFloor >= stackPointer || currentInstructionByte > lastInstructionByte) {
         printf("\nFATAL ERROR: Stack Overflow / Segmentation Fault\n");
         quit(ADDRESS_FAULT);
     }
@@ -302,7 +403,7 @@ bool jumpToReadAtExternalAddress(uint8_t *address){
 bool offsetProgramCounter(int offset){
     currentInstructionByte += offset;
 
-    if (currentInstructionByte >= stackPointer || currentInstructionByte > lastInstructionByte) {
+    if (currentInstructionByte - sandboxFloor >= stackPointer || currentInstructionByte > lastInstructionByte) {
         printf("\nFATAL ERROR: Stack Overflow / Segmentation Fault\n");
         quit(ADDRESS_FAULT);
     }
@@ -311,76 +412,101 @@ bool offsetProgramCounter(int offset){
 }
 
 /**
- *  Returns TRUE if the program counter has not reached the end of the program.
- *
- *  @return TRUE if there are more instructions to be read
+ *  Marks every page a block of guest memory covers as dirty.
  */
-bool hasNextInstruction(){
-    if (currentInstructionByte >= stackPointer || currentInstructionByte > lastInstructionByte) return false;
-
-
-    return true;
+void markBlockDirty(int address, int count){
+    for (int page = address >> GUEST_PAGE_SHIFT; page <= (address + count - 1) >> GUEST_PAGE_SHIFT; page++) {
+        markPageDirty(sandboxFloor + ((long)page << GUEST_PAGE_SHIFT));
+    }
 }
 
 /**
- *  Sets the memory at the given physical address
- *
- *  @param address the physical address to set
- *  @param payload the four bytes of data to set
+ *  Keeps everything decoded from the program image in step with a store into it. The decoded instructions, the
+ *  verified runs and the optimized blocks that cover the bytes written are dropped, and whatever is needed again is
+ *  decoded from the new bytes; see invalidateCode(). The address space remembers which bytes of its image it
+ *  changed, for when it's entered or reset. Only stores reaching into the image get here.
  *
- *  @return TRUE if the operation was successful
+ *  @param offset where the store started, from the sandbox floor
+ *  @param length the number of bytes it wrote
  */
-bool setMemoryAtPhysicalAddress(int* address, int payload){
-    if (address > (int *)heapPointer || address < (int *)lastInstructionByte) return false;               // make sure we're trying to write memory to the heap
-
-    *address = payload;
-
-    if (*address == payload) return true;
+void codeWritten(long offset, long length){
+    long end = offset + length < pristineImageLength ? offset + length : pristineImageLength;
+    if (offset < 0 || offset >= end) return;
+
+    AddressSpace *space = activeAddressSpace;
+    if (space && space->codeWrittenStart >= space->codeWrittenEnd) {
+        space->codeWrittenStart = (int)offset;
+        space->codeWrittenEnd   = (int)end;
+    } else if (space) {
+        if (offset < space->codeWrittenStart) space->codeWrittenStart = (int)offset;
+        if (end > space->codeWrittenEnd) space->codeWrittenEnd = (int)end;
+    }
 
-    return false;
+    invalidateCode((int)offset, (int)end);
 }
 
 /**
- *  Fetches the four byte block at the given physical address. Used for safety; halts operation if unsuccessful.
+ *  Drops whatever was decoded from a range of the program image, which has changed underneath it.
  *
- *  @param address a pointer to the desired item
- *
- *  @return the four byte block encoded as a signed integer
+ *  @param start the first byte that changed
+ *  @param end   just past the last
  */
-int fetchMemoryAtPhysicalAddress(int* address){
-    if (address > (int *)heapPointer || address < (int *)lastInstructionByte) quit(ADDRESS_FAULT);               // make sure we're trying to read memory from the heap
-
-    return *address;
+void invalidateCode(int start, int end){
+    invalidateDecodedInstructions(start, end);
+    invalidateVerifiedRuns(start, end);
+    invalidateOptimizedBlocks(start, end);
 }
 
 /**
- *  Pushes the given integer payload onto the stack and adjusts the stack pointer.
+ *  Copies a block of guest memory, overlapping or not. The destination has to lie where a word store could go,
+ *  above the program code or with --writable-code anywhere in it, and the source inside the sandbox.
  *
- *  @param payload the four byte block to push onto the stack
+ *  @param destination where to copy to
+ *  @param source      where to copy from
+ *  @param count       the number of bytes
  *
- *  @return TRUE if the operation was successful
+ *  @return FALSE if either block is out of bounds, in which case nothing is copied
  */
-bool pushToStack(int payload){
-    if (stackPointer <= heapPointer) quit(ADDRESS_FAULT);
+bool copyMemoryBlock(int destination, int source, int count){
+    if (count < 0) return false;
+    if (count == 0) return true;
 
-    *stackPointer = payload;
-    stackPointer -= 4;          // the stack grows downwards
+    long imageLast = lastInstructionByte - sandboxFloor;
 
+    if ((destination < imageLast && !writableCode) || destination < 0 || (long)destination + count > requestedSize) return false;
+    if (source < 0 || (long)source + count > requestedSize) return false;
+
+    markBlockDirty(destination, count);
+    memmove(sandboxFloor + destination, sandboxFloor + source, count);        // the C library does this with the widest vectors it has
+
+    if (destination <= imageLast) codeWritten(destination, count);
 
     return true;
 }
 
 /**
- *  Returns the top item from the stack and decrements the stack pointer.
+ *  Fills a block of guest memory with a byte, with the bounds copyMemoryBlock() puts on its destination.
  *
- *  @return the top item from the stack
+ *  @param destination where to start
+ *  @param value       the byte to fill with
+ *  @param count       the number of bytes
+ *
+ *  @return FALSE if the block is out of bounds, in which case nothing is written
  */
-int popFromStack(){
-    if (stackPointer >= sandboxCeiling) quit(ADDRESS_FAULT);
+bool fillMemoryBlock(int destination, uint8_t value, int count){
+    if (count < 0) return false;
+    if (count == 0) return true;
+
+    long imageLast = lastInstructionByte - sandboxFloor;
 
-    int popped = *stackPointer;
-    stackPointer += 4;         // the stack grows downard, so to pop we add
-    return popped;             // post decrement returns proper value and then decreases the stack
+    if ((destination < imageLast && !writableCode) || destination < 0 || (long)destination + count > requestedSize) return false;
+
+    markBlockDirty(destination, count);
+    memset(sandboxFloor + destination, value, count);
+
+    if (destination <= imageLast) codeWritten(destination, count);
+
+    return true;
 }
 
 /**
@@ -391,7 +517,7 @@ int popFromStack(){
  *  @return a pointer to the top of the memory
  */
 int* myFirstMalloc(size_t size){
-    if (heapPointer + size + 1 >= stackPointer) {
+    if (heapPointer + size + 1 >= sandboxFloor + stackPointer) {
         return NULL;
     }
 
@@ -14,19 +14,47 @@
 #include <stdbool.h>
 #include <stdint.h>
 #include "main.h"
-
-extern uint8_t *stackPointer;
-extern uint8_t *framePointer;
+#include "ESaddressSpacePool.h"
+
+#define IMAGE_HEADER_LENGTH     8
+#define IMAGE_HEADER_Y86_64     ".Y86-64"       // 2E 59 38 36 2D 36 34 00. 2E faults INS on Y86, so no program starts with it
+
+typedef struct MemoryLayout {
+    int programCounter;             // every field is an offset from the sandbox floor
+    int stackPointer;
+    int framePointer;
+    int heapPointer;
+    int programLength;              // the number of program bytes loaded at the floor
+} MemoryLayout;
+
+extern uint8_t *sandboxFloor;
+extern int requestedSize;
+
+extern uint8_t *sandboxCeiling;
+extern uint8_t *lastInstructionByte;
+extern int imageHeaderLength;
+
+extern int stackPointer;
+extern int framePointer;
+extern int64_t stackPointer64;          // %rsp and %rbp in Y86-64 mode
+extern int64_t framePointer64;
 extern uint8_t *heapPointer;
 extern uint8_t *currentInstructionByte;
+extern bool writableCode;
 
 bool setupVirtualMemory(int);
+bool enterAddressSpace(AddressSpace*);
+void saveMemoryLayout(MemoryLayout*);
+bool restoreMemoryLayout(const MemoryLayout*);
 bool storeInstructionByte(uint8_t);
+bool storeInstructionByteAt(int, uint8_t);
+bool storeInstructionBlock(const uint8_t*, int);
+void readImageHeader();
 bool instructionLoadComplete();
 bool programWriteIsLocked();
 void printStackPointers();
 void printProgramCode();
-void printHarmonFormattedTrace();
+void printHarmonFormattedTrace(const char*);
 
 uint8_t readNextInstructionByte();
 
@@ -40,10 +68,26 @@ int* relativeToPhysicalAddress(int);
 int  physicalToRelativeAddress(int*);
 
 bool setMemoryAtPhysicalAddress(int*, int);
+bool storeIntoProgram(int*, int);
+void codeWritten(long, long);
+void invalidateCode(int, int);
+bool copyMemoryBlock(int, int, int);
+bool fillMemoryBlock(int, uint8_t, int);
+void markBlockDirty(int, int);
 int  fetchMemoryAtPhysicalAddress(int*);
 
 bool hasNextInstruction();
 
+uint8_t  readNextInstructionByte64();         // the same again for Y86-64, see ESmemoryCore.inc
+bool     jumpToReadAtInternalAddress64(int64_t);
+bool     pushToStack64(int64_t);
+int64_t  popFromStack64();
+int64_t* relativeToPhysicalAddress64(int64_t);
+bool     setMemoryAtPhysicalAddress64(int64_t*, int64_t);
+bool     storeIntoProgram64(int64_t*, int64_t);
+int64_t  fetchMemoryAtPhysicalAddress64(int64_t*);
+bool     hasNextInstruction64();
+
 bool offsetProgramCounter(int);
 
 int* myFirstMalloc(size_t);
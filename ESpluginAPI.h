@@ -0,0 +1,56 @@
+//
+//  ESpluginAPI.h
+//  Eighty-Sixer
+//
+//  Created by agent on 10/19/26.
+//  Copyright (c) 2026 agent. All rights reserved.
+//
+
+#ifndef __Eighty_Sixer__ESpluginAPI__
+#define __Eighty_Sixer__ESpluginAPI__
+
+/*  The interface for instrumentation plugins, the only header a plugin needs. A plugin is a shared object, built
+    with gcc -shared -fPIC, loaded with --plugin path.so or --plugin path.so=argument. It exports
+
+        bool eightySixerPlugin(const ESPluginHost *host, ESPluginCallbacks *callbacks);
+
+    which is called once, before the first run, with the callbacks zeroed; the host stays put and may be kept.
+    Setting a callback subscribes to its event, and the ones left NULL cost nothing. Returning FALSE stops the
+    machine before it runs anything.
+
+    Addresses are guest addresses. Every callback gets back the context the plugin set.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define ES_PLUGIN_API_VERSION   1
+#define ES_PLUGIN_ENTRY         "eightySixerPlugin"
+
+typedef struct ESPluginHost {
+    int         apiVersion;                             // ES_PLUGIN_API_VERSION
+    int         wordBits;                               // 32 for Y86, 64 for Y86-64
+    const char *argument;                               // what came after the = on the command line, or NULL
+
+    int64_t (*registerValue)(int);                      // by register encoding, %esp and %ebp included
+    bool    (*readMemory)(int64_t, void*, int);         // copies guest memory out, FALSE if it isn't all there
+    int     (*stepCount)();                             // instructions run so far, the current one included
+} ESPluginHost;
+
+typedef struct ESPluginCallbacks {
+    void *context;
+
+    void (*runStarted)(void*, int run);
+    void (*instruction)(void*, int64_t address, uint8_t instruction);     // before it runs
+    void (*blockEntered)(void*, int64_t address);                          // before the instruction callback
+    void (*memoryRead)(void*, int64_t address, int length);                // after the read, the stack's included
+    void (*memoryWrite)(void*, int64_t address, int length);               // after the write, so the new value is there
+    void (*call)(void*, int64_t target, int64_t returnAddress);
+    void (*ret)(void*, int64_t returnAddress);
+    void (*fault)(void*, int64_t address, const char *status);             // the run ended on ADR or INS
+    void (*halt)(void*, int64_t address);
+} ESPluginCallbacks;
+
+typedef bool (*ESPluginEntry)(const ESPluginHost*, ESPluginCallbacks*);
+
+#endif /* defined(__Eighty_Sixer__ESpluginAPI__) */
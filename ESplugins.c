@@ -0,0 +1,200 @@
+//
+//  ESplugins.c
+//  Eighty-Sixer
+//
+//  Created by agent on 10/19/26.
+//  Copyright (c) 2026 agent. All rights reserved.
+//
+
+#define _POSIX_C_SOURCE 200809L                 // strdup() under -std=c99
+#include "ESplugins.h"
+#include "main.h"
+#include <dlfcn.h>
+
+/*  The host side of the plugins of --plugin, see ESpluginAPI.h for the side they see. Loading one that subscribes
+    to anything turns on INSTRUMENT_PLUGIN, and selectInterpreter() then picks a variant whose hooks call in here.
+    Without plugins none of this is reached: the variant chosen has no plugin hooks compiled in at all.
+
+    A basic block is entered at the first step of a run, after any jXX, call or ret whether it jumped or not, and at
+    every leader of the control flow graph when there is one.
+ */
+
+const char *pluginPaths[MAX_PLUGINS];           // from the command line, loaded by alpha()
+int pluginPathCount = 0;
+
+ESPluginHost pluginHosts[MAX_PLUGINS];
+ESPluginCallbacks plugins[MAX_PLUGINS];
+int pluginCount = 0;
+unsigned int pluginEvents = 0;                  // PLUGIN_ bits, any plugin's subscriptions
+
+const ControlFlowGraph *pluginGraph = NULL;     // for the leaders, Y86 only
+bool pluginBlockEnded = true;                   // the last step ended a basic block, or there wasn't one
+
+
+int64_t pluginRegisterValue(int index){
+    if (wordBits == 64) {
+        int64_t *value = registerAtIndex64(index);
+        return value ? *value : 0;
+    }
+
+    int *value = registerAtIndex(index);
+    return value ? *value : 0;
+}
+
+
+bool pluginReadMemory(int64_t address, void *buffer, int length){
+    if (address < 0 || length < 0 || address + length > requestedSize) return false;
+
+    memcpy(buffer, sandboxFloor + address, length);
+    return true;
+}
+
+
+int pluginStepCount(){
+    return stepCount;
+}
+
+
+/**
+ *  Loads a plugin and lets it subscribe.
+ *
+ *  @param specification the shared object's path, then = and the plugin's argument if it takes one
+ *
+ *  @return FALSE if it could not be loaded or it turned the machine down
+ */
+bool loadPlugin(const char *specification){
+    char path[1024];
+    snprintf(path, sizeof(path), "%s", specification);
+
+    char *argument = strchr(path, '=');
+    if (argument) *argument++ = '\0';
+
+    if (pluginCount == MAX_PLUGINS) {
+        printf("\n\nNo more than %d plugins.", MAX_PLUGINS);
+        return false;
+    }
+
+    void *library = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+    if (!library) {
+        printf("\n\nCould not load plugin %s: %s", path, dlerror());
+        return false;
+    }
+
+    ESPluginEntry entry = (ESPluginEntry)dlsym(library, ES_PLUGIN_ENTRY);
+    if (!entry) {
+        printf("\n\nPlugin %s has no %s()", path, ES_PLUGIN_ENTRY);
+        dlclose(library);
+        return false;
+    }
+
+    ESPluginHost *host = &pluginHosts[pluginCount];            // plugins may keep it, and the argument
+    host->apiVersion    = ES_PLUGIN_API_VERSION;
+    host->wordBits      = wordBits;
+    host->argument      = argument ? strdup(argument) : NULL;
+    host->registerValue = pluginRegisterValue;
+    host->readMemory    = pluginReadMemory;
+    host->stepCount     = pluginStepCount;
+
+    ESPluginCallbacks *callbacks = &plugins[pluginCount];
+    memset(callbacks, 0, sizeof(ESPluginCallbacks));
+
+    if (!entry(host, callbacks)) {
+        printf("\n\nPlugin %s would not start.", path);
+        return false;
+    }
+
+    pluginCount++;
+
+    if (callbacks->instruction)  pluginEvents |= PLUGIN_INSTRUCTION;
+    if (callbacks->blockEntered) pluginEvents |= PLUGIN_BLOCK;
+    if (callbacks->memoryRead)   pluginEvents |= PLUGIN_READ;
+    if (callbacks->memoryWrite)  pluginEvents |= PLUGIN_WRITE;
+    if (callbacks->call)         pluginEvents |= PLUGIN_CALL;
+    if (callbacks->ret)          pluginEvents |= PLUGIN_RETURN;
+
+    if (verbose) printf("\nLoaded plugin %s\n", path);
+
+    return true;
+}
+
+
+void pluginRunStarted(int run){
+    pluginGraph = wordBits == 32 ? programControlFlow() : NULL;
+    pluginBlockEnded = true;
+
+    for (int i = 0; i < pluginCount; i++) {
+        if (plugins[i].runStarted) plugins[i].runStarted(plugins[i].context, run);
+    }
+}
+
+
+/**
+ *  The instruction and block events for one step, before it runs.
+ *
+ *  @param address     the instruction's address
+ *  @param instruction its icode/ifun byte
+ */
+void pluginStep(int64_t address, uint8_t instruction){
+    if (pluginEvents & PLUGIN_BLOCK) {
+        bool leader = pluginGraph && address < pluginGraph->imageLength && pluginGraph->leader[address];
+
+        if (pluginBlockEnded || leader) {
+            for (int i = 0; i < pluginCount; i++) {
+                if (plugins[i].blockEntered) plugins[i].blockEntered(plugins[i].context, address);
+            }
+        }
+
+        uint8_t icode = instruction >> 4;
+        pluginBlockEnded = icode == 7 || icode == 8 || icode == 9;
+    }
+
+    if (pluginEvents & PLUGIN_INSTRUCTION) {
+        for (int i = 0; i < pluginCount; i++) {
+            if (plugins[i].instruction) plugins[i].instruction(plugins[i].context, address, instruction);
+        }
+    }
+}
+
+
+void pluginMemoryRead(int64_t address, int length){
+    for (int i = 0; i < pluginCount; i++) {
+        if (plugins[i].memoryRead) plugins[i].memoryRead(plugins[i].context, address, length);
+    }
+}
+
+
+void pluginMemoryWrite(int64_t address, int length){
+    for (int i = 0; i < pluginCount; i++) {
+        if (plugins[i].memoryWrite) plugins[i].memoryWrite(plugins[i].context, address, length);
+    }
+}
+
+
+void pluginCall(int64_t target, int64_t returnAddress){
+    for (int i = 0; i < pluginCount; i++) {
+        if (plugins[i].call) plugins[i].call(plugins[i].context, target, returnAddress);
+    }
+}
+
+
+void pluginReturn(int64_t returnAddress){
+    for (int i = 0; i < pluginCount; i++) {
+        if (plugins[i].ret) plugins[i].ret(plugins[i].context, returnAddress);
+    }
+}
+
+
+/**
+ *  Tells every plugin how the run ended: a halt for HLT, or for a program that ran off its end, and a fault
+ *  otherwise.
+ *
+ *  @param address the program counter
+ *  @param halted  TRUE if it ended without a fault
+ *  @param status  the status the trace shows
+ */
+void pluginRunFinished(int64_t address, bool halted, const char *status){
+    for (int i = 0; i < pluginCount; i++) {
+        if (halted && plugins[i].halt) plugins[i].halt(plugins[i].context, address);
+        if (!halted && plugins[i].fault) plugins[i].fault(plugins[i].context, address, status);
+    }
+}
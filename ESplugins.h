@@ -0,0 +1,40 @@
+//
+//  ESplugins.h
+//  Eighty-Sixer
+//
+//  Created by agent on 10/19/26.
+//  Copyright (c) 2026 agent. All rights reserved.
+//
+
+#ifndef __Eighty_Sixer__ESplugins__
+#define __Eighty_Sixer__ESplugins__
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "ESpluginAPI.h"
+
+#define MAX_PLUGINS             8
+
+#define PLUGIN_INSTRUCTION      0x01        // the events some loaded plugin subscribes to, see pluginEvents
+#define PLUGIN_BLOCK            0x02
+#define PLUGIN_READ             0x04
+#define PLUGIN_WRITE            0x08
+#define PLUGIN_CALL             0x10
+#define PLUGIN_RETURN           0x20
+
+extern const char *pluginPaths[MAX_PLUGINS];
+extern int pluginPathCount;
+extern int pluginCount;
+extern unsigned int pluginEvents;
+
+bool loadPlugin(const char*);
+void pluginRunStarted(int);
+void pluginStep(int64_t, uint8_t);
+void pluginMemoryRead(int64_t, int);
+void pluginMemoryWrite(int64_t, int);
+void pluginCall(int64_t, int64_t);
+void pluginReturn(int64_t);
+void pluginRunFinished(int64_t, bool, const char*);
+
+#endif /* defined(__Eighty_Sixer__ESplugins__) */
@@ -0,0 +1,319 @@
+//
+//  ESprofiler.c
+//  Eighty-Sixer
+//
+//  Created by agent on 10/19/26.
+//  Copyright (c) 2026 agent. All rights reserved.
+//
+
+#include "ESprofiler.h"
+#include "main.h"
+
+typedef struct CallPath {
+    int  address;                   // the function this path ends in
+    int  parent;                    // index of the calling path, -1 for the root
+    int  firstChild;
+    int  nextSibling;
+    long calls;
+    long inclusiveSteps;            // steps spent in the function and everything it called
+    long exclusiveSteps;            // steps spent in the function itself
+} CallPath;
+
+typedef struct ShadowFrame {
+    int  path;
+    int  returnAddress;
+    long entryStep;
+    long calleeSteps;               // inclusive steps of everything called from this frame so far
+} ShadowFrame;
+
+typedef struct Symbol {
+    int  address;
+    char name[64];
+} Symbol;
+
+bool profiling = false;
+const char *profilePath = "Eighty-Sixer.folded";
+const char *symbolMapPath = NULL;
+
+CallPath *paths = NULL;
+int pathCount = 0;
+int pathCapacity = 0;
+
+ShadowFrame *shadowStack = NULL;
+int shadowDepth = 0;
+int shadowCapacity = 0;
+
+Symbol *symbols = NULL;
+int symbolCount = 0;
+
+
+/**
+ *  Reads a symbol map, one symbol per line. Either "ADDRESS NAME" or nm style "ADDRESS TYPE NAME",
+ *  with the address in hex. Lines that don't parse are skipped.
+ *
+ *  @param path the symbol map file
+ *
+ *  @return FALSE if the file could not be read
+ */
+bool loadSymbolMap(const char *path){
+    FILE *file = fopen(path, "r");
+    if (!file) return false;
+
+    char line[256];
+    while (fgets(line, sizeof(line), file)) {
+        unsigned int address;
+        char first[64], second[64];
+
+        int fields = sscanf(line, "%x %63s %63s", &address, first, second);
+        if (fields < 2) continue;
+
+        if (!addSymbol((int)address, fields == 3 ? second : first)) break;
+    }
+
+    fclose(file);
+    return true;
+}
+
+
+/**
+ *  Adds one symbol to the map, e.g. a label from the assembler.
+ *
+ *  @param address the guest address
+ *  @param name    the symbol, cut to 63 characters
+ *
+ *  @return FALSE if memory ran out
+ */
+bool addSymbol(int address, const char *name){
+    Symbol *grown = realloc(symbols, (symbolCount + 1) * sizeof(Symbol));
+    if (!grown) return false;
+    symbols = grown;
+
+    symbols[symbolCount].address = address;
+    snprintf(symbols[symbolCount].name, sizeof(symbols[symbolCount].name), "%s", name);
+    symbolCount++;
+
+    return true;
+}
+
+
+/**
+ *  Looks a symbol up by name.
+ *
+ *  @param name    the symbol
+ *  @param address set to its address
+ *
+ *  @return FALSE if there is no such symbol
+ */
+bool addressForSymbol(const char *name, int *address){
+    for (int i = 0; i < symbolCount; i++) {
+        if (strcmp(symbols[i].name, name)) continue;
+
+        *address = symbols[i].address;
+        return true;
+    }
+
+    return false;
+}
+
+
+/**
+ *  Names an address using the symbol map: the symbol itself, symbol+offset inside one, or plain hex.
+ *
+ *  @param address the guest address
+ *  @param buffer  where to put the name
+ *  @param size    the size of buffer
+ *
+ *  @return buffer
+ */
+const char *symbolForAddress(int address, char *buffer, size_t size){
+    Symbol *nearest = NULL;
+
+    for (int i = 0; i < symbolCount; i++) {
+        if (symbols[i].address <= address && (!nearest || symbols[i].address > nearest->address)) nearest = &symbols[i];
+    }
+
+    if (!nearest) snprintf(buffer, size, "0x%x", address);
+    else if (nearest->address == address) snprintf(buffer, size, "%s", nearest->name);
+    else snprintf(buffer, size, "%s+0x%x", nearest->name, address - nearest->address);
+
+    return buffer;
+}
+
+
+/**
+ *  Finds the path for calling the given function from the given path, creating it on first use.
+ */
+int childPath(int parent, int address){
+    int child = parent >= 0 ? paths[parent].firstChild : -1;
+
+    for (; child >= 0; child = paths[child].nextSibling) {
+        if (paths[child].address == address) return child;
+    }
+
+    if (pathCount == pathCapacity) {
+        int capacity = pathCapacity ? pathCapacity * 2 : 256;
+        CallPath *grown = realloc(paths, capacity * sizeof(CallPath));
+        if (!grown) quit(PROGRAM_ERROR);
+
+        paths = grown;
+        pathCapacity = capacity;
+    }
+
+    CallPath *path = &paths[pathCount];
+    memset(path, 0, sizeof(CallPath));
+    path->address = address;
+    path->parent = parent;
+    path->firstChild = -1;
+    path->nextSibling = -1;
+
+    if (parent >= 0) {
+        path->nextSibling = paths[parent].firstChild;
+        paths[parent].firstChild = pathCount;
+    }
+
+    return pathCount++;
+}
+
+
+void pushShadowFrame(int path, int returnAddress){
+    if (shadowDepth == shadowCapacity) {
+        int capacity = shadowCapacity ? shadowCapacity * 2 : 256;
+        ShadowFrame *grown = realloc(shadowStack, capacity * sizeof(ShadowFrame));
+        if (!grown) quit(PROGRAM_ERROR);
+
+        shadowStack = grown;
+        shadowCapacity = capacity;
+    }
+
+    ShadowFrame *frame = &shadowStack[shadowDepth++];
+    frame->path = path;
+    frame->returnAddress = returnAddress;
+    frame->entryStep = stepCount;
+    frame->calleeSteps = 0;
+
+    paths[path].calls++;
+}
+
+
+/**
+ *  Closes the top shadow frame, charging its steps to its call path and to its caller's callee total.
+ */
+void popShadowFrame(){
+    ShadowFrame *frame = &shadowStack[--shadowDepth];
+    long inclusive = stepCount - frame->entryStep;
+
+    paths[frame->path].inclusiveSteps += inclusive;
+    paths[frame->path].exclusiveSteps += inclusive - frame->calleeSteps;
+
+    if (shadowDepth > 0) shadowStack[shadowDepth - 1].calleeSteps += inclusive;
+}
+
+
+/**
+ *  Starts a fresh shadow stack for a run. The program's entry point is the root of every call path.
+ *  Paths and their counts carry over from earlier runs.
+ */
+void startProfile(){
+    shadowDepth = 0;
+
+    int root = pathCount ? 0 : childPath(-1, physicalToRelativeAddress((int *)currentInstructionByte));
+    pushShadowFrame(root, -1);
+}
+
+
+/**
+ *  Called by call() once it has pushed the return address and jumped.
+ *
+ *  @param target        the function being called
+ *  @param returnAddress where the matching ret should land
+ */
+void profileCall(int target, int returnAddress){
+    if (shadowDepth == 0) startProfile();
+
+    pushShadowFrame(childPath(shadowStack[shadowDepth - 1].path, target), returnAddress);
+}
+
+
+/**
+ *  Called by ret() once it has popped the return address. Normally this closes the top frame. If the program
+ *  returned somewhere other than where the top frame expected, e.g. after unwinding by hand, we close frames
+ *  until we find the one it matches. A return nobody called for is ignored.
+ *
+ *  @param target the address ret jumped to
+ */
+void profileReturn(int target){
+    int depth = shadowDepth - 1;
+    while (depth > 0 && shadowStack[depth].returnAddress != target) depth--;
+
+    if (depth <= 0) return;
+
+    while (shadowDepth > depth) popShadowFrame();
+}
+
+
+/**
+ *  Writes the call path of one node in folded form: root;caller;callee
+ */
+void writeFoldedPath(FILE *file, int path){
+    char name[96];
+
+    if (paths[path].parent >= 0) {
+        writeFoldedPath(file, paths[path].parent);
+        fputc(';', file);
+    }
+
+    symbolForAddress(paths[path].address, name, sizeof(name));
+    for (char *c = name; *c; c++) {
+        if (*c == ';' || *c == ' ') *c = '_';           // both are separators in the folded format
+    }
+
+    fputs(name, file);
+}
+
+
+/**
+ *  Closes every open frame at the current step and writes the profile: one folded stack line per call path
+ *  with its exclusive steps, which flamegraph.pl and friends read directly. A table of the busiest paths by
+ *  inclusive steps goes to standard output.
+ */
+void finishProfile(){
+    while (shadowDepth > 0) popShadowFrame();
+
+    FILE *file = fopen(profilePath, "w");
+    if (!file) {
+        printf("\nCould not write profile to %s\n", profilePath);
+        return;
+    }
+
+    for (int i = 0; i < pathCount; i++) {
+        if (paths[i].exclusiveSteps <= 0) continue;
+
+        writeFoldedPath(file, i);
+        fprintf(file, " %ld\n", paths[i].exclusiveSteps);
+    }
+
+    fclose(file);
+
+    printf("\nCall paths by inclusive steps (folded stacks written to %s):\n", profilePath);
+    printf("%14s %14s %10s  %s\n", "inclusive", "exclusive", "calls", "function");
+
+    bool *shown = calloc(pathCount, sizeof(bool));
+    for (int row = 0; row < 20 && row < pathCount && shown; row++) {
+        int busiest = -1;
+
+        for (int i = 0; i < pathCount; i++) {
+            if (!shown[i] && (busiest < 0 || paths[i].inclusiveSteps > paths[busiest].inclusiveSteps)) busiest = i;
+        }
+
+        char name[96];
+        int depth = 0;
+        for (int p = paths[busiest].parent; p >= 0; p = paths[p].parent) depth++;
+
+        printf("%14ld %14ld %10ld  %*s%s\n", paths[busiest].inclusiveSteps, paths[busiest].exclusiveSteps,
+               paths[busiest].calls, depth * 2, "", symbolForAddress(paths[busiest].address, name, sizeof(name)));
+
+        shown[busiest] = true;
+    }
+
+    free(shown);
+}
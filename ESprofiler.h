@@ -0,0 +1,30 @@
+//
+//  ESprofiler.h
+//  Eighty-Sixer
+//
+//  Created by agent on 10/19/26.
+//  Copyright (c) 2026 agent. All rights reserved.
+//
+
+#ifndef __Eighty_Sixer__ESprofiler__
+#define __Eighty_Sixer__ESprofiler__
+
+#include <stdio.h>
+#include <stdbool.h>
+
+extern bool profiling;
+extern const char *profilePath;
+extern const char *symbolMapPath;
+extern int symbolCount;
+
+bool loadSymbolMap(const char*);
+bool addSymbol(int, const char*);
+bool addressForSymbol(const char*, int*);
+const char *symbolForAddress(int, char*, size_t);
+
+void startProfile();
+void profileCall(int, int);
+void profileReturn(int);
+void finishProfile();
+
+#endif /* defined(__Eighty_Sixer__ESprofiler__) */
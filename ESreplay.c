@@ -0,0 +1,369 @@
+//
+//  ESreplay.c
+//  Eighty-Sixer
+//
+//  Created by agent on 10/19/26.
+//  Copyright (c) 2026 agent. All rights reserved.
+//
+
+#include "ESreplay.h"
+#include "main.h"
+
+#define REPLAY_MAGIC        "ES86RPLY"
+#define REPLAY_VERSION      1
+
+/*  Record and replay. Everything the machine does follows from the program, the options and what comes in from
+    outside it, so --record FILE logs only what comes in from outside: console input, and what the file traps
+    returned along with the bytes their reads brought in. --replay FILE runs the same program again with those
+    taken from the log instead of the host, and no host file is touched. Nothing is logged per step, so a log
+    grows with the events and recording costs nothing between them.
+
+    The steps device is the only clock a guest has, and it's already deterministic. So are the order file
+    requests finish in, since a buffer belongs to the host until its ticket is waited for: a read's bytes are
+    logged when the guest waits for it and land then on a replay.
+
+    Every event carries the step it happened at and every run ends with a digest of the registers, flags and
+    console output, so a replay that goes a different way says where instead of carrying on.
+
+    FILE LAYOUT
+        ReplayHeader
+        events, see REPLAY EVENTS in ESreplay.h
+ */
+
+typedef struct ReplayHeader {
+    char     magic[8];
+    uint32_t version;
+    int32_t  wordBits;
+    uint32_t isaExtensions;
+    int32_t  imageLength;
+    uint64_t imageChecksum;         // FNV-1a over the pristine image
+} ReplayHeader;
+
+const char *recordPath = NULL;
+const char *replayPath = NULL;
+
+FILE *replayLog = NULL;
+int  lastEventStep = 0;
+long replayedEvents = 0;
+
+int  pendingKind = 0;               // the event read ahead on a replay, 0 if there's none, EOF at the end of the log
+int  pendingStep = 0;
+
+
+/**
+ *  Names an event for a divergence report.
+ */
+const char *describeEvent(int kind){
+    switch (kind) {
+        case REPLAY_INPUT:      return "console input";
+        case REPLAY_INPUT_END:  return "the end of the console input";
+        case REPLAY_TRAP:       return "a file trap";
+        case REPLAY_FILE_DATA:  return "a file read";
+        case REPLAY_RUN_END:    return "the end of the run";
+        case EOF:               return "the end of the log";
+
+        default:
+            return "something it doesn't know";
+    }
+}
+
+
+/** WRITING **/
+
+void writeNumber(uint64_t value){
+    do {
+        uint8_t byte = value & 0x7F;
+        value >>= 7;
+        putc(byte | (value ? 0x80 : 0), replayLog);
+    } while (value);
+}
+
+
+void writeSignedNumber(int64_t value){
+    writeNumber(((uint64_t)value << 1) ^ (uint64_t)(value >> 63));
+}
+
+
+void writeEvent(int kind){
+    putc(kind, replayLog);
+    writeSignedNumber((int64_t)stepCount - lastEventStep);
+    lastEventStep = stepCount;
+}
+
+
+/** READING **/
+
+bool readNumber(uint64_t *value){
+    *value = 0;
+
+    for (int shift = 0; shift < 64; shift += 7) {
+        int byte = getc(replayLog);
+        if (byte == EOF) return false;
+
+        *value |= (uint64_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) return true;
+    }
+
+    return false;
+}
+
+
+bool readSignedNumber(int64_t *value){
+    uint64_t bits;
+    if (!readNumber(&bits)) return false;
+
+    *value = (int64_t)(bits >> 1) ^ -(int64_t)(bits & 1);
+    return true;
+}
+
+
+/**
+ *  Says where a replay went a different way from the recording, and stops replaying.
+ *
+ *  @param wanted what the replay asked the log for
+ */
+void reportReplayDivergence(const char *wanted){
+    int recordedKind = pendingKind ? pendingKind : EOF;            // none read ahead means the payload was cut short
+    int recordedStep = pendingStep;
+
+    fclose(replayLog);
+    replayLog = NULL;
+    replayPath = NULL;                      // so the trace and the end of the run don't come back here
+    runCount = 0;
+
+    if (recordedKind == EOF) {
+        printf("\n\nThe replay diverged at step %d: it asked for %s after the recording ended.", stepCount, wanted);
+    } else if (recordedStep != stepCount) {
+        printf("\n\nThe replay diverged at step %d: the recording has %s at step %d.", stepCount, describeEvent(recordedKind), recordedStep);
+    } else {
+        printf("\n\nThe replay diverged at step %d: it asked for %s, the recording has %s.", stepCount, wanted, describeEvent(recordedKind));
+    }
+}
+
+
+/**
+ *  Gives up on a replay part way through a run. The run ends there, with its trace, and no more runs follow.
+ */
+void replayDiverged(const char *wanted){
+    reportReplayDivergence(wanted);
+    quit(PROGRAM_ERROR);
+}
+
+
+/**
+ *  Reads the next event's kind and step, if they aren't read already.
+ */
+int peekEvent(){
+    if (pendingKind) return pendingKind;
+
+    int64_t delta;
+    pendingKind = getc(replayLog);
+    if (pendingKind == EOF || pendingKind == 0 || !readSignedNumber(&delta)) {
+        pendingKind = EOF;
+        return EOF;
+    }
+
+    pendingStep = (int)(lastEventStep + delta);
+    return pendingKind;
+}
+
+
+/**
+ *  Takes the next event, which has to be the given kind at this step. Its payload is the caller's to read.
+ */
+void takeEvent(int kind){
+    if (peekEvent() != kind || pendingStep != stepCount) replayDiverged(describeEvent(kind));
+
+    lastEventStep = pendingStep;
+    pendingKind = 0;
+    replayedEvents++;
+}
+
+
+/** THE LOG **/
+
+void describeImage(ReplayHeader *header){
+    memset(header, 0, sizeof(*header));
+    memcpy(header->magic, REPLAY_MAGIC, sizeof(header->magic));
+    header->version       = REPLAY_VERSION;
+    header->wordBits      = wordBits;
+    header->isaExtensions = isaExtensions;
+    header->imageLength   = pristineImageLength;
+    header->imageChecksum = checksumBytes(0xCBF29CE484222325ULL, pristineImage, pristineImageLength);
+}
+
+
+/**
+ *  Opens the --record or --replay log, once the program is loaded. A replay has to be of the same program with
+ *  the same extensions, though it takes the trap from the recording and doesn't need --files.
+ *
+ *  @return FALSE if the log can't be opened, or is of a different program
+ */
+bool openRecording(){
+    ReplayHeader header, recorded;
+    describeImage(&header);
+
+    if (recordPath) {
+        replayLog = fopen(recordPath, "wb");
+        if (!replayLog || fwrite(&header, sizeof(header), 1, replayLog) != 1) {
+            printf("\n\nCould not write the recording %s", recordPath);
+            return false;
+        }
+
+        return true;
+    }
+
+    replayLog = fopen(replayPath, "rb");
+    if (!replayLog || fread(&recorded, sizeof(recorded), 1, replayLog) != 1
+        || memcmp(recorded.magic, REPLAY_MAGIC, sizeof(recorded.magic)) || recorded.version != REPLAY_VERSION) {
+        printf("\n\n%s is not a recording.", replayPath);
+        return false;
+    }
+
+    if (recorded.wordBits != header.wordBits || (recorded.isaExtensions & ~EXTENSION_TRAP) != (header.isaExtensions & ~EXTENSION_TRAP)) {
+        printf("\n\n%s was recorded with different --y86-64 or --extend options.", replayPath);
+        return false;
+    }
+
+    if (recorded.imageLength != header.imageLength || recorded.imageChecksum != header.imageChecksum) {
+        printf("\n\n%s is a recording of a different program.", replayPath);
+        return false;
+    }
+
+    isaExtensions |= recorded.isaExtensions & EXTENSION_TRAP;
+    return true;
+}
+
+
+/** EVENTS **/
+
+void recordInput(int character){
+    if (character == EOF) {
+        writeEvent(REPLAY_INPUT_END);
+    } else {
+        writeEvent(REPLAY_INPUT);
+        putc(character, replayLog);
+    }
+}
+
+
+/**
+ *  The next byte of console input, from the log.
+ *
+ *  @return the byte, or EOF where the recorded input ran out
+ */
+int replayInput(){
+    if (peekEvent() == REPLAY_INPUT_END) {
+        takeEvent(REPLAY_INPUT_END);
+        return EOF;
+    }
+
+    takeEvent(REPLAY_INPUT);
+
+    int character = getc(replayLog);
+    if (character == EOF) replayDiverged("console input");
+
+    return character;
+}
+
+
+void recordTrap(int64_t result){
+    writeEvent(REPLAY_TRAP);
+    writeSignedNumber(result);
+}
+
+
+/**
+ *  Stands in for a file trap: puts back whatever reads finished into guest memory before it returned, then
+ *  gives its result.
+ *
+ *  @return the result for %eax
+ */
+int64_t replayTrap(){
+    uint64_t address, length;
+
+    while (peekEvent() == REPLAY_FILE_DATA) {
+        takeEvent(REPLAY_FILE_DATA);
+
+        if (!readNumber(&address) || !readNumber(&length) || address + length > (uint64_t)requestedSize) replayDiverged("a file read");
+
+        markBlockDirty((int)address, (int)length);
+        if (fread(sandboxFloor + address, 1, length, replayLog) != length) replayDiverged("a file read");
+    }
+
+    int64_t result;
+    takeEvent(REPLAY_TRAP);
+    if (!readSignedNumber(&result)) replayDiverged("a file trap");
+
+    return result;
+}
+
+
+/**
+ *  Logs the bytes a file read brought in, when the guest waits for it.
+ *
+ *  @param address where they landed in guest memory
+ *  @param bytes   the bytes
+ *  @param length  how many
+ */
+void recordFileData(int64_t address, const uint8_t *bytes, int64_t length){
+    writeEvent(REPLAY_FILE_DATA);
+    writeNumber((uint64_t)address);
+    writeNumber((uint64_t)length);
+    fwrite(bytes, 1, (size_t)length, replayLog);
+}
+
+
+/**
+ *  A digest of what a run left behind: the program counter, registers, flags and how much it wrote.
+ */
+uint64_t digestMachine(){
+    int64_t state[20] = { 0 };
+    int count = 0;
+
+    state[count++] = currentInstructionByte - sandboxFloor;
+    state[count++] = devices.consoleWritten;
+    state[count++] = (zeroFlag << 2) | (signFlag << 1) | overflowFlag;
+
+    if (wordBits == 64) {
+        for (int i = 0; i < 15; i++) state[count++] = *registerAtIndex64(i);
+    } else {
+        for (int i = 0; i < 8; i++) state[count++] = *registerAtIndex(i);
+    }
+
+    return checksumBytes(0xCBF29CE484222325ULL, (const uint8_t *)state, count * sizeof(int64_t));
+}
+
+
+/**
+ *  Ends a run in the log: records how it ended, or checks the replay ended the same way.
+ *
+ *  @param faultCode how the run ended
+ */
+void finishRecordedRun(int faultCode){
+    uint64_t digest = digestMachine(), recordedDigest = 0, recordedFault;
+
+    if (recordPath) {
+        writeEvent(REPLAY_RUN_END);
+        writeNumber((uint64_t)faultCode);
+        fwrite(&digest, sizeof(digest), 1, replayLog);
+        fflush(replayLog);
+        return;
+    }
+
+    if (peekEvent() != REPLAY_RUN_END || pendingStep != stepCount) {       // the trace is already out, so no second one
+        reportReplayDivergence(describeEvent(REPLAY_RUN_END));
+        exit(1);
+    }
+
+    takeEvent(REPLAY_RUN_END);
+
+    if (!readNumber(&recordedFault) || fread(&recordedDigest, sizeof(recordedDigest), 1, replayLog) != 1
+        || recordedFault != (uint64_t)faultCode || recordedDigest != digest) {
+        printf("\n\nThe replay diverged: the run ended at step %d as recorded, but not in the same state.", stepCount);
+        exit(1);
+    }
+
+    printf("\n\nReplay matched the recording: %ld event(s).", replayedEvents);
+    replayedEvents = 0;
+}
@@ -0,0 +1,43 @@
+//
+//  ESreplay.h
+//  Eighty-Sixer
+//
+//  Created by agent on 10/19/26.
+//  Copyright (c) 2026 agent. All rights reserved.
+//
+
+#ifndef __Eighty_Sixer__ESreplay__
+#define __Eighty_Sixer__ESreplay__
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/* REPLAY EVENTS
+    Each is its kind, then the step it happened at as a zigzag varint difference from the last event's, then
+
+    REPLAY_INPUT        the byte                                     a byte of console input
+    REPLAY_INPUT_END                                                 console input ran out
+    REPLAY_TRAP         the result, a zigzag varint                  a file trap returned
+    REPLAY_FILE_DATA    address and length as varints, the bytes     a file read finished into guest memory
+    REPLAY_RUN_END      the FaultCode as a varint, an 8 byte digest  one of the --runs ended
+ */
+#define REPLAY_INPUT        1
+#define REPLAY_INPUT_END    2
+#define REPLAY_TRAP         3
+#define REPLAY_FILE_DATA    4
+#define REPLAY_RUN_END      5
+
+extern const char *recordPath;              // see --record
+extern const char *replayPath;              // see --replay
+
+bool openRecording();
+
+void    recordInput(int);                   // a byte, or EOF
+int     replayInput();
+void    recordTrap(int64_t);
+int64_t replayTrap();
+void    recordFileData(int64_t, const uint8_t*, int64_t);
+void    finishRecordedRun(int);             // a FaultCode, from omega()
+
+#endif /* defined(__Eighty_Sixer__ESreplay__) */
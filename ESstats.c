@@ -0,0 +1,132 @@
+//
+//  ESstats.c
+//  Eighty-Sixer
+//
+//  Created by agent on 10/19/26.
+//  Copyright (c) 2026 agent. All rights reserved.
+//
+
+#define _POSIX_C_SOURCE 200809L                 // clock_gettime() under -std=c99
+#include "ESstats.h"
+#include "main.h"
+#include <time.h>
+#include <inttypes.h>
+#include <sys/resource.h>
+
+const char *statsPath = NULL;           // where the report goes, see --stats
+bool collectingStats = false;
+
+uint64_t instructionCounts[256];        // by icode/ifun byte, bumped once per step and nothing else
+int64_t  lowestStackPointer;            // the deepest %esp a push or call reached, INT64_MAX before the first
+int64_t  stackBase;                     // %esp just before the first push or call, wherever the program put it
+int64_t  dataHighWater;                 // one past the highest byte rmmovl, memcpy or memset wrote
+
+int statsRun = -1;                      // -1 until a run starts, so a program that never loads reports nothing
+struct timespec statsStarted;
+
+const char *icodeNames[16] = {
+    "halt", "nop", "rrmov", "irmov", "rmmov", "mrmov", "op", "jump",
+    "call", "ret", "push", "pop", "iadd", "leave", "block", "trap"
+};
+
+
+/**
+ *  Clears the counters for a new run and starts its clock.
+ *
+ *  @param run the zero-based run number
+ */
+void startStats(int run){
+    memset(instructionCounts, 0, sizeof(instructionCounts));
+
+    lowestStackPointer = INT64_MAX;
+    stackBase          = 0;
+    dataHighWater      = 0;
+
+    statsRun = run;
+    clock_gettime(CLOCK_MONOTONIC, &statsStarted);
+}
+
+
+/**
+ *  A push or call took %esp lower than it has been this run. The first one says where the stack starts, since a
+ *  program that sets up its own stack leaves the one it was loaded with alone.
+ *
+ *  @param before %esp before the push
+ */
+void stackLowered(int64_t before){
+    if (lowestStackPointer == INT64_MAX) stackBase = before;
+
+    lowestStackPointer = before - (wordBits == 64 ? 8 : 4);
+}
+
+
+uint64_t countForIcode(int icode){
+    uint64_t count = 0;
+    for (int ifun = 0; ifun < 16; ifun++) count += instructionCounts[icode << 4 | ifun];
+
+    return count;
+}
+
+
+/**
+ *  Appends the report for the run that just finished to the stats file, as one line of JSON: the instruction mix
+ *  by icode and by icode/ifun byte, the guest loads and stores those instructions made, how far pushes and calls
+ *  took the stack below where the first of them found it, one past the highest byte rmmovl, memcpy or memset wrote
+ *  (pushes, calls and file reads aren't counted there), and the wall clock time, guest MIPS and host peak RSS. With
+ *  --memoize the steps it skipped are reported on their own and left out of the MIPS. The first run starts the
+ *  file afresh, later ones add a line each.
+ *
+ *  @param status the run's status, as printHarmonFormattedTrace() prints it
+ */
+void finishStats(const char *status){
+    if (statsRun < 0) return;
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    double seconds = (now.tv_sec - statsStarted.tv_sec) + (now.tv_nsec - statsStarted.tv_nsec) / 1e9;
+
+    struct rusage usage;
+    long peakKilobytes = getrusage(RUSAGE_SELF, &usage) == 0 ? usage.ru_maxrss : 0;     // kilobytes on Linux
+
+    uint64_t loads  = countForIcode(0x5) + countForIcode(0x9) + countForIcode(0xB) + countForIcode(0xD) + instructionCounts[0xE0];
+    uint64_t stores = countForIcode(0x4) + countForIcode(0x8) + countForIcode(0xA) + instructionCounts[0xE0] + instructionCounts[0xE1];
+
+    FILE *file = fopen(statsPath, statsRun == 0 ? "w" : "a");
+    if (!file) {
+        printf("\nCould not write stats to %s\n", statsPath);
+        return;
+    }
+
+    fprintf(file, "{\"version\":\"%s\",\"run\":%d,\"status\":\"%s\",\"wordBits\":%d,\"steps\":%d,", version, statsRun + 1, status, wordBits, stepCount);
+
+    fprintf(file, "\"icodes\":{");
+    bool first = true;
+    for (int icode = 0; icode < 16; icode++) {
+        uint64_t count = countForIcode(icode);
+        if (!count) continue;
+
+        fprintf(file, "%s\"%s\":%" PRIu64, first ? "" : ",", icodeNames[icode], count);
+        first = false;
+    }
+
+    fprintf(file, "},\"instructions\":{");
+    first = true;
+    for (int byte = 0; byte < 256; byte++) {
+        if (!instructionCounts[byte]) continue;
+
+        fprintf(file, "%s\"%02X\":%" PRIu64, first ? "" : ",", byte, instructionCounts[byte]);
+        first = false;
+    }
+
+    int64_t stackDepth = lowestStackPointer == INT64_MAX ? 0 : stackBase - lowestStackPointer;
+    fprintf(file, "},\"loads\":%" PRIu64 ",\"stores\":%" PRIu64 ",", loads, stores);
+    fprintf(file, "\"stackHighWater\":%" PRId64 ",\"dataHighWater\":%" PRId64 ",", stackDepth, dataHighWater);
+    fprintf(file, "\"pagesWritten\":%d,", activeAddressSpace ? activeAddressSpace->dirtyPageCount : 0);
+    if (memoizing) fprintf(file, "\"memoHits\":%ld,\"memoStepsSkipped\":%ld,", memoHits, memoStepsSkipped);
+
+    long executed = memoizing ? stepCount - memoStepsSkipped : stepCount;         // the steps --memoize skipped never ran
+    fprintf(file, "\"wallSeconds\":%.6f,\"mips\":%.3f,\"hostPeakRssKiB\":%ld}\n", seconds, seconds > 0 ? executed / seconds / 1e6 : 0.0, peakKilobytes);
+
+    fclose(file);
+    statsRun = -1;
+}
@@ -0,0 +1,30 @@
+//
+//  ESstats.h
+//  Eighty-Sixer
+//
+//  Created by agent on 10/19/26.
+//  Copyright (c) 2026 agent. All rights reserved.
+//
+
+#ifndef __Eighty_Sixer__ESstats__
+#define __Eighty_Sixer__ESstats__
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+extern const char *statsPath;
+extern bool collectingStats;
+
+extern uint64_t instructionCounts[256];
+extern int64_t  lowestStackPointer;
+extern int64_t  stackBase;
+extern int64_t  dataHighWater;
+
+extern const char *icodeNames[16];
+
+void startStats(int);
+void stackLowered(int64_t);
+void finishStats(const char*);
+
+#endif /* defined(__Eighty_Sixer__ESstats__) */
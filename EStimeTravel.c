@@ -0,0 +1,410 @@
+//
+//  EStimeTravel.c
+//  Eighty-Sixer
+//
+//  Created by agent on 10/19/26.
+//  Copyright (c) 2026 agent. All rights reserved.
+//
+//  Going backwards is really going forwards from somewhere earlier. Every snapshotInterval steps we keep a
+//  snapshot of the machine; to reach an earlier step we restore the closest snapshot at or before it and
+//  run forward again. The interpreter is deterministic, so the replay lands in exactly the same state.
+//
+
+#include "EStimeTravel.h"
+#include "main.h"
+#include <sys/mman.h>
+
+typedef struct SharedPage {
+    int     references;
+    uint8_t bytes[GUEST_PAGE_SIZE];
+} SharedPage;
+
+typedef struct Snapshot {
+    int             step;
+    ProcessorState  processor;
+    MemoryLayout    memory;
+    DeviceState     devices;
+    SharedPage    **pages;              // one slot per sandbox page, NULL where the page is still pristine
+} Snapshot;
+
+int snapshotInterval = 4096;
+
+Snapshot *snapshots[TIME_TRAVEL_MAX_SNAPSHOTS];     // kept in step order
+int snapshotCount = 0;
+int nextSnapshotStep = 0;
+
+
+void releaseSnapshot(Snapshot *snapshot){
+    for (int i = 0; i < activeAddressSpace->pageCount; i++) {
+        SharedPage *page = snapshot->pages[i];
+        if (page && --page->references == 0) free(page);
+    }
+
+    free(snapshot->pages);
+    free(snapshot);
+}
+
+
+/**
+ *  Makes room for one more snapshot by dropping the one whose loss hurts least. Dropping snapshot j
+ *  leaves a gap from j-1 to j+1; we drop the one where that gap is smallest compared to how far
+ *  the snapshot is from where we are now. Recent history stays dense and older history thins out
+ *  exponentially, so memory stays bounded however long the run.
+ *
+ *  @param now the step we are at
+ */
+void thinSnapshots(int now){
+    int victim = -1;
+    double cheapest = 0;
+
+    for (int j = 1; j < snapshotCount - 1; j++) {               // never the first one, that's where the program started
+        double gap = snapshots[j + 1]->step - snapshots[j - 1]->step;
+        double age = abs(now - snapshots[j]->step) + 1;
+        double cost = gap / age;
+
+        if (victim < 0 || cost < cheapest) {
+            victim = j;
+            cheapest = cost;
+        }
+    }
+
+    if (victim < 0) victim = snapshotCount - 1;
+
+    releaseSnapshot(snapshots[victim]);
+    memmove(&snapshots[victim], &snapshots[victim + 1], (snapshotCount - victim - 1) * sizeof(Snapshot *));
+    snapshotCount--;
+}
+
+
+/**
+ *  Finds the latest snapshot taken at or before the given step.
+ *
+ *  @return its index, or -1 if there is none
+ */
+int snapshotAtOrBefore(int step){
+    int found = -1;
+
+    for (int i = 0; i < snapshotCount && snapshots[i]->step <= step; i++) found = i;
+
+    return found;
+}
+
+
+/**
+ *  Snapshots the machine as it stands. Only pages that differ from the pristine image are kept, and any
+ *  page identical to the one in the previous snapshot is shared with it rather than copied.
+ */
+void takeSnapshot(){
+    int previous = snapshotAtOrBefore(stepCount);
+    if (previous >= 0 && snapshots[previous]->step == stepCount) return;        // already have this one
+
+    AddressSpace *space = activeAddressSpace;
+
+    Snapshot *snapshot = calloc(1, sizeof(Snapshot));
+    if (!snapshot) return;
+
+    snapshot->pages = calloc(space->pageCount, sizeof(SharedPage *));
+    if (!snapshot->pages) {
+        free(snapshot);
+        return;
+    }
+
+    snapshot->step = stepCount;
+    saveProcessorState(&snapshot->processor);
+    saveMemoryLayout(&snapshot->memory);
+    saveDeviceState(&snapshot->devices);
+
+    for (int i = 0; i < space->dirtyPageCount; i++) {
+        int index = space->dirtyPageList[i];
+        uint8_t *bytes = space->floor + ((size_t)index << GUEST_PAGE_SHIFT);
+
+        SharedPage *earlier = previous >= 0 ? snapshots[previous]->pages[index] : NULL;
+
+        if (earlier && !memcmp(earlier->bytes, bytes, GUEST_PAGE_SIZE)) {
+            earlier->references++;
+            snapshot->pages[index] = earlier;
+            continue;
+        }
+
+        SharedPage *page = malloc(sizeof(SharedPage));
+        if (!page) continue;
+
+        page->references = 1;
+        memcpy(page->bytes, bytes, GUEST_PAGE_SIZE);
+        snapshot->pages[index] = page;
+    }
+
+    if (snapshotCount == TIME_TRAVEL_MAX_SNAPSHOTS) thinSnapshots(stepCount);
+
+    int slot = snapshotAtOrBefore(stepCount) + 1;
+    memmove(&snapshots[slot + 1], &snapshots[slot], (snapshotCount - slot) * sizeof(Snapshot *));
+    snapshots[slot] = snapshot;
+    snapshotCount++;
+}
+
+
+/**
+ *  Puts the machine back exactly as it was when the snapshot was taken.
+ */
+void restoreSnapshot(Snapshot *snapshot){
+    AddressSpace *space = activeAddressSpace;
+
+    clearWriteTraps(space);
+    resetAddressSpace(space);                       // back to the pristine image, touching only what was dirtied
+
+    for (int i = 0; i < space->pageCount; i++) {
+        if (!snapshot->pages[i]) continue;
+
+        uint8_t *bytes = space->floor + ((size_t)i << GUEST_PAGE_SHIFT);
+        memcpy(bytes, snapshot->pages[i]->bytes, GUEST_PAGE_SIZE);
+        markPageDirty(bytes);
+        codeWritten((long)i << GUEST_PAGE_SHIFT, GUEST_PAGE_SIZE);     // the program may have changed since, see --writable-code
+    }
+
+    restoreMemoryLayout(&snapshot->memory);
+    restoreProcessorState(&snapshot->processor);
+    restoreDeviceState(&snapshot->devices);
+
+    nextSnapshotStep = (stepCount / snapshotInterval + 1) * snapshotInterval;
+}
+
+
+/**
+ *  Starts recording history from the current state. Call once the program is loaded.
+ */
+void startTimeTravel(){
+    if (snapshotInterval < 1) snapshotInterval = 1;
+
+    while (snapshotCount) releaseSnapshot(snapshots[--snapshotCount]);
+
+    takeSnapshot();
+    nextSnapshotStep = (stepCount / snapshotInterval + 1) * snapshotInterval;
+}
+
+
+/**
+ *  Called by the debugger before every step it runs. One comparison unless a snapshot is due.
+ */
+void takeSnapshotIfDue(){
+    if (stepCount < nextSnapshotStep) return;
+
+    takeSnapshot();
+    nextSnapshotStep = (stepCount / snapshotInterval + 1) * snapshotInterval;
+}
+
+
+/**
+ *  Prints the steps we currently hold snapshots for.
+ */
+void listSnapshots(){
+    printf("%d snapshot(s), one every %d steps when fresh:\n", snapshotCount, snapshotInterval);
+
+    for (int i = 0; i < snapshotCount; i++) {
+        int pages = 0;
+        for (int p = 0; p < activeAddressSpace->pageCount; p++) pages += snapshots[i]->pages[p] != NULL;
+
+        printf("  step %-12d %d page(s)\n", snapshots[i]->step, pages);
+    }
+}
+
+
+/**
+ *  Runs forward until the given step, the end of the program, or a halt.
+ */
+void replayUntil(int step){
+    while (stepCount < step && hasNextInstruction()) {
+        takeSnapshotIfDue();
+        startCycle();
+    }
+}
+
+
+/**
+ *  Moves the machine to the given step, backwards or forwards. Going back restores the nearest earlier
+ *  snapshot and replays from there, so the cost is bounded by the snapshot spacing, not the run length.
+ *
+ *  @param step the step to arrive at
+ *
+ *  @return FALSE if there is no history that reaches back that far
+ */
+bool travelToStep(int step){
+    if (step < 0) step = 0;
+
+    if (step < stepCount) {
+        int index = snapshotAtOrBefore(step);
+        if (index < 0) return false;
+
+        restoreSnapshot(snapshots[index]);
+    }
+
+    replayUntil(step);
+
+    return stepCount == step;
+}
+
+
+/**
+ *  Searches history for the most recent step matching some condition, without ever replaying the whole run.
+ *  Each interval between snapshots is replayed newest first; the first interval with a match has the answer,
+ *  and the machine is left at that step. The probe's startInterval() runs after each snapshot is restored,
+ *  beforeStep() and afterStep() around every replayed step, and finishInterval() once the interval is done.
+ *
+ *  @param probe what to look for
+ *
+ *  @return the step the probe matched at, or -1 if it never did, in which case the machine is put back where it was
+ */
+int searchHistoryBackwards(const HistoryProbe *probe){
+    int now = stepCount;
+
+    for (int index = snapshotAtOrBefore(now - 1); index >= 0; index--) {
+        int intervalEnd = (index + 1 < snapshotCount && snapshots[index + 1]->step < now) ? snapshots[index + 1]->step : now;
+        int lastMatch = -1;
+
+        restoreSnapshot(snapshots[index]);
+        if (probe->startInterval) probe->startInterval();
+
+        while (stepCount < intervalEnd && hasNextInstruction()) {
+            int startAddress = physicalToRelativeAddress((int *)currentInstructionByte);
+
+            if (probe->beforeStep) probe->beforeStep();
+            startCycle();
+
+            int match = probe->afterStep(startAddress);
+            if (match >= 0 && match < now) lastMatch = match;          // where we are already doesn't count
+        }
+
+        if (probe->finishInterval) probe->finishInterval();
+
+        if (lastMatch >= 0) {
+            travelToStep(lastMatch);
+            return lastMatch;
+        }
+    }
+
+    travelToStep(now);
+    return -1;
+}
+
+
+/**
+ *  Works out which bytes the instruction at the program counter will store when it runs: the word rmmovl, pushl
+ *  and call write, or the whole block of a memcpy or memset. It reads the registers the instruction will use, so
+ *  it has to be called just before the step.
+ *
+ *  @param start set to the first guest address stored
+ *  @param end   set to just past the last
+ *
+ *  @return FALSE if the instruction stores nothing to memory
+ */
+bool storeAboutToRun(int64_t *start, int64_t *end){
+    long address = currentInstructionByte - sandboxFloor;
+    if (address < 0 || address > requestedSize - 6) return false;
+
+    uint8_t instruction = currentInstructionByte[0];
+    if (instruction == BREAKPOINT_TRAP && pristineImage && address < pristineImageLength) instruction = pristineImage[address];     // the one the breakpoint covers
+
+    int *base, *count;
+    int32_t displacement;
+
+    switch (instruction >> 4) {
+        case 0x4:           // rmmovl
+            base = registerAtIndex(currentInstructionByte[1] & 0xF);
+            if (!base) return false;
+
+            memcpy(&displacement, currentInstructionByte + 2, sizeof(displacement));
+            *start = (int)((unsigned)*base + (unsigned)displacement);
+            *end   = *start + (int)sizeof(int);
+            return true;
+        case 0x8:           // call
+        case 0xA:           // pushl
+            *start = (int64_t)stackPointer - (int)sizeof(int);
+            *end   = *start + (int)sizeof(int);
+            return true;
+        case 0xE:           // memcpy and memset, %ecx bytes from %edi
+            count = registerAtIndex(1);
+            if (*count <= 0) return false;
+
+            *start = *registerAtIndex(7);
+            *end   = *start + *count;
+            return true;
+
+        default:
+            return false;
+    }
+}
+
+
+int lastWriteAddress;
+int lastWriteSearchStart;                   // a store on the step we are already at doesn't count
+int lastWriteFirstPage;                     // the word can straddle two pages
+int lastWriteLastPage;
+int lastWriteWriter;
+
+bool pendingStore;                          // what the step being replayed stores, see storeAboutToRun()
+int64_t pendingStoreStart;
+int64_t pendingStoreEnd;
+
+void trapLastWritePages(){
+    writeTrapTripped = 0;
+    trapWritesToPage(activeAddressSpace, lastWriteFirstPage, true);
+    trapWritesToPage(activeAddressSpace, lastWriteLastPage, true);
+}
+
+void lastWriteStartInterval(){
+    trapLastWritePages();
+}
+
+/**
+ *  The trap only says that a step wrote to one of the pages, and where it first did. Where the store really
+ *  starts and how long it is comes from the instruction, before it runs.
+ */
+void lastWriteBeforeStep(){
+    pendingStore = storeAboutToRun(&pendingStoreStart, &pendingStoreEnd);
+}
+
+int lastWriteAfterStep(int startAddress){
+    if (!writeTrapTripped) return -1;
+
+    trapLastWritePages();                   // the trap only fires once, put it back
+
+    if (stepCount >= lastWriteSearchStart) return -1;
+
+    if (pendingStore && pendingStoreEnd > lastWriteAddress && pendingStoreStart < (int64_t)lastWriteAddress + (int)sizeof(int)) {
+        lastWriteWriter = startAddress;     // the store overlaps our word
+        return stepCount;
+    }
+
+    return -1;
+}
+
+void lastWriteFinishInterval(){
+    clearWriteTraps(activeAddressSpace);
+}
+
+
+/**
+ *  Runs back to the most recent step that stored into the word at the given guest address. The page or pages
+ *  holding the word are write protected while each interval replays, so only stores to them cost anything.
+ *
+ *  @param address         the guest address to look for
+ *  @param writerAddress   set to the program counter of the instruction that did the store
+ *
+ *  @return the step at which the store completed, leaving the machine just after it, or -1 if nothing wrote there
+ */
+int findLastWriteTo(int address, int *writerAddress){
+    AddressSpace *space = activeAddressSpace;
+    uint8_t *target = (uint8_t *)relativeToPhysicalAddress(address);
+
+    if (!target || target < space->floor || target + sizeof(int) > space->floor + space->mappedBytes) return -1;
+
+    lastWriteAddress     = address;
+    lastWriteSearchStart = stepCount;
+    lastWriteFirstPage   = (int)((target - space->floor) >> GUEST_PAGE_SHIFT);
+    lastWriteLastPage    = (int)((target + sizeof(int) - 1 - space->floor) >> GUEST_PAGE_SHIFT);
+
+    HistoryProbe probe = { lastWriteStartInterval, lastWriteBeforeStep, lastWriteAfterStep, lastWriteFinishInterval };
+    int step = searchHistoryBackwards(&probe);
+
+    if (step >= 0 && writerAddress) *writerAddress = lastWriteWriter;       // the last hit in the interval is the one we landed on
+    return step;
+}
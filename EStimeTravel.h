@@ -0,0 +1,36 @@
+//
+//  EStimeTravel.h
+//  Eighty-Sixer
+//
+//  Created by agent on 10/19/26.
+//  Copyright (c) 2026 agent. All rights reserved.
+//
+
+#ifndef __Eighty_Sixer__EStimeTravel__
+#define __Eighty_Sixer__EStimeTravel__
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#define TIME_TRAVEL_MAX_SNAPSHOTS   64
+
+typedef struct HistoryProbe {
+    void (*startInterval)();        // after a snapshot is restored, before replaying from it
+    void (*beforeStep)();           // just before each step, may be NULL
+    int  (*afterStep)(int);         // given where the step started, returns the step to land on if it matched, else -1
+    void (*finishInterval)();
+} HistoryProbe;
+
+extern int snapshotInterval;
+
+void startTimeTravel();
+void takeSnapshotIfDue();
+void listSnapshots();
+
+bool travelToStep(int);
+int  searchHistoryBackwards(const HistoryProbe*);
+int  findLastWriteTo(int, int*);
+bool storeAboutToRun(int64_t*, int64_t*);
+
+#endif /* defined(__Eighty_Sixer__EStimeTravel__) */
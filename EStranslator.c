@@ -0,0 +1,422 @@
+//
+//  EStranslator.c
+//  Eighty-Sixer
+//
+//  Created by agent on 10/19/26.
+//  Copyright (c) 2026 agent. All rights reserved.
+//
+
+#include "EStranslator.h"
+#include "ESdecoder.h"
+#include "main.h"
+
+/*  Ahead of time translation of a loaded program into a standalone C file.
+
+    Every basic block becomes a label and every guest register and flag a local in main(), so the C compiler
+    can keep them in host registers. Guest memory is a byte array initialised with the program image, and
+    every access goes through the same bounds the memory manager enforces. The translated program prints
+    the same trace printHarmonFormattedTrace() does, faults included.
+
+    ret can land anywhere, so it goes through one dispatch switch over every block the translator found.
+ */
+
+const char *translationPath = NULL;
+
+static const char *locals[] = { "eax", "ecx", "edx", "ebx", "esp", "ebp", "esi", "edi" };
+
+static const char *includes =
+"#include <stdio.h>\n"
+"#include <stdint.h>\n"
+"#include <string.h>\n"
+"\n";
+
+static const char *prologue =
+"static inline int32_t load(int32_t address){\n"
+"    int32_t word;\n"
+"    memcpy(&word, memory + address, sizeof(word));\n"
+"    return word;\n"
+"}\n"
+"\n"
+"static inline void store(int32_t address, int32_t word){\n"
+"    memcpy(memory + address, &word, sizeof(word));\n"
+"}\n"
+"\n"
+"/* the device registers, see ESdevices.h. Standard input is all console input here, there's no program text in front of it.\n"
+"   inline so a program with no rmmovl or mrmovl to reach them doesn't warn that they're unused */\n"
+"static inline int device_store(int32_t offset, int32_t word){\n"
+"    if (offset == DEVICE_CONSOLE_OUT) putchar((unsigned char)word);\n"
+"    else if (offset == DEVICE_CONSOLE_NUMBER) printf(\"%d\", word);\n"
+"    else return 0;\n"
+"    return 1;\n"
+"}\n"
+"\n"
+"static inline int device_load(int32_t offset, uint32_t steps, int32_t *word){\n"
+"    if (offset == DEVICE_CONSOLE_IN) {\n"
+"        fflush(stdout);\n"
+"        int character = getchar();\n"
+"        *word = character == EOF ? -1 : character;\n"
+"    } else if (offset == DEVICE_STEPS) {\n"
+"        *word = (int32_t)steps;\n"
+"    } else return 0;\n"
+"    return 1;\n"
+"}\n"
+"\n"
+"#define FINISH(at, why) do { pc = (at); status = (why); goto done; } while (0)\n"
+"\n"
+"/* an instruction is read a byte at a time; the first byte at or above %esp or past the image ends the program\n"
+"   if it's the first byte of the instruction, and is an address fault otherwise */\n"
+"#define FETCH(at, length, available) \\\n"
+"    if (esp < (at) + (length) || (available) < (length)) { \\\n"
+"        int64_t reached = (int64_t)esp - (at); \\\n"
+"        if (reached > (available)) reached = (available); \\\n"
+"        if (reached <= 0) FINISH(at, \"HLT\"); \\\n"
+"        steps++; \\\n"
+"        FINISH((at) + (int32_t)reached, \"ADR\"); \\\n"
+"    }\n"
+"\n"
+"#define PUSH(word, next) do { \\\n"
+"        int32_t pushed = (word); \\\n"
+"        if ((int64_t)esp - 4 < PROGRAM_LENGTH || (int64_t)esp - 4 > SANDBOX_SIZE - 4) FINISH(next, \"ADR\"); \\\n"
+"        esp -= 4; \\\n"
+"        store(esp, pushed); \\\n"
+"    } while (0)\n"
+"\n"
+"#define POP(into, next) do { \\\n"
+"        if (esp < PROGRAM_LENGTH || esp > SANDBOX_SIZE - 4) FINISH(next, \"ADR\"); \\\n"
+"        int32_t popped = load(esp); \\\n"
+"        esp += 4; \\\n"
+"        (into) = popped; \\\n"
+"    } while (0)\n"
+"\n"
+"int main(void){\n"
+"    int32_t eax = 0, ecx = 0, edx = 0, ebx = 0, esi = 0, edi = 0;\n"
+"    int32_t esp = SANDBOX_SIZE, ebp = SANDBOX_SIZE;\n"
+"    int zf = 0, sf = 0, of = 0;\n"
+"    uint32_t steps = 0;\n"
+"    int32_t pc = 0;\n"
+"    int32_t target = 0;\n"
+"    const char *status = \"HLT\";\n"
+"\n"
+"    (void)target;\n";
+
+static const char *epilogue =
+"done:\n"
+"    printf(\"\\n\\n\");\n"
+"    printf(\"Steps: %d\\n\", (int32_t)steps);\n"
+"    printf(\"PC: 0x%08X\\n\", pc);\n"
+"    printf(\"Status: %s\\n\", status);\n"
+"    printf(\"CZ: %1d\\n\", zf);\n"
+"    printf(\"CS: %1d\\n\", sf);\n"
+"    printf(\"CO: %1d\\n\", of);\n"
+"    printf(\"%%eax: 0x%08X\\n\", eax);\n"
+"    printf(\"%%ecx: 0x%08X\\n\", ecx);\n"
+"    printf(\"%%edx: 0x%08X\\n\", edx);\n"
+"    printf(\"%%ebx: 0x%08X\\n\", ebx);\n"
+"    printf(\"%%esp: 0x%08X\\n\", esp);\n"
+"    printf(\"%%ebp: 0x%08X\\n\", ebp);\n"
+"    printf(\"%%esi: 0x%08X\\n\", esi);\n"
+"    printf(\"%%edi: 0x%08X\\n\", edi);\n"
+"\n"
+"    return 0;\n"
+"}\n";
+
+
+/**
+ *  Writes a guest constant as a C expression of type int32_t. The most negative one has no literal of its own.
+ */
+const char *constantExpression(int value, char *buffer, size_t size){
+    if (value == INT_MIN) snprintf(buffer, size, "(-2147483647 - 1)");
+    else snprintf(buffer, size, "%d", value);
+
+    return buffer;
+}
+
+
+/**
+ *  Writes the C condition for a jump or conditional move, matching conditionHolds().
+ */
+const char *conditionExpression(uint8_t functionCode){
+    switch (functionCode) {
+        case 1:
+            return "(sf ^ of) | zf";
+        case 2:
+            return "sf ^ of";
+        case 3:
+            return "zf";
+        case 4:
+            return "!zf";
+        case 5:
+            return "!(sf ^ of)";
+        case 6:
+            return "!(sf ^ of) && !zf";
+
+        default:
+            return "1";
+    }
+}
+
+
+/**
+ *  Writes the transfer of control to a known destination, with the checks jumpToReadAtInternalAddress() makes.
+ *  Only the one against %esp is left for run time.
+ */
+void emitJump(FILE *file, const ControlFlowGraph *graph, int destination, const char *indent){
+    if (destination < 0 || destination > requestedSize) {
+        fprintf(file, "%sFINISH(-1, \"ADR\");\n", indent);                    // not even inside the sandbox
+    } else if (destination >= graph->imageLength) {
+        fprintf(file, "%sFINISH(%d, \"ADR\");\n", indent, destination);
+    } else {
+        fprintf(file, "%sif (esp <= %d) FINISH(%d, \"ADR\");\n", indent, destination, destination);
+        fprintf(file, "%sgoto L_%04X;\n", indent, destination);
+    }
+}
+
+
+/**
+ *  Writes one instruction: its fetch check, the step and what it does.
+ */
+void emitInstruction(FILE *file, const ControlFlowGraph *graph, const DecodedInstruction *decoded){
+    char text[64], constant[32];
+    int next = decoded->address + decoded->length;
+
+    const char *a = decoded->registerA < 8 ? locals[decoded->registerA] : NULL;
+    const char *b = decoded->registerB < 8 ? locals[decoded->registerB] : NULL;
+
+    fprintf(file, "    /* 0x%04X: %s */\n", decoded->address, describeInstruction(decoded, text, sizeof(text)));
+    fprintf(file, "    FETCH(%d, %d, %d);\n", decoded->address, decoded->length, decoded->available);
+
+    if (decoded->available < decoded->length) return;                          // FETCH always finishes the program
+
+    fprintf(file, "    steps++;\n");
+
+    if (!decoded->valid) {
+        fprintf(file, "    FINISH(%d, \"INS\");\n", next);
+        return;
+    }
+
+    constantExpression(decoded->constant, constant, sizeof(constant));
+
+    switch (decoded->icode) {
+        case 0:
+            fprintf(file, "    FINISH(%d, \"HLT\");\n", next);
+            break;
+        case 1:
+            break;
+        case 2:
+            if (decoded->ifun == 0) fprintf(file, "    %s = %s;\n", b, a);
+            else fprintf(file, "    if (%s) %s = %s;\n", conditionExpression(decoded->ifun), b, a);
+            break;
+        case 3:
+            fprintf(file, "    %s = %s;\n", b, constant);
+            break;
+        case 4:
+            fprintf(file, "    {\n");
+            fprintf(file, "        int32_t address = (int32_t)((uint32_t)%s + (uint32_t)%s);\n", b, constant);
+            fprintf(file, "        if (address < 0 && address >= DEVICE_BASE) {\n");
+            fprintf(file, "            if (!device_store(address - DEVICE_BASE, %s)) FINISH(%d, \"ADR\");\n", a, next);
+            fprintf(file, "        } else {\n");
+            fprintf(file, "            if (address < PROGRAM_LENGTH - 1 || address > SANDBOX_SIZE - 4) FINISH(%d, \"ADR\");\n", next);
+            fprintf(file, "            store(address, %s);\n", a);
+            fprintf(file, "        }\n");
+            fprintf(file, "    }\n");
+            break;
+        case 5:
+            fprintf(file, "    {\n");
+            fprintf(file, "        int32_t address = (int32_t)((uint32_t)%s + (uint32_t)%s);\n", b, constant);
+            fprintf(file, "        if (address < 0 && address >= DEVICE_BASE) {\n");
+            fprintf(file, "            if (!device_load(address - DEVICE_BASE, steps, &%s)) FINISH(%d, \"ADR\");\n", a, next);
+            fprintf(file, "        } else {\n");
+            fprintf(file, "            if (address < 0 || address > SANDBOX_SIZE - 4) FINISH(%d, \"ADR\");\n", next);
+            fprintf(file, "            %s = load(address);\n", a);
+            fprintf(file, "        }\n");
+            fprintf(file, "    }\n");
+            break;
+        case 6:
+        case 0xC: {
+            const char *source = decoded->icode == 0xC ? constant : a;        // iaddl is addl with its immediate for register A
+
+            fprintf(file, "    {\n");
+            switch (decoded->icode == 0xC ? 0 : decoded->ifun) {
+                case 0:
+                    fprintf(file, "        int32_t result = (int32_t)((uint32_t)%s + (uint32_t)%s);\n", b, source);
+                    fprintf(file, "        of = (%s < 0) == (%s < 0) && (result < 0) != (%s < 0);\n", source, b, b);
+                    break;
+                case 1:
+                    fprintf(file, "        int32_t result = (int32_t)((uint32_t)%s - (uint32_t)%s);\n", b, source);
+                    fprintf(file, "        of = (%s < 0) != (%s < 0) && (result < 0) != (%s < 0);\n", source, b, b);
+                    break;
+                case 2:
+                    fprintf(file, "        int32_t result = %s & %s;\n", b, source);
+                    fprintf(file, "        of = 0;\n");
+                    break;
+                case 3:
+                    fprintf(file, "        int32_t result = %s ^ %s;\n", b, source);
+                    fprintf(file, "        of = 0;\n");
+                    break;
+                case 4:                                                         // the rest match extendedArithmetic()
+                    fprintf(file, "        int64_t product = (int64_t)%s * %s;\n", b, source);
+                    fprintf(file, "        int32_t result = (int32_t)(uint32_t)product;\n");
+                    fprintf(file, "        of = product != result;\n");
+                    break;
+                case 5:
+                case 6:
+                    fprintf(file, "        if (%s == 0) FINISH(%d, \"INS\");\n", source, next);
+                    fprintf(file, "        int wraps = %s == INT32_MIN && %s == -1;\n", b, source);
+                    fprintf(file, "        int32_t result = wraps ? %s : %s %c %s;\n", decoded->ifun == 5 ? "INT32_MIN" : "0", b, decoded->ifun == 5 ? '/' : '%', source);
+                    fprintf(file, "        of = %s;\n", decoded->ifun == 5 ? "wraps" : "0");
+                    break;
+            }
+            fprintf(file, "        zf = result == 0;\n");
+            fprintf(file, "        sf = result < 0;\n");
+            fprintf(file, "        %s = result;\n", b);
+            fprintf(file, "    }\n");
+            break;
+        }
+        case 7:
+            if (decoded->ifun == 0) {
+                emitJump(file, graph, decoded->constant, "    ");
+            } else {
+                fprintf(file, "    if (%s) {\n", conditionExpression(decoded->ifun));
+                emitJump(file, graph, decoded->constant, "        ");
+                fprintf(file, "    }\n");
+            }
+            break;
+        case 8:
+            fprintf(file, "    PUSH(%d, %d);\n", next, next);
+            emitJump(file, graph, decoded->constant, "    ");
+            break;
+        case 9:
+            fprintf(file, "    POP(target, %d);\n", next);
+            fprintf(file, "    goto dispatch;\n");
+            break;
+        case 0xA:
+            fprintf(file, "    PUSH(%s, %d);\n", a, next);
+            break;
+        case 0xB:
+            fprintf(file, "    POP(%s, %d);\n", a, next);
+            break;
+        case 0xD:
+            fprintf(file, "    esp = ebp;\n");
+            fprintf(file, "    POP(ebp, %d);\n", next);
+            break;
+        case 0xE:                                                               // the bounds copyMemoryBlock() and fillMemoryBlock() check
+            fprintf(file, "    if (ecx < 0 || (ecx > 0 && (edi < PROGRAM_LENGTH - 1 || (int64_t)edi + ecx > SANDBOX_SIZE))) FINISH(%d, \"ADR\");\n", next);
+
+            if (decoded->ifun == 0) {
+                fprintf(file, "    if (ecx > 0 && (esi < 0 || (int64_t)esi + ecx > SANDBOX_SIZE)) FINISH(%d, \"ADR\");\n", next);
+                fprintf(file, "    if (ecx > 0) memmove(memory + edi, memory + esi, ecx);\n");
+                fprintf(file, "    esi = (int32_t)((uint32_t)esi + (uint32_t)ecx);\n");
+            } else {
+                fprintf(file, "    if (ecx > 0) memset(memory + edi, (unsigned char)eax, ecx);\n");
+            }
+
+            fprintf(file, "    edi = (int32_t)((uint32_t)edi + (uint32_t)ecx);\n");
+            fprintf(file, "    ecx = 0;\n");
+            break;
+    }
+}
+
+
+/**
+ *  Writes the basic block starting at the given leader, up to the instruction that ends it or the next leader.
+ */
+void emitBlock(FILE *file, const ControlFlowGraph *graph, int leader, int nextLeader){
+    const DecodedInstruction *decoded;
+    int address = leader;
+
+    fprintf(file, "\nL_%04X: __attribute__((unused));\n", leader);        // some blocks are only ever fallen into
+
+    do {
+        decoded = decodedInstructionAt(address);
+        emitInstruction(file, graph, decoded);
+
+        address += decoded->length;
+    } while (!endsBasicBlock(decoded) && address < graph->imageLength && !graph->leader[address]);
+
+    if (endsBasicBlock(decoded) && !fallsThrough(decoded)) return;
+
+    if (decoded->icode == 8 && decoded->valid) return;           // the return site is reached through dispatch
+
+    if (address >= graph->imageLength) {
+        fprintf(file, "    FINISH(%d, \"HLT\");\n", address);          // ran off the end of the program
+    } else if (address != nextLeader) {
+        fprintf(file, "    goto L_%04X;\n", address);
+    }
+}
+
+
+/**
+ *  Translates the loaded program image into a C file that runs it natively once compiled, e.g. with gcc -O2.
+ *  The program starts from the freshly loaded state: clean registers and the stack at the top of the sandbox.
+ *
+ *  @param path where to write the C source
+ *
+ *  @return FALSE if there is no program image or the file could not be written
+ */
+bool translateProgram(const char *path){
+    if (!pristineImage) return false;
+
+    const uint8_t *image = pristineImage;
+    int imageLength = pristineImageLength;
+
+    const ControlFlowGraph *graph = programControlFlow();         // from the image cache, if the program came from there
+    if (!graph || !decodedInstructionAt(0)) return false;
+
+    FILE *file = fopen(path, "w");
+    if (!file) return false;
+
+    fprintf(file, "/*\n *  %s\n *  Translated by Eighty-Sixer %s from a %d byte Y86 program, %d basic blocks.\n", path, version, imageLength, graph->blockCount);
+    fprintf(file, " *  Build it with gcc -O2. It prints the trace the interpreter would have printed.\n */\n\n");
+
+    fputs(includes, file);
+
+    fprintf(file, "#define SANDBOX_SIZE    %d\n", requestedSize);
+    fprintf(file, "#define PROGRAM_LENGTH  %d\n\n", imageLength);
+
+    fprintf(file, "#define DEVICE_BASE             (%d)\n", DEVICE_BASE);
+    fprintf(file, "#define DEVICE_CONSOLE_OUT      %d\n", DEVICE_CONSOLE_OUT);
+    fprintf(file, "#define DEVICE_CONSOLE_IN       %d\n", DEVICE_CONSOLE_IN);
+    fprintf(file, "#define DEVICE_CONSOLE_NUMBER   %d\n", DEVICE_CONSOLE_NUMBER);
+    fprintf(file, "#define DEVICE_STEPS            %d\n\n", DEVICE_STEPS);
+
+    fprintf(file, "static unsigned char memory[SANDBOX_SIZE] = {");
+    for (int i = 0; i < imageLength; i++) {
+        fprintf(file, "%s0x%02X,", i % 16 ? " " : "\n    ", image[i]);
+    }
+    fprintf(file, "\n};\n\n");
+
+    fputs(prologue, file);
+
+    if (imageLength == 0) fprintf(file, "    FINISH(0, \"HLT\");\n");
+    else fprintf(file, "    goto L_0000;\n");
+
+    for (int leader = 0; leader < imageLength; leader++) {
+        if (!graph->leader[leader]) continue;
+
+        int nextLeader = leader + 1;
+        while (nextLeader < imageLength && !graph->leader[nextLeader]) nextLeader++;
+
+        emitBlock(file, graph, leader, nextLeader);
+    }
+
+    if (graph->hasReturn) {
+        fprintf(file, "\ndispatch:                               /* where every ret goes */\n");
+        fprintf(file, "    if (target < 0 || target >= PROGRAM_LENGTH || target >= esp) FINISH(target < 0 || target > SANDBOX_SIZE ? -1 : target, \"ADR\");\n");
+        fprintf(file, "    switch (target) {\n");
+
+        for (int leader = 0; leader < imageLength; leader++) {
+            if (graph->leader[leader]) fprintf(file, "        case %d: goto L_%04X;\n", leader, leader);
+        }
+
+        fprintf(file, "    }\n");
+        fprintf(file, "    fprintf(stderr, \"ret to 0x%%X, which is not the start of a translated block\\n\", target);\n");
+        fprintf(file, "    return 2;\n\n");
+    }
+
+    fputs(epilogue, file);
+
+    bool written = !ferror(file);
+    if (fclose(file) != 0) written = false;
+
+    return written;
+}
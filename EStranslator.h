@@ -0,0 +1,20 @@
+//
+//  EStranslator.h
+//  Eighty-Sixer
+//
+//  Created by agent on 10/19/26.
+//  Copyright (c) 2026 agent. All rights reserved.
+//
+
+#ifndef __Eighty_Sixer__EStranslator__
+#define __Eighty_Sixer__EStranslator__
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+extern const char *translationPath;
+
+bool translateProgram(const char*);
+
+#endif /* defined(__Eighty_Sixer__EStranslator__) */
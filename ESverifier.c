@@ -0,0 +1,132 @@
+//
+//  ESverifier.c
+//  Eighty-Sixer
+//
+//  Created by agent on 10/19/26.
+//  Copyright (c) 2026 agent. All rights reserved.
+//
+
+#include "ESverifier.h"
+#include "main.h"
+
+int *verifiedEnd = NULL;            // by address: where the verified run starting at that leader ends, 0 if there isn't one
+int verifiedLength = 0;             // how many addresses verifiedEnd has, the length of the image
+int verifiedRuns = 0;
+int verifiedLongest = 0;            // the most bytes any run covers
+uint8_t *verifiedRunStop = NULL;    // where the run under way ends, see stepProgramVerified()
+
+
+/**
+ *  Tells whether an instruction writes %esp by name, rather than moving it a word at a time the way pushl, popl,
+ *  call and ret do. Those can't take it below the top of the program image; this can.
+ */
+bool writesStackPointer(const DecodedInstruction *decoded){
+    switch (decoded->icode) {
+        case 0x2:           // rrmovl and cmovXX
+        case 0x3:           // irmovl
+        case 0x6:           // OPl
+        case 0xC:           // iaddl
+            return decoded->registerB == 4;
+        case 0x5:           // mrmovl
+        case 0xB:           // popl
+            return decoded->registerA == 4;
+        case 0xD:           // leave
+            return true;
+
+        default:
+            return false;
+    }
+}
+
+
+/**
+ *  Tells whether an instruction can run without any of the checks readNextInstructionByte() and
+ *  jumpToReadAtInternalAddress() make, given that %esp was above the whole image when its run started.
+ *
+ *  @param decoded the instruction
+ *  @param graph   the program's basic blocks
+ *
+ *  @return FALSE if it has to run the ordinary way
+ */
+bool instructionVerifies(const DecodedInstruction *decoded, const ControlFlowGraph *graph){
+    if (!decoded->valid || decoded->available < decoded->length) return false;     // faults INS or runs off the image
+
+    if (decoded->address + decoded->length >= graph->imageLength) return false;     // stores may overwrite the last byte
+
+    if (decoded->icode == 9 || writesStackPointer(decoded)) return false;           // ret goes wherever the stack says
+
+    if (decoded->icode == 7 || decoded->icode == 8) {                               // has to land on an instruction we decoded
+        if (decoded->constant < 0 || decoded->constant >= graph->imageLength || !graph->leader[decoded->constant]) return false;
+    }
+
+    return true;
+}
+
+
+/**
+ *  Proves what it can about the loaded program before it runs. Every basic block the control flow graph reaches is
+ *  walked from its leader for as long as its instructions verify, see instructionVerifies(); that stretch is the
+ *  block's verified run. A run never spans a leader, so the only ways into one are at its start or by running on
+ *  from the instruction before, and the only ways out are its last instruction or a jump back to its start.
+ *
+ *  The rest of the program, ret included, keeps every check. So do programs that can't be verified at all.
+ *
+ *  @return FALSE if there is no program or it could not be decoded
+ */
+bool verifyProgram(){
+    if (verifiedEnd) return true;
+
+    const ControlFlowGraph *graph = programControlFlow();
+    if (!graph) return false;
+
+    verifiedEnd = calloc(graph->imageLength + 1, sizeof(int));
+    if (!verifiedEnd) return false;
+
+    verifiedLength = graph->imageLength;
+
+    for (int leader = 0; leader < graph->imageLength; leader++) {
+        if (!graph->leader[leader]) continue;
+
+        int address = leader;
+        while (address < graph->imageLength) {
+            const DecodedInstruction *decoded = decodedInstructionAt(address);
+            if (!decoded) {
+                free(verifiedEnd);
+                verifiedEnd = NULL;
+                return false;
+            }
+
+            if (!instructionVerifies(decoded, graph)) break;
+
+            address += decoded->length;
+            if (endsBasicBlock(decoded) || graph->leader[address]) break;
+        }
+
+        if (address > leader) {
+            verifiedEnd[leader] = address;
+            verifiedRuns++;
+            if (address - leader > verifiedLongest) verifiedLongest = address - leader;
+        }
+    }
+
+    return true;
+}
+
+
+/**
+ *  Drops the verified runs overlapping a range of the image that a store changed, see codeWritten(). What was
+ *  proved about the old bytes says nothing about the new ones, so those addresses keep every check from then on.
+ *  A run under way stops after the store, before it can fetch anything changed.
+ *
+ *  @param start the first byte that changed
+ *  @param end   just past the last
+ */
+void invalidateVerifiedRuns(int start, int end){
+    if (!verifiedEnd) return;
+
+    verifiedRunStop = NULL;
+
+    for (int leader = start > verifiedLongest ? start - verifiedLongest : 0; leader < end && leader < verifiedLength; leader++) {
+        if (verifiedEnd[leader] > start) verifiedEnd[leader] = 0;
+    }
+}
@@ -0,0 +1,24 @@
+//
+//  ESverifier.h
+//  Eighty-Sixer
+//
+//  Created by agent on 10/19/26.
+//  Copyright (c) 2026 agent. All rights reserved.
+//
+
+#ifndef __Eighty_Sixer__ESverifier__
+#define __Eighty_Sixer__ESverifier__
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+extern int *verifiedEnd;
+extern int verifiedLength;
+extern int verifiedRuns;
+extern uint8_t *verifiedRunStop;
+
+bool verifyProgram();
+void invalidateVerifiedRuns(int, int);
+
+#endif /* defined(__Eighty_Sixer__ESverifier__) */
@@ -0,0 +1,66 @@
+//
+//  ESwordWidth.h
+//  Eighty-Sixer
+//
+//  Created by agent on 10/19/26.
+//  Copyright (c) 2026 agent. All rights reserved.
+//
+
+/*  The word size macros the interpreter core is written against. Define WORD_BITS as 32 for Y86 or 64 for Y86-64
+    and include this, then the core; ESaluCore.inc and ESmemoryCore.inc are each included once per width, so every
+    width gets its own copy of the handlers with the word size fixed at compile time.
+
+    There is deliberately no include guard: including it again with another WORD_BITS switches the macros over.
+ */
+
+#include <limits.h>
+#include <stdint.h>
+#include <inttypes.h>
+
+#undef WORD
+#undef UWORD
+#undef WORD_MIN
+#undef WORD_MAX
+#undef WORD_BYTES
+#undef WORD_FORMAT
+#undef WORD_NAME
+#undef REGISTER_COUNT
+#undef REGISTER_NAMES
+#undef FOR_WIDTH
+#undef MNEMONIC
+#undef NARROW_ADDRESS
+
+#if WORD_BITS == 32
+
+#define WORD                int
+#define UWORD               unsigned int
+#define WORD_MIN            INT_MIN
+#define WORD_MAX            INT_MAX
+#define WORD_BYTES          4
+#define WORD_FORMAT         "0x%08X"
+#define WORD_NAME           "Long"
+#define REGISTER_COUNT      8
+#define REGISTER_NAMES      { "eax", "ecx", "edx", "ebx", "esp", "ebp", "esi", "edi" }
+#define FOR_WIDTH(name)     name                    // Y86 keeps the names everything else already calls
+#define MNEMONIC(name)      name ## l               // rrmovl, pushl...
+#define NARROW_ADDRESS(x)   (x)
+
+#elif WORD_BITS == 64
+
+#define WORD                int64_t
+#define UWORD               uint64_t
+#define WORD_MIN            INT64_MIN
+#define WORD_MAX            INT64_MAX
+#define WORD_BYTES          8
+#define WORD_FORMAT         "0x%016" PRIX64
+#define WORD_NAME           "Quad"
+#define REGISTER_COUNT      15
+#define REGISTER_NAMES      { "rax", "rcx", "rdx", "rbx", "rsp", "rbp", "rsi", "rdi", \
+                              "r8", "r9", "r10", "r11", "r12", "r13", "r14" }
+#define FOR_WIDTH(name)     name ## 64
+#define MNEMONIC(name)      name ## q               // rrmovq, pushq...
+#define NARROW_ADDRESS(x)   ((x) < INT_MIN || (x) > INT_MAX ? INT_MIN : (int)(x))      // INT_MIN is out of bounds everywhere
+
+#else
+#error "WORD_BITS must be 32 or 64"
+#endif
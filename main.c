@@ -14,6 +14,11 @@
 
 void alpha();
 void omega(FaultCode);
+void beginRun(int);
+void loadProgramFromInput();
+char *readProgramText(int*);
+bool parseSweep(const char*);
+bool parseExtensions(const char*);
 
 char *eighty_sixer =
 " _____   _           _       _                     ____    _                                \n\
@@ -30,6 +35,15 @@ char *version = "0.5a";
 
 int instructionBytes = 0;
 
+int runCount = 1;                   // how many times to run the loaded program, see --runs
+int sweepRegister = -1;             // the register given a different starting value each run, see --sweep
+int sweepStart  = 0;
+int sweepStride = 1;
+
+jmp_buf runCompleted;               // omega() lands back here when more runs are queued, or in the debugger
+bool runInProgress = false;
+FaultCode lastFaultCode = AOK;
+
 
 
 /**
@@ -43,20 +57,137 @@ void alpha(){
         omega(ADDRESS_FAULT);
     }
 
+    if (fuzzPrograms) runFuzzer();                                                          // makes its own programs, and never comes back
+
+    if (restorePath) {                                                                      // pick up where a checkpoint left off
+        if (!restoreCheckpoint(restorePath)) omega(PROGRAM_ERROR);
+    } else if (sourcePath) {                                                                // assemble a .ys file instead of reading hex
+        if (!assembleProgram(sourcePath)) omega(PROGRAM_ERROR);
+    } else {
+        loadProgramFromInput();
+    }
+
+    if (sweepRegister >= 8 && wordBits != 64) {
+        printf("\n\n%%r8 through %%r14 only exist in Y86-64 programs.");
+        omega(PROGRAM_ERROR);
+    }
+
+    if (wordBits == 64 && (translationPath || debugging || lockstep || checkpointPath || restorePath || memoizing)) {     // these still work on 32 bit registers
+        printf("\n\nThe translator, debugger, lockstep runs, checkpoints and memoization only handle Y86 programs, not Y86-64.");
+        omega(PROGRAM_ERROR);
+    }
+
+    if (writableCode && translationPath) {                                                  // the C it writes has the program fixed in it
+        printf("\n\nThe translator can't handle a program that writes to itself.");
+        omega(PROGRAM_ERROR);
+    }
+
+    if (memoizing && (writableCode || debugging || profiling || pluginPathCount || cosimEngineName)) {     // they'd see calls that never return
+        printf("\n\nMemoization doesn't work with --writable-code, the debugger, the profiler, plugins or --cosim.");
+        omega(PROGRAM_ERROR);
+    }
+
+    if (memoizing && !prepareMemoization()) {
+        printf("\n\nFatal Error. Not enough memory to memoize calls.");
+        omega(PROGRAM_ERROR);
+    }
+
+    if (hostCounting && !openHostCounters()) omega(PROGRAM_ERROR);
+
+    if ((recordPath || replayPath) && (translationPath || restorePath)) {                   // the log starts with the loaded program at step 0
+        printf("\n\nThe translator and checkpoint restores can't be recorded or replayed.");
+        omega(PROGRAM_ERROR);
+    }
+
+    if ((recordPath || replayPath) && !openRecording()) omega(PROGRAM_ERROR);              // a replay may turn on the trap
+
+    if ((fileSandboxPath || (replayPath && (isaExtensions & EXTENSION_TRAP))) && (translationPath || debugging)) {  // a replay or a translation would do the I/O again
+        printf("\n\nThe translator and the debugger don't handle the file trap.");
+        omega(PROGRAM_ERROR);
+    }
+
+    for (int i = 0; i < pluginPathCount; i++) {                                             // before the interpreter is picked, which depends on them
+        if (!loadPlugin(pluginPaths[i])) omega(PROGRAM_ERROR);
+    }
+
+    if (fileSandboxPath && !openFileSandbox(fileSandboxPath)) {
+        printf("\n\nCould not open the file sandbox directory %s", fileSandboxPath);
+        omega(PROGRAM_ERROR);
+    }
+
+    if (translationPath) {                                                                  // write the program out as C instead of running it
+        if (!translateProgram(translationPath)) {
+            printf("\n\nCould not translate the program to %s", translationPath);
+            omega(PROGRAM_ERROR);
+        }
+
+        printf("\nTranslated to %s. Build it with gcc -O2.\n", translationPath);
+        exit(0);
+    }
+
+    selectInterpreter();                           // the modes are settled too, so the instrumentation can be
+
+    if (debugging) runDebugger();                  // the debugger takes over from here and never comes back
+
+    if (cosimEngineName && !prepareCosimulation()) omega(PROGRAM_ERROR);       // every run checks an engine against the interpreter
+
+    if (lockstep && !profiling && !tracing && !pluginCount && !checkpointPath && !restorePath && !writableCode && !recordPath && !replayPath && !memoizing && !hostCounting) {    // per run state only, and one program for every lane
+        runLockstep();
+        exit(0);
+    }
+
+    if (checkpointPath) installCheckpointSignals();
+
+    for (int run = 0; run < runCount; run++) {
+        beginRun(run);
+
+        if (setjmp(runCompleted) == 0) {
+            runInProgress = true;
+
+            if (checkpointPath) {
+                runWithCheckpoints();
+            } else if (wordBits == 64) {
+                runProgram64();                     // the width is settled before the first step, never during one
+            } else {
+                runProgram();
+            }
+
+            quit(HALT);
+        }
+    }
+
+    exit(0);
+
+    //startCycle();   // lets get it started, it's HOT
+}
+
+/**
+ *  Reads the program from standard input, two hex characters per byte, until a null character or Q/q.
+ *  With --image-cache, input that has been seen before loads straight from the cache instead.
+ */
+void loadProgramFromInput(){
     if (verbose) {
         printf("\nReading instruction bytes from standard input:\n");
     }
 
-    uint8_t byte = 0;
-    char nibble = '0';
-    while (nibble != '\0' && nibble != 'q') {
-        scanf("%c", &nibble);
-        byte = parseInput(nibble);
+    int length = 0;
+    char *text = readProgramText(&length);
+    if (!text) {
+        printf("\n\nFatal Error. Not enough memory to read the program.");
+        omega(PROGRAM_ERROR);
+    }
+
+    if (imageCachePath && loadCachedImage(text, length)) {
+        free(text);
+        return;
+    }
+
+    for (int i = 0; i < length; i++) {
+        uint8_t byte = parseInput(text[i]);
 
-        if (byte < 0x10) {
+        if (byte < 0x10 && i + 1 < length) {
             byte = (int)byte << 4;
-            scanf("%c", &nibble);
-            uint8_t nextByte = parseInput(nibble);
+            uint8_t nextByte = parseInput(text[++i]);
 
             if (nextByte < 0x10) {
 
@@ -68,14 +199,82 @@ void alpha(){
         }
     }
 
+    if (imageCachePath) storeCachedImage(text, length);
+
+    free(text);
+}
+
+/**
+ *  Reads the program text from standard input up to and including whatever ends it: a null character, or Q/q.
+ *  Nothing after that is read, since the debugger takes its commands from the same input. Running out of input
+ *  ends the program as a null character would.
+ *
+ *  @param length set to the number of characters read
+ *
+ *  @return the text, which the caller frees; NULL if it would not fit in memory
+ */
+char *readProgramText(int *length){
+    int capacity = 4096;
+    char *text = malloc(capacity);
+    int count = 0;
+
+    while (text) {
+        int character = getchar();
+        if (character == EOF) character = '\0';
+
+        if (count == capacity) {
+            capacity *= 2;
+            char *grown = realloc(text, capacity);
+            if (!grown) free(text);
+            text = grown;
+            if (!text) break;
+        }
+
+        text[count++] = (char)character;
 
-    while (hasNextInstruction()) {                 // keep executing instructions until we've reached the end
-        startCycle();
+        if (character == '\0' || character == 'q' || character == 'Q') break;
     }
 
-    quit(HALT);
+    *length = count;
+    return text;
+}
 
-    //startCycle();   // lets get it started, it's HOT
+/**
+ *  Readies the machine for the given run. The first run uses the freshly loaded address space as is;
+ *  every later one hands the last space back to the pool, which restores only the pages it dirtied,
+ *  and starts over from the loaded image with clean registers.
+ *
+ *  @param run the zero-based run number
+ */
+void beginRun(int run){
+    if (run > 0) {
+        releaseAddressSpace(activeAddressSpace);
+
+        if (!enterAddressSpace(acquireAddressSpace())) {
+            printf("\n\nFatal Error. No address space left in the pool.");
+            quit(ADDRESS_FAULT);
+        }
+
+        resetProcessorState();
+        resetDevices();
+    }
+
+    if (profiling) startProfile();
+    if (memoizing) resetMemoFrames();
+    if (hostCounting) startHostCounters();
+    if (checkingIdleLoops) resetIdleCheck();
+    if (collectingStats) startStats(run);
+    if (pluginCount) pluginRunStarted(run);
+
+    if (sweepRegister >= 0 && wordBits == 64) {
+        *registerAtIndex64(sweepRegister) = sweepStart + run * sweepStride;
+    } else if (sweepRegister >= 0) {
+        *registerAtIndex(sweepRegister) = sweepStart + run * sweepStride;
+    }
+
+    if (runCount > 1) {
+        printf("\n\nRun %d of %d", run + 1, runCount);
+    }
 }
 
 /**
@@ -196,31 +395,57 @@ uint8_t parseInput(char byte){
 void omega(FaultCode faultCode){
     // the beginning and the end
 
+    if (cosimCatchingStops) cosimStopped(faultCode);    // one side of a co-simulation stopped, see EScosim.c
+
     if (verbose) printStackPointers();
 
+    lastFaultCode = faultCode;
+    flushConsole();                             // the program's output comes before its trace
+    if (wordBits == 64) printHarmonFormattedTrace64(statusForFaultCode(faultCode));
+    else printHarmonFormattedTrace(statusForFaultCode(faultCode));
+
+    if (profiling) finishProfile();
+    if (collectingStats) finishStats(statusForFaultCode(faultCode));
+    if (hostCounting && runInProgress) finishHostCounters();
+    if (fileSandboxPath) closeGuestFiles();
+    if ((recordPath || replayPath) && runInProgress) finishRecordedRun(faultCode);
+    if (pluginCount && runInProgress) pluginRunFinished(currentInstructionByte - sandboxFloor, faultCode == HALT || faultCode == AOK, statusForFaultCode(faultCode));
+
+
+    if (runInProgress) {                        // there may be more runs queued up, let alpha() decide
+        runInProgress = false;
+        longjmp(runCompleted, 1);
+    }
+
+    // it's so hard to say goodbye.
+    exit(0);
+    // goodbye <3
+}
+
+
+/**
+ *  Gives the three letter status printed in the trace for a fault code.
+ *
+ *  @param faultCode the fault code conforming to the typedef FaultCode
+ *
+ *  @return the status string
+ */
+const char *statusForFaultCode(FaultCode faultCode){
     switch (faultCode) {
         case HALT:
-            printHarmonFormattedTrace("HLT");
-            break;
+            return "HLT";
         case AOK:
-            printHarmonFormattedTrace("AOK");
-            break;
+            return "AOK";
         case ADDRESS_FAULT:
-            printHarmonFormattedTrace("ADR");
-            break;
+            return "ADR";
         case INSTRUCTION_FAULT:
-            printHarmonFormattedTrace("INS");
-            break;
+            return "INS";
+        case IDLE_LOOP:
+            return "LOP";
 
         default:
-            printHarmonFormattedTrace("WTF");
-            break;
+            return "WTF";
     }
-
-
-    // it's so hard to say goodbye.
-    exit(0);
-    // goodbye <3
 }
 
 
@@ -239,6 +464,54 @@ void quit(FaultCode faultCode){
 
 
 
+/**
+ *  Parses a register sweep of the form %reg:start:stride. Run n starts with the register set to start + n * stride.
+ *
+ *  @param sweep the sweep specification
+ *
+ *  @return FALSE if the specification is malformed
+ */
+bool parseSweep(const char *sweep){
+    char name[8] = { 0 };
+    int start = 0, stride = 1;
+
+    if (sscanf(sweep, "%7[^:]:%i:%i", name, &start, &stride) < 2) return false;
+
+    int index = registerIndexForName(name);
+    if (index < 0) return false;
+
+    sweepRegister = index;
+    sweepStart    = start;
+    sweepStride   = stride;
+
+    return true;
+}
+
+
+
+/**
+ *  Parses a comma separated list of ISA extensions to turn on: iaddl, leave, muldiv, block or all.
+ *
+ *  @param list the extension names
+ *
+ *  @return FALSE if a name is not an extension
+ */
+bool parseExtensions(const char *list){
+    char names[128];
+    snprintf(names, sizeof(names), "%s", list);
+
+    for (char *name = strtok(names, ","); name; name = strtok(NULL, ",")) {
+        if (!strcmp(name, "iaddl"))         isaExtensions |= EXTENSION_IADDL;
+        else if (!strcmp(name, "leave"))    isaExtensions |= EXTENSION_LEAVE;
+        else if (!strcmp(name, "muldiv"))   isaExtensions |= EXTENSION_MULDIV;
+        else if (!strcmp(name, "block"))    isaExtensions |= EXTENSION_BLOCK;
+        else if (!strcmp(name, "all"))      isaExtensions |= EXTENSION_IADDL | EXTENSION_LEAVE | EXTENSION_MULDIV | EXTENSION_BLOCK;
+        else return false;
+    }
+
+    return true;
+}
+
 /******** HERE BE DRAGONS ***********/
 
 
@@ -252,6 +525,10 @@ void quit(FaultCode faultCode){
  */
 int main(int argc, const char * argv[]) {
 
+#ifdef ES_BENCHMARK
+    return runBenchmarks(argc, argv);           // make benchmark, see ESbenchmark.c
+#endif
+
     printf("\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\
 \\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\");
 
@@ -272,6 +549,156 @@ int main(int argc, const char * argv[]) {
                 printf("\nVerbose mode, you sneaky dog you!\n");
             }
 
+            if (!strncmp(argv[i], "--runs", 6) && i + 1 < argc) {
+                runCount = atoi(argv[++i]);
+                if (runCount < 1) runCount = 1;
+            }
+
+            if (!strncmp(argv[i], "--pool", 6) && i + 1 < argc) {
+                addressSpacePoolSize = atoi(argv[++i]);
+                if (addressSpacePoolSize < 1) addressSpacePoolSize = 1;
+            }
+
+            if (!strncmp(argv[i], "--sweep", 7) && i + 1 < argc) {
+                if (!parseSweep(argv[++i])) {
+                    printf("Bad sweep '%s'. Expected %%reg:start:stride, e.g. %%eax:0:1\n", argv[i]);
+                    exit(0);
+                }
+            }
+
+            if (!strcmp(argv[i], "--extend") && i + 1 < argc) {
+                if (!parseExtensions(argv[++i])) {
+                    printf("Bad extension list '%s'. Expected iaddl, leave, muldiv, block or all, separated by commas\n", argv[i]);
+                    exit(0);
+                }
+            }
+
+            if (!strcmp(argv[i], "--y86-64")) {
+                wordBits = 64;
+            }
+
+            if (!strcmp(argv[i], "--lockstep")) {
+                lockstep = true;
+                if (addressSpacePoolSize < LOCKSTEP_LANES) addressSpacePoolSize = LOCKSTEP_LANES;
+            }
+
+            if (!strcmp(argv[i], "-d") || !strcmp(argv[i], "--debug")) {
+                debugging = true;
+            }
+
+            if (!strncmp(argv[i], "--snapshot-every", 16) && i + 1 < argc) {
+                snapshotInterval = atoi(argv[++i]);
+            }
+
+            if (!strcmp(argv[i], "--stats") && i + 1 < argc) {
+                statsPath = argv[++i];
+                collectingStats = true;
+            }
+
+            if (!strcmp(argv[i], "-O") || !strcmp(argv[i], "--optimize")) {
+                optimizing = true;
+            }
+
+            if (!strcmp(argv[i], "--cosim")) {
+                cosimEngineName = i + 1 < argc && argv[i + 1][0] != '-' ? argv[++i] : "optimized";
+                if (addressSpacePoolSize < 2) addressSpacePoolSize = 2;
+            }
+
+            if (!strcmp(argv[i], "--cosim-every") && i + 1 < argc) {
+                cosimInterval = atoi(argv[++i]);
+            }
+
+            if (!strcmp(argv[i], "--fuzz") && i + 1 < argc) {
+                fuzzPrograms = atoi(argv[++i]);
+                if (!cosimEngineName) cosimEngineName = "optimized";
+                if (addressSpacePoolSize < 2) addressSpacePoolSize = 2;
+            }
+
+            if (!strcmp(argv[i], "--seed") && i + 1 < argc) {
+                fuzzSeed = (unsigned int)strtoul(argv[++i], NULL, 0);
+            }
+
+            if (!strcmp(argv[i], "--memoize")) {
+                memoizing = true;
+            }
+
+            if (!strcmp(argv[i], "--host-counters")) {
+                hostCounting = true;
+                if (i + 1 < argc && argv[i + 1][0] != '-') hostSamplePeriod = atoi(argv[++i]);
+            }
+
+            if (!strcmp(argv[i], "--no-idle-check")) {
+                checkingIdleLoops = false;
+            }
+
+            if (!strcmp(argv[i], "--writable-code")) {
+                writableCode = true;
+            }
+
+            if (!strcmp(argv[i], "--record") && i + 1 < argc) {
+                recordPath = argv[++i];
+            }
+
+            if (!strcmp(argv[i], "--replay") && i + 1 < argc) {
+                replayPath = argv[++i];
+            }
+
+            if (!strcmp(argv[i], "--trace")) {
+                tracing = true;
+            }
+
+            if (!strcmp(argv[i], "-p") || !strcmp(argv[i], "--profile")) {
+                profiling = true;
+                if (i + 1 < argc && argv[i + 1][0] != '-') profilePath = argv[++i];
+            }
+
+            if (!strncmp(argv[i], "--symbols", 9) && i + 1 < argc) {
+                symbolMapPath = argv[++i];
+                if (!loadSymbolMap(symbolMapPath)) printf("Could not read symbol map %s\n", symbolMapPath);
+            }
+
+            if (!strcmp(argv[i], "--checkpoint") && i + 1 < argc) {
+                checkpointPath = argv[++i];
+            }
+
+            if (!strcmp(argv[i], "--checkpoint-every") && i + 1 < argc) {
+                checkpointInterval = atoi(argv[++i]);
+                if (!checkpointPath) checkpointPath = "Eighty-Sixer.checkpoint";
+            }
+
+            if (!strcmp(argv[i], "--checkpoint-compress")) {
+                checkpointCompression = true;
+            }
+
+            if (!strncmp(argv[i], "--restore", 9) && i + 1 < argc) {
+                restorePath = argv[++i];
+            }
+
+            if (!strcmp(argv[i], "--assemble") && i + 1 < argc) {
+                sourcePath = argv[++i];
+            }
+
+            if (!strcmp(argv[i], "--files") && i + 1 < argc) {
+                fileSandboxPath = argv[++i];
+                isaExtensions |= EXTENSION_TRAP;
+            }
+
+            if (!strcmp(argv[i], "--plugin") && i + 1 < argc) {
+                if (pluginPathCount == MAX_PLUGINS) {
+                    printf("No more than %d plugins.\n", MAX_PLUGINS);
+                    exit(0);
+                }
+                pluginPaths[pluginPathCount++] = argv[++i];
+            }
+
+            if (!strcmp(argv[i], "--image-cache") && i + 1 < argc) {
+                imageCachePath = argv[++i];
+            }
+
+            if (!strcmp(argv[i], "--translate") && i + 1 < argc) {
+                translationPath = argv[++i];
+            }
+
             if (!strncmp(argv[i], "-V", 2) || !strncmp(argv[i], "--version", 9)) {
                 printf("Eighty-Sixer™ by Esteban Valle. Version %s\n", version);
                 exit(0);
@@ -13,13 +13,36 @@
 #include <stdlib.h>
 #include <stdbool.h>
 #include <string.h>
+#include <setjmp.h>
 #include "ESalu.h"
 #include "ESmemoryManager.h"
+#include "ESaddressSpacePool.h"
+#include "EScheckpoint.h"
+#include "EStimeTravel.h"
+#include "ESdebugger.h"
+#include "ESprofiler.h"
+#include "ESdecoder.h"
+#include "EStranslator.h"
+#include "ESlockstep.h"
+#include "ESassembler.h"
+#include "ESimageCache.h"
+#include "ESverifier.h"
+#include "ESstats.h"
+#include "ESbenchmark.h"
+#include "ESdevices.h"
+#include "ESfiles.h"
+#include "ESir.h"
+#include "ESplugins.h"
+#include "EScosim.h"
+#include "ESreplay.h"
+#include "ESmemo.h"
+#include "EShostCounters.h"
+#include "ESidleLoops.h"
 #include <stdint.h>
 
 
 typedef enum FaultCode {
-    HALT, AOK, ADDRESS_FAULT, INSTRUCTION_FAULT, PROGRAM_ERROR
+    HALT, AOK, ADDRESS_FAULT, INSTRUCTION_FAULT, PROGRAM_ERROR, IDLE_LOOP
 
 } FaultCode;
 
@@ -28,7 +51,17 @@ extern bool verbose;
 extern char *version;
 extern int instructionBytes;
 
+extern int runCount;
+extern int sweepRegister;
+extern int sweepStart;
+extern int sweepStride;
+
+extern jmp_buf runCompleted;
+extern bool runInProgress;
+extern FaultCode lastFaultCode;
+
 void quit(FaultCode);
+const char *statusForFaultCode(FaultCode);
 
 uint8_t parseInput(char);
 
@@ -0,0 +1,121 @@
+//
+//  opcounts.c
+//  Eighty-Sixer
+//
+//  Created by agent on 10/19/26.
+//  Copyright (c) 2026 agent. All rights reserved.
+//
+
+/*  An example plugin: counts each run's instructions by icode, the basic blocks entered, the calls and the memory
+    traffic, and prints them when the run ends. make plugins builds it; run it with
+
+        ./Eighty-Sixer --plugin plugins/opcounts.so < program.hex
+
+    An argument, --plugin plugins/opcounts.so=0x1000, also counts the writes at or above that address.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../ESpluginAPI.h"
+
+typedef struct OpCounts {
+    const ESPluginHost *host;
+    int64_t watchAddress;               // -1 if there's no argument
+    long    icodes[16];
+    long    blocks;
+    long    calls;
+    long    reads;
+    long    writes;
+    long    watchedWrites;
+} OpCounts;
+
+OpCounts counts;
+
+
+void opcountsRunStarted(void *context, int run){
+    (void)run;
+
+    OpCounts *opcounts = context;
+    int64_t watchAddress = opcounts->watchAddress;
+    const ESPluginHost *host = opcounts->host;
+
+    memset(opcounts, 0, sizeof(OpCounts));
+    opcounts->host = host;
+    opcounts->watchAddress = watchAddress;
+}
+
+
+void opcountsInstruction(void *context, int64_t address, uint8_t instruction){
+    (void)address;
+    ((OpCounts *)context)->icodes[instruction >> 4]++;
+}
+
+
+void opcountsBlock(void *context, int64_t address){
+    (void)address;
+    ((OpCounts *)context)->blocks++;
+}
+
+
+void opcountsRead(void *context, int64_t address, int length){
+    (void)address, (void)length;
+    ((OpCounts *)context)->reads++;
+}
+
+
+void opcountsWrite(void *context, int64_t address, int length){
+    (void)length;
+    OpCounts *opcounts = context;
+
+    opcounts->writes++;
+    if (opcounts->watchAddress >= 0 && address >= opcounts->watchAddress) opcounts->watchedWrites++;
+}
+
+
+void opcountsCall(void *context, int64_t target, int64_t returnAddress){
+    (void)target, (void)returnAddress;
+    ((OpCounts *)context)->calls++;
+}
+
+
+void opcountsReport(OpCounts *opcounts, int64_t address, const char *status){
+    printf("\nopcounts: %s at 0x%04llX after %d steps\n", status, (long long)address, opcounts->host->stepCount());
+
+    for (int icode = 0; icode < 16; icode++) {
+        if (opcounts->icodes[icode]) printf("opcounts:   icode %X  %ld\n", icode, opcounts->icodes[icode]);
+    }
+
+    printf("opcounts: %ld blocks, %ld calls, %ld reads, %ld writes\n", opcounts->blocks, opcounts->calls, opcounts->reads, opcounts->writes);
+    if (opcounts->watchAddress >= 0) printf("opcounts: %ld writes at or above 0x%llX\n", opcounts->watchedWrites, (long long)opcounts->watchAddress);
+}
+
+
+void opcountsHalt(void *context, int64_t address){
+    opcountsReport(context, address, "halted");
+}
+
+
+void opcountsFault(void *context, int64_t address, const char *status){
+    opcountsReport(context, address, status);
+}
+
+
+bool eightySixerPlugin(const ESPluginHost *host, ESPluginCallbacks *callbacks){
+    if (host->apiVersion != ES_PLUGIN_API_VERSION) return false;
+
+    counts.host = host;
+    counts.watchAddress = host->argument ? strtoll(host->argument, NULL, 0) : -1;
+
+    callbacks->context      = &counts;
+    callbacks->runStarted   = opcountsRunStarted;
+    callbacks->instruction  = opcountsInstruction;
+    callbacks->blockEntered = opcountsBlock;
+    callbacks->memoryRead   = opcountsRead;
+    callbacks->memoryWrite  = opcountsWrite;
+    callbacks->call         = opcountsCall;
+    callbacks->halt         = opcountsHalt;
+    callbacks->fault        = opcountsFault;
+
+    return true;
+}
@@ -0,0 +1,29 @@
+#!/bin/sh
+#
+#  run.sh
+#  Eighty-Sixer
+#
+#  The regression tests, run by make test. The first line of each NAME.in is a program in hex and any lines
+#  after it are debugger commands; NAME.args holds the command line, if the test needs one. Every line of
+#  NAME.out has to turn up somewhere in what the machine prints.
+#
+
+cd "$(dirname "$0")" || exit 1
+failed=0
+
+for input in *.in; do
+    name=${input%.in}
+    arguments=$(cat "$name.args" 2>/dev/null)
+
+    output=$({ head -n 1 "$input" | tr -d '\n'; printf '\0'; tail -n +2 "$input"; } | ../Eighty-Sixer $arguments 2>&1)
+
+    while IFS= read -r line; do
+        if ! printf '%s\n' "$output" | grep -qF -- "$line"; then
+            echo "FAIL $name: expected \"$line\""
+            failed=1
+        fi
+    done < "$name.out"
+done
+
+[ $failed = 0 ] && echo "All tests passed."
+exit $failed